@@ -0,0 +1,45 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationBenchmark.inl
+	Inline definitions for animation benchmarks.
+*/
+
+#ifdef __ANIMAL3D_ANIMATIONBENCHMARK_H
+#ifndef __ANIMAL3D_ANIMATIONBENCHMARK_INL
+#define __ANIMAL3D_ANIMATIONBENCHMARK_INL
+
+
+//-----------------------------------------------------------------------------
+
+// speedup of vector path
+inline a3f64 a3animationBenchmarkSpeedup(const a3_AnimationBenchmark *result)
+{
+	if (result && result->vectorTime > 0.0)
+		return (result->scalarTime / result->vectorTime);
+	return 0.0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_ANIMATIONBENCHMARK_INL
+#endif	// __ANIMAL3D_ANIMATIONBENCHMARK_H
@@ -0,0 +1,75 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationCache.inl
+	Inline definitions for animation cache.
+*/
+
+#ifdef __ANIMAL3D_ANIMATIONCACHE_H
+#ifndef __ANIMAL3D_ANIMATIONCACHE_INL
+#define __ANIMAL3D_ANIMATIONCACHE_INL
+
+
+//-----------------------------------------------------------------------------
+
+// load HTR through cache
+inline a3i32 a3animationCacheLoadHTR(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, a3_KeyframePool *keyframePool_out_opt, a3_ClipPool *clipPool_out_opt, const a3byte *resourceFilePath, const a3byte *clipSetFilePath_opt, const a3byte *cacheFilePath)
+{
+	const a3boolean clips = (keyframePool_out_opt && clipPool_out_opt && clipSetFilePath_opt && *clipSetFilePath_opt);
+	a3i32 ret;
+
+	// pools to fill must start empty, so failing can release them
+	if (clips && (keyframePool_out_opt->keyframe || clipPool_out_opt->clip))
+		return -1;
+	if (!a3animationCacheIsStale(cacheFilePath, resourceFilePath) && (!clips || !a3animationCacheIsStale(cacheFilePath, clipSetFilePath_opt)))
+		if ((ret = a3animationCacheLoad(poseGroup_out, hierarchy_out, clips ? keyframePool_out_opt : 0, clips ? clipPool_out_opt : 0, cacheFilePath)) >= 0)
+		{
+			// a cache saved without clips cannot serve a request for them
+			if (!clips || clipPool_out_opt->clip)
+				return ret;
+			a3keyframePoolRelease(keyframePool_out_opt);
+			a3hierarchyPoseGroupRelease(poseGroup_out);
+			a3hierarchyRelease(hierarchy_out);
+		}
+
+	// text path, then refresh the cache for next time; only pools filled 
+	//	here are stored, and a clip set that fails to load fails the whole 
+	//	request instead of being cached empty
+	if ((ret = a3hierarchyPoseGroupLoadHTR(poseGroup_out, hierarchy_out, resourceFilePath)) >= 0)
+	{
+		if (clips && a3clipPoolLoad(clipPool_out_opt, keyframePool_out_opt, clipSetFilePath_opt) < 0)
+		{
+			a3clipPoolRelease(clipPool_out_opt);
+			a3keyframePoolRelease(keyframePool_out_opt);
+			a3hierarchyPoseGroupRelease(poseGroup_out);
+			a3hierarchyRelease(hierarchy_out);
+			return -1;
+		}
+		a3animationCacheSave(poseGroup_out, clips ? keyframePool_out_opt : 0, clips ? clipPool_out_opt : 0, cacheFilePath);
+	}
+	return ret;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_ANIMATIONCACHE_INL
+#endif	// __ANIMAL3D_ANIMATIONCACHE_H
@@ -33,8 +33,8 @@
 
 A3_INLINE a3ret a3hierarchyIsParentNode(const a3_Hierarchy *hierarchy, const a3ui32 parentIndex, const a3ui32 otherIndex)
 {
-	if (hierarchy && hierarchy->nodes && otherIndex < hierarchy->numNodes && parentIndex < hierarchy->numNodes)
-		return (hierarchy->nodes[otherIndex].parentIndex == parentIndex);
+	if (hierarchy && hierarchy->parentIndex && otherIndex < hierarchy->numNodes && parentIndex < hierarchy->numNodes)
+		return (hierarchy->parentIndex[otherIndex] == (a3i32)parentIndex);
 	return -1;
 }
 
@@ -45,23 +45,54 @@ A3_INLINE a3ret a3hierarchyIsChildNode(const a3_Hierarchy *hierarchy, const a3ui
 
 A3_INLINE a3ret a3hierarchyIsSiblingNode(const a3_Hierarchy *hierarchy, const a3ui32 siblingIndex, const a3ui32 otherIndex)
 {
-	if (hierarchy && hierarchy->nodes && otherIndex < hierarchy->numNodes && siblingIndex < hierarchy->numNodes)
-		return (hierarchy->nodes[otherIndex].parentIndex == hierarchy->nodes[siblingIndex].parentIndex);
+	if (hierarchy && hierarchy->parentIndex && otherIndex < hierarchy->numNodes && siblingIndex < hierarchy->numNodes)
+		return (hierarchy->parentIndex[otherIndex] == hierarchy->parentIndex[siblingIndex]);
 	return -1;
 }
 
 A3_INLINE a3ret a3hierarchyIsAncestorNode(const a3_Hierarchy *hierarchy, const a3ui32 ancestorIndex, const a3ui32 otherIndex)
 {
-	a3ui32 i = otherIndex;
-	if (hierarchy && hierarchy->nodes && otherIndex < hierarchy->numNodes && ancestorIndex < hierarchy->numNodes)
+	a3i32 i = otherIndex;
+	if (hierarchy && hierarchy->parentIndex && otherIndex < hierarchy->numNodes && ancestorIndex < hierarchy->numNodes)
 	{
-		while (i > ancestorIndex)
-			i = hierarchy->nodes[i].parentIndex;
-		return (i == ancestorIndex);
+		// range check if subtrees are built, otherwise walk up
+		if (hierarchy->subtreeFirst)
+			return (hierarchy->subtreeFirst[otherIndex] >= hierarchy->subtreeFirst[ancestorIndex] &&
+				hierarchy->subtreeFirst[otherIndex] < hierarchy->subtreeEnd[ancestorIndex]);
+		while (i > (a3i32)ancestorIndex)
+			i = hierarchy->parentIndex[i];
+		return (i == (a3i32)ancestorIndex);
 	}
 	return -1;
 }
 
+A3_INLINE a3ret a3hierarchyGetLevelNodes(const a3ui32 **levelNodeIndex_out, const a3_Hierarchy *hierarchy, const a3ui32 levelIndex)
+{
+	if (levelNodeIndex_out && hierarchy && hierarchy->levelNodeIndex && levelIndex < hierarchy->numLevels)
+	{
+		*levelNodeIndex_out = hierarchy->levelNodeIndex + hierarchy->levelOffset[levelIndex];
+		return (hierarchy->levelOffset[levelIndex + 1] - hierarchy->levelOffset[levelIndex]);
+	}
+	return -1;
+}
+
+A3_INLINE a3ret a3hierarchyGetChildNodes(const a3ui32 **childIndex_out, const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex)
+{
+	if (childIndex_out && hierarchy && hierarchy->childIndex && nodeIndex < hierarchy->numNodes)
+	{
+		*childIndex_out = hierarchy->childIndex + hierarchy->childOffset[nodeIndex];
+		return (hierarchy->childOffset[nodeIndex + 1] - hierarchy->childOffset[nodeIndex]);
+	}
+	return -1;
+}
+
+A3_INLINE a3ret a3hierarchyGetSubtreeSpan(const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex)
+{
+	if (hierarchy && hierarchy->subtreeFirst && hierarchy->isDepthFirst && nodeIndex < hierarchy->numNodes)
+		return (hierarchy->subtreeEnd[nodeIndex] - nodeIndex);
+	return -1;
+}
+
 A3_INLINE a3ret a3hierarchyIsDescendantNode(const a3_Hierarchy *hierarchy, const a3ui32 descendantIndex, const a3ui32 otherIndex)
 {
 	return a3hierarchyIsAncestorNode(hierarchy, otherIndex, descendantIndex);
@@ -50,18 +50,56 @@ inline a3i32 a3hierarchyPoseGroupGetNodePoseOffsetIndex(const a3_HierarchyPoseGr
 	return -1;
 }
 
+// copy single node pose out of channel streams
+inline a3i32 a3hierarchyPoseGetNode(a3_SpatialPose *spatialPose_out, const a3_HierarchyPose *pose, const a3ui32 nodeIndex)
+{
+	if (spatialPose_out && pose && pose->rotate)
+	{
+		spatialPose_out->rotate = pose->rotate[nodeIndex];
+		spatialPose_out->translate = pose->translate[nodeIndex];
+		spatialPose_out->scale = pose->scale[nodeIndex];
+		return nodeIndex;
+	}
+	return -1;
+}
+
+// copy single node pose into channel streams
+inline a3i32 a3hierarchyPoseSetNode(const a3_HierarchyPose *pose, const a3ui32 nodeIndex, const a3_SpatialPose *spatialPose)
+{
+	if (pose && pose->rotate && spatialPose)
+	{
+		pose->rotate[nodeIndex] = spatialPose->rotate;
+		pose->translate[nodeIndex] = spatialPose->translate;
+		pose->scale[nodeIndex] = spatialPose->scale;
+		return nodeIndex;
+	}
+	return -1;
+}
+
 
 //-----------------------------------------------------------------------------
 
-// update inverse object-space matrices
-inline a3i32 a3hierarchyStateUpdateObjectInverse(const a3_HierarchyState *state, const a3boolean usingScale)
+// update local-space matrices from working local pose
+inline a3i32 a3hierarchyStateUpdateLocalSpace(const a3_HierarchyState *state)
 {
+	if (state && state->poseGroup)
+	{
+		a3hierarchyStateSetDirty(state, 0, state->poseGroup->hierarchy->numNodes);
+		return a3hierarchyPoseConvert(state->localSpace, state->localPose, state->poseGroup->hierarchy->numNodes);
+	}
 	return -1;
 }
 
-// update bind-to-current given bind-pose object-space transforms
-inline a3i32 a3hierarchyStateUpdateObjectBindToCurrent(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse)
+// read recompute counters
+inline a3i32 a3hierarchyStateGetCounter(a3_HierarchyStateCounter *counter_out, const a3_HierarchyState *state, const a3boolean reset)
 {
+	if (counter_out && state && state->poseGroup)
+	{
+		*counter_out = *state->counter;
+		if (reset)
+			state->counter->localSpace = state->counter->objectSpace = state->counter->skinning = 0;
+		return 1;
+	}
 	return -1;
 }
 
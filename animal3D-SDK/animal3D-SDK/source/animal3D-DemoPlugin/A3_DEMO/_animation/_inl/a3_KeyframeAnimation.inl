@@ -32,12 +32,143 @@
 // calculate clip duration as sum of keyframes' durations
 inline a3i32 a3clipCalculateDuration(a3_Clip* clip)
 {
+	const a3_Keyframe* keyframe;
+	if (clip && clip->keyframePool)
+	{
+		// duration from start times, so that time lookups agree with it
+		a3keyframePoolCalculateTime(clip->keyframePool, clip->keyframeIndex_first);
+		keyframe = clip->keyframePool->keyframe;
+		clip->duration = keyframe[clip->keyframeIndex_final].time + keyframe[clip->keyframeIndex_final].duration - keyframe[clip->keyframeIndex_first].time;
+		clip->durationInv = a3recip(clip->duration);
+		a3clipCalculateRate(clip);
+
+		if (clip->transitionForward.clip == clip->index)
+			a3clipTransitionInit(&clip->transitionForward, clip, clip->transitionForward.flags);
+		if (clip->transitionReverse.clip == clip->index)
+			a3clipTransitionInit(&clip->transitionReverse, clip, clip->transitionReverse.flags);
+		return clip->index;
+	}
+	return -1;
+}
+
+// detect uniform spacing
+inline a3i32 a3clipCalculateRate(a3_Clip* clip)
+{
+	const a3_Keyframe* keyframe;
+	a3ui32 i;
+	if (clip && clip->keyframePool)
+	{
+		// uniform spacing: exactly equal durations, so both lookups agree
+		keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		for (i = 1; i < clip->keyframeCount && keyframe[i].duration == keyframe[0].duration; ++i);
+		clip->isUniform = (i == clip->keyframeCount && keyframe[0].duration > a3real_zero);
+		clip->keyframeDuration = keyframe[0].duration;
+		clip->keyframeDurationInv = keyframe[0].durationInv;
+		clip->keyframeRevision = clip->keyframePool->revision;
+		return clip->isUniform;
+	}
 	return -1;
 }
 
+// check for direct lookup
+inline a3boolean a3clipIsDirectLookup(const a3_Clip* clip)
+{
+	return (clip && clip->keyframePool && clip->isUniform && clip->keyframeRevision == clip->keyframePool->revision);
+}
+
 // calculate keyframes' durations by distributing clip's duration
 inline a3i32 a3clipDistributeDuration(a3_Clip* clip, const a3real newClipDuration)
 {
+	a3_Keyframe* keyframe;
+	a3real duration;
+	a3ui32 i;
+	if (clip && clip->keyframePool && newClipDuration > a3real_zero)
+	{
+		keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		duration = newClipDuration / (a3real)clip->keyframeCount;
+		for (i = 0; i < clip->keyframeCount; ++i)
+			a3keyframeInit(keyframe + i, duration, keyframe[i].data);
+		a3keyframePoolCalculateTime(clip->keyframePool, clip->keyframeIndex_first);
+		clip->duration = newClipDuration;
+		clip->durationInv = a3recip(newClipDuration);
+		clip->isUniform = a3true;
+		clip->keyframeDuration = keyframe->duration;
+		clip->keyframeDurationInv = keyframe->durationInv;
+		clip->keyframeRevision = clip->keyframePool->revision;
+		if (clip->transitionForward.clip == clip->index)
+			a3clipTransitionInit(&clip->transitionForward, clip, clip->transitionForward.flags);
+		if (clip->transitionReverse.clip == clip->index)
+			a3clipTransitionInit(&clip->transitionReverse, clip, clip->transitionReverse.flags);
+		return clip->index;
+	}
+	return -1;
+}
+
+// get keyframe at clip time
+inline a3i32 a3clipGetKeyframeIndex(const a3_Clip* clip, const a3real clipTime, a3real* keyframeTime_out_opt)
+{
+	const a3_Keyframe* keyframe;
+	a3real time;
+	a3ui32 lo, hi, mid;
+	if (clip && clip->keyframePool)
+	{
+		// fixed rate: index from time, no search and no keyframe reads, 
+		//	unless shared keyframes changed since the rate was cached
+		if (a3clipIsDirectLookup(clip))
+		{
+			time = a3maximum(clipTime, a3real_zero);
+			lo = (a3ui32)(time * clip->keyframeDurationInv);
+			lo = a3minimum(lo, clip->keyframeCount - 1);
+			if (keyframeTime_out_opt)
+				*keyframeTime_out_opt = a3clamp(a3real_zero, clip->keyframeDuration, time - (a3real)lo * clip->keyframeDuration);
+			return (clip->keyframeIndex_first + lo);
+		}
+
+		// invariant: keyframe[lo] starts at or before time, keyframe[hi] after
+		keyframe = clip->keyframePool->keyframe;
+		time = keyframe[clip->keyframeIndex_first].time + a3maximum(clipTime, a3real_zero);
+		for (lo = clip->keyframeIndex_first, hi = clip->keyframeIndex_final + 1; hi - lo > 1; )
+		{
+			mid = (lo + hi) >> 1;
+			if (keyframe[mid].time <= time)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		if (keyframeTime_out_opt)
+			*keyframeTime_out_opt = a3clamp(a3real_zero, keyframe[lo].duration, time - keyframe[lo].time);
+		return lo;
+	}
+	return -1;
+}
+
+// compile transition
+inline a3i32 a3clipTransitionInit(a3_ClipTransition* transition_out, const a3_Clip* clip, const a3ui32 flags)
+{
+	const a3_Keyframe* keyframe;
+	a3i32 keyframeIndex;
+	if (transition_out && clip && clip->keyframePool && 
+		((flags & a3clipTransition_forward) != 0) != ((flags & a3clipTransition_reverse) != 0))
+	{
+		// start position: clip start or end, or one keyframe in when skipping
+		keyframe = clip->keyframePool->keyframe;
+		if (flags & a3clipTransition_forward)
+		{
+			transition_out->clipTime = (flags & a3clipTransition_skip) ? keyframe[clip->keyframeIndex_first].duration : a3real_zero;
+			transition_out->playback = a3real_one;
+		}
+		else
+		{
+			transition_out->clipTime = clip->duration - ((flags & a3clipTransition_skip) ? keyframe[clip->keyframeIndex_final].duration : a3real_zero);
+			transition_out->playback = -a3real_one;
+		}
+		keyframeIndex = a3clipGetKeyframeIndex(clip, transition_out->clipTime, &transition_out->keyframeTime);
+		transition_out->keyframe = (a3ui32)keyframeIndex;
+		transition_out->clip = clip->index;
+		transition_out->pause = (flags & a3clipTransition_pause) != 0;
+		transition_out->flags = flags;
+		return clip->index;
+	}
 	return -1;
 }
 
@@ -29,15 +29,133 @@
 
 //-----------------------------------------------------------------------------
 
+// move to the keyframe containing the clip time; past either end of the 
+//	clip, follow the clip's compiled transition, carrying over the time 
+//	past the terminus; returns number of termini passed
+// when transitions come back to one already taken (a loop or ping-pong), 
+//	whole cycles are skipped with modulo arithmetic, so the cost does not 
+//	depend on how far time moved; cycles are found by checking against a 
+//	remembered transition that is replaced at power-of-two steps
+inline a3i32 a3clipControllerInternalResolve(const a3_ClipPool* clipPool, a3ui32* clip_inout, a3ui32* keyframe_inout, a3real* keyframeTime_inout, a3real* clipTime_inout, a3real* playback_inout)
+{
+	const a3_Clip* clip = clipPool->clip + *clip_inout;
+	const a3_ClipTransition* transition, * cycle = 0;
+	a3real clipTime = *clipTime_inout, overstep, cycleOverstep = a3real_zero, period;
+	a3i32 terminus = 0, cycleIndex = 0, laps, i;
+
+	for (i = 0; i < a3clipCtrl_transitionMax && (clipTime < a3real_zero || clipTime > clip->duration); ++i)
+	{
+		// time past the terminus
+		if (clipTime > clip->duration)
+		{
+			transition = &clip->transitionForward;
+			overstep = clipTime - clip->duration;
+		}
+		else
+		{
+			transition = &clip->transitionReverse;
+			overstep = -clipTime;
+		}
+
+		// skip whole cycles
+		if (transition == cycle)
+		{
+			period = cycleOverstep - overstep;
+			if (period > a3real_zero)
+			{
+				laps = (a3i32)(overstep / period);
+				overstep -= (a3real)laps * period;
+				terminus += laps * (i - cycleIndex);
+			}
+			cycle = 0;
+		}
+		else if (!(i & (i - 1)))
+		{
+			cycle = transition;
+			cycleOverstep = overstep;
+			cycleIndex = i;
+		}
+
+		// continue from the transition's start, in its direction at the 
+		//	same rate, unless it pauses there
+		clip = clipPool->clip + transition->clip;
+		clipTime = transition->clipTime;
+		if (transition->pause)
+			*playback_inout = a3real_zero;
+		else
+		{
+			*playback_inout = transition->playback * a3absolute(*playback_inout);
+			clipTime += transition->playback * overstep;
+		}
+		++terminus;
+	}
+
+	// transitions that do not move the playhead stop at the last one
+	clipTime = a3clamp(a3real_zero, clip->duration, clipTime);
+	*clip_inout = clip->index;
+	*clipTime_inout = clipTime;
+	*keyframe_inout = a3clipGetKeyframeIndex(clip, clipTime, keyframeTime_inout);
+	return terminus;
+}
+
+
 // update clip controller
 inline a3i32 a3clipControllerUpdate(a3_ClipController* clipCtrl, const a3real dt)
 {
+	const a3_Clip* clip;
+	a3real step;
+	if (clipCtrl && clipCtrl->clipPool && clipCtrl->clip < clipCtrl->clipPool->count)
+	{
+		clip = clipCtrl->clipPool->clip + clipCtrl->clip;
+		step = dt * clipCtrl->playback;
+		clipCtrl->keyframeTime += step;
+		clipCtrl->clipTime += step;
+		if (clipCtrl->keyframeTime < a3real_zero || clipCtrl->keyframeTime > clip->keyframePool->keyframe[clipCtrl->keyframe].duration)
+		{
+			a3clipControllerInternalResolve(clipCtrl->clipPool, &clipCtrl->clip, &clipCtrl->keyframe, &clipCtrl->keyframeTime, &clipCtrl->clipTime, &clipCtrl->playback);
+			clip = clipCtrl->clipPool->clip + clipCtrl->clip;
+		}
+		clipCtrl->keyframeParam = clipCtrl->keyframeTime * clip->keyframePool->keyframe[clipCtrl->keyframe].durationInv;
+		clipCtrl->clipParam = clipCtrl->clipTime * clip->durationInv;
+		return clipCtrl->keyframe;
+	}
 	return -1;
 }
 
 // set clip to play
 inline a3i32 a3clipControllerSetClip(a3_ClipController* clipCtrl, const a3_ClipPool* clipPool, const a3ui32 clipIndex_pool)
 {
+	const a3_Clip* clip;
+	if (clipCtrl && clipPool && clipPool->clip && clipIndex_pool < clipPool->count && clipPool->clip[clipIndex_pool].keyframePool)
+	{
+		// reverse playback starts at the end of the clip
+		clip = clipPool->clip + clipIndex_pool;
+		clipCtrl->clipPool = clipPool;
+		clipCtrl->clip = clipIndex_pool;
+		if (clipCtrl->playback < a3real_zero)
+		{
+			clipCtrl->keyframe = clip->keyframeIndex_final;
+			clipCtrl->keyframeTime = clip->keyframePool->keyframe[clipCtrl->keyframe].duration;
+			clipCtrl->clipTime = clip->duration;
+			clipCtrl->keyframeParam = clipCtrl->clipParam = a3real_one;
+		}
+		else
+		{
+			clipCtrl->keyframe = clip->keyframeIndex_first;
+			clipCtrl->keyframeTime = clipCtrl->clipTime = a3real_zero;
+			clipCtrl->keyframeParam = clipCtrl->clipParam = a3real_zero;
+		}
+		return clipIndex_pool;
+	}
+	return -1;
+}
+
+
+// update batch
+inline a3i32 a3clipControllerBatchUpdate(a3_ClipControllerBatch* batch, const a3real dt)
+{
+	if (a3clipControllerBatchAdvance(batch, dt) >= 0)
+		return a3clipControllerBatchResolve(batch);
 	return -1;
 }
 
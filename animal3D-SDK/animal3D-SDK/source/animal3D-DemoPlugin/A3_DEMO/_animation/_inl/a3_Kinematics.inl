@@ -36,6 +36,45 @@ inline a3i32 a3kinematicsSolveForward(const a3_HierarchyState *hierarchyState)
 	return a3kinematicsSolveForwardPartial(hierarchyState, 0, hierarchyState->poseGroup->hierarchy->numNodes);
 }
 
+// affine FK solver
+inline a3i32 a3kinematicsSolveForwardAffine(const a3_HierarchyState *hierarchyState)
+{
+	return a3kinematicsSolveForwardPartialAffine(hierarchyState, 0, hierarchyState->poseGroup->hierarchy->numNodes);
+}
+
+// subtree FK solver
+inline a3i32 a3kinematicsSolveForwardSubtree(const a3_HierarchyState *hierarchyState, const a3ui32 nodeIndex)
+{
+	a3i32 span;
+	if (hierarchyState && hierarchyState->poseGroup)
+	{
+		// descendants always follow their ancestors, so the tail is a safe 
+		//	superset; marking the node makes the whole subtree follow it
+		span = a3hierarchyGetSubtreeSpan(hierarchyState->poseGroup->hierarchy, nodeIndex);
+		if (span < 0)
+			span = hierarchyState->poseGroup->hierarchy->numNodes - nodeIndex;
+		a3hierarchyStateSetDirty(hierarchyState, nodeIndex, 1);
+		return a3kinematicsSolveForwardPartial(hierarchyState, nodeIndex, span);
+	}
+	return -1;
+}
+
+// level-order FK solver
+inline a3i32 a3kinematicsSolveForwardByLevel(const a3_HierarchyState *hierarchyState)
+{
+	a3ui32 i, n;
+	a3i32 ret;
+	if (hierarchyState && hierarchyState->poseGroup && hierarchyState->poseGroup->hierarchy->levelNodeIndex)
+	{
+		for (i = n = 0; i < hierarchyState->poseGroup->hierarchy->numLevels; ++i, n += ret)
+			if ((ret = a3kinematicsSolveForwardLevel(hierarchyState, i, 0, hierarchyState->poseGroup->hierarchy->numNodes)) < 0)
+				return -1;
+		a3kinematicsSolveForwardLevelsDone(hierarchyState);
+		return n;
+	}
+	return -1;
+}
+
 
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,43 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_QuantizedTrack.inl
+	Inline definitions for quantized tracks.
+*/
+
+#ifdef __ANIMAL3D_QUANTIZEDTRACK_H
+#ifndef __ANIMAL3D_QUANTIZEDTRACK_INL
+#define __ANIMAL3D_QUANTIZEDTRACK_INL
+
+
+//-----------------------------------------------------------------------------
+
+// decode one key
+inline a3i32 a3quantizedTrackDecode(const a3_HierarchyPose *pose_out, const a3_QuantizedTrack *track, const a3ui32 keyIndex)
+{
+	return a3quantizedTrackSample(pose_out, track, keyIndex, keyIndex, a3real_zero);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_QUANTIZEDTRACK_INL
+#endif	// __ANIMAL3D_QUANTIZEDTRACK_H
@@ -0,0 +1,72 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_ReducedTrack.inl
+	Inline definitions for reduced tracks.
+*/
+
+#ifdef __ANIMAL3D_REDUCEDTRACK_H
+#ifndef __ANIMAL3D_REDUCEDTRACK_INL
+#define __ANIMAL3D_REDUCEDTRACK_INL
+
+
+//-----------------------------------------------------------------------------
+
+// find key pair by binary search: last key at or before time
+inline a3i32 a3reducedTrackFindKey(a3ui32 *keyIndex0_out, a3real *param_out, const a3real *keyTime, const a3ui32 keyCount, const a3real time)
+{
+	a3ui32 lo, hi, mid;
+	if (keyIndex0_out && param_out && keyTime && keyCount)
+	{
+		if (keyCount == 1 || time <= keyTime[0])
+		{
+			*keyIndex0_out = 0;
+			*param_out = a3real_zero;
+			return 0;
+		}
+		if (time >= keyTime[keyCount - 1])
+		{
+			*keyIndex0_out = keyCount - 2;
+			*param_out = a3real_one;
+			return (keyCount - 2);
+		}
+
+		// invariant: keyTime[lo] <= time < keyTime[hi]
+		for (lo = 0, hi = keyCount - 1; hi - lo > 1; )
+		{
+			mid = (lo + hi) >> 1;
+			if (keyTime[mid] <= time)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		*keyIndex0_out = lo;
+		*param_out = (time - keyTime[lo]) / (keyTime[hi] - keyTime[lo]);
+		return lo;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_REDUCEDTRACK_INL
+#endif	// __ANIMAL3D_REDUCEDTRACK_H
@@ -0,0 +1,51 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_SkinWeights.inl
+	Inline definitions for skin weights.
+*/
+
+#ifdef __ANIMAL3D_SKINWEIGHTS_H
+#ifndef __ANIMAL3D_SKINWEIGHTS_INL
+#define __ANIMAL3D_SKINWEIGHTS_INL
+
+
+//-----------------------------------------------------------------------------
+
+// load XML through cache
+inline a3i32 a3skinWeightsLoadXMLCached(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *resourceFilePath, const a3byte *cacheFilePath)
+{
+	a3i32 ret;
+	if (!a3animationCacheIsStale(cacheFilePath, resourceFilePath))
+		if ((ret = a3skinWeightsLoad(weights_out, hierarchy, cacheFilePath)) >= 0)
+			return ret;
+
+	// text path, then refresh the cache for next time
+	if ((ret = a3skinWeightsLoadXML(weights_out, hierarchy, resourceFilePath)) >= 0)
+		a3skinWeightsSave(weights_out, hierarchy, cacheFilePath);
+	return ret;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_SKINWEIGHTS_INL
+#endif	// __ANIMAL3D_SKINWEIGHTS_H
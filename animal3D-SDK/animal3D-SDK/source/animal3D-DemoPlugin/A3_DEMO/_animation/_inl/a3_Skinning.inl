@@ -0,0 +1,57 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_Skinning.inl
+	Inline definitions for CPU skinning.
+*/
+
+#ifdef __ANIMAL3D_SKINNING_H
+#ifndef __ANIMAL3D_SKINNING_INL
+#define __ANIMAL3D_SKINNING_INL
+
+
+//-----------------------------------------------------------------------------
+
+// fill job for whole mesh
+inline a3i32 a3skinningJobInit(a3_SkinningJob *job_out, const a3_SkinMesh *mesh, const a3_HierarchyState *state, a3vec3 *position_out, a3vec3 *normal_out_opt, a3vec3 *tangent_out_opt, a3vec3 *bitangent_out_opt)
+{
+	if (job_out && mesh && state && state->poseGroup && position_out)
+	{
+		job_out->mesh = mesh;
+		job_out->palette = state->objectSpaceBindToCurrent->transform;
+		job_out->paletteCount = state->poseGroup->hierarchy->numNodes;
+		job_out->paletteDualQuat = 0;
+		job_out->position_out = position_out;
+		job_out->normal_out = normal_out_opt;
+		job_out->tangent_out = tangent_out_opt;
+		job_out->bitangent_out = bitangent_out_opt;
+		job_out->firstVertex = 0;
+		job_out->vertexCount = mesh->vertexCount;
+		return mesh->vertexCount;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_SKINNING_INL
+#endif	// __ANIMAL3D_SKINNING_H
@@ -30,6 +30,53 @@
 
 //-----------------------------------------------------------------------------
 
+// reset single node pose to identity
+inline a3i32 a3spatialPoseReset(a3_SpatialPose* spatialPose)
+{
+	if (spatialPose)
+	{
+		spatialPose->rotate = a3quat_identity;
+		spatialPose->translate = a3vec3_zero;
+		spatialPose->scale = a3vec3_one;
+		return 1;
+	}
+	return -1;
+}
+
+// convert channels to matrix: translate * rotate * scale
+inline a3i32 a3spatialPoseConvert(a3mat4* mat_out, const a3quat* rotate, const a3vec3* translate, const a3vec3* scale)
+{
+	if (mat_out && rotate && translate && scale)
+	{
+		// rotation basis from unit quaternion, columns scaled
+		const a3real x2 = rotate->x + rotate->x, y2 = rotate->y + rotate->y, z2 = rotate->z + rotate->z;
+		const a3real xx = rotate->x * x2, yy = rotate->y * y2, zz = rotate->z * z2;
+		const a3real xy = rotate->x * y2, xz = rotate->x * z2, yz = rotate->y * z2;
+		const a3real wx = rotate->w * x2, wy = rotate->w * y2, wz = rotate->w * z2;
+
+		mat_out->m00 = (a3real_one - yy - zz) * scale->x;
+		mat_out->m01 = (xy + wz) * scale->x;
+		mat_out->m02 = (xz - wy) * scale->x;
+		mat_out->m03 = a3real_zero;
+
+		mat_out->m10 = (xy - wz) * scale->y;
+		mat_out->m11 = (a3real_one - xx - zz) * scale->y;
+		mat_out->m12 = (yz + wx) * scale->y;
+		mat_out->m13 = a3real_zero;
+
+		mat_out->m20 = (xz + wy) * scale->z;
+		mat_out->m21 = (yz - wx) * scale->z;
+		mat_out->m22 = (a3real_one - xx - yy) * scale->z;
+		mat_out->m23 = a3real_zero;
+
+		mat_out->m30 = translate->x;
+		mat_out->m31 = translate->y;
+		mat_out->m32 = translate->z;
+		mat_out->m33 = a3real_one;
+		return 1;
+	}
+	return -1;
+}
 
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,327 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationBenchmark.c
+	Implementation of animation benchmarks.
+*/
+
+#include "../a3_AnimationBenchmark.h"
+#include "../a3_Kinematics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else	// !_WIN32
+#include <time.h>
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+
+// largest absolute difference between two arrays of reals
+static inline a3real a3animationBenchmarkInternalMaxError(const a3real *v0, const a3real *v1, const a3ui32 count)
+{
+	a3real err = a3real_zero, d;
+	a3ui32 i;
+	for (i = 0; i < count; ++i)
+	{
+		d = v0[i] - v1[i];
+		if (d < a3real_zero)
+			d = -d;
+		if (d > err)
+			err = d;
+	}
+	return err;
+}
+
+// single chain, each joint hanging from the one before it
+static inline a3boolean a3animationBenchmarkInternalCreateChain(a3_Hierarchy *hierarchy, a3_HierarchyPoseGroup *poseGroup, const a3ui32 nodeCount)
+{
+	a3byte name[a3node_nameSize];
+	a3ui32 i;
+	if (a3hierarchyCreate(hierarchy, nodeCount, 0) >= 0)
+	{
+		for (i = 0; i < nodeCount; ++i)
+		{
+			sprintf(name, "chain%u", i);
+			a3hierarchySetNode(hierarchy, i, (a3i32)i - 1, name);
+		}
+		if (a3hierarchyPoseGroupCreate(poseGroup, hierarchy, 1) >= 0)
+			return a3true;
+		a3hierarchyRelease(hierarchy);
+	}
+	return a3false;
+}
+
+// chain pose: unit offset along the bone, and if twisted, a few degrees 
+//	about x, y or z in turn, so no product is trivial
+static inline void a3animationBenchmarkInternalPoseChain(const a3_HierarchyState *state, const a3boolean twist)
+{
+	const a3ui32 nodeCount = state->poseGroup->hierarchy->numNodes;
+	a3real halfAngle;
+	a3quat *rotate;
+	a3ui32 i;
+	for (i = 0; i < nodeCount; ++i)
+	{
+		rotate = state->localPose->rotate + i;
+		halfAngle = twist ? (a3real)(1 + i % 5) * a3real_half : a3real_zero;
+		rotate->x = rotate->y = rotate->z = a3real_zero;
+		rotate->q[i % 3] = a3sind(halfAngle);
+		rotate->w = a3cosd(halfAngle);
+		state->localPose->translate[i].y = i ? a3real_one : a3real_zero;
+	}
+	a3hierarchyStateUpdateLocalSpace(state);
+}
+
+
+//-----------------------------------------------------------------------------
+
+// monotonic clock
+a3f64 a3animationBenchmarkTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER t, f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return ((a3f64)t.QuadPart / (a3f64)f.QuadPart);
+#else	// !_WIN32
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return ((a3f64)t.tv_sec + (a3f64)t.tv_nsec * 1.0e-9);
+#endif	// _WIN32
+}
+
+
+//-----------------------------------------------------------------------------
+
+// time FK on state
+a3i32 a3animationBenchmarkForward(a3_AnimationBenchmark *result_out, const a3_HierarchyState *state, const a3boolean affine, const a3ui32 passes)
+{
+	if (result_out && state && state->poseGroup && passes)
+	{
+		const a3ui32 numNodes = state->poseGroup->hierarchy->numNodes;
+		a3mat4 *reference = (a3mat4 *)malloc(sizeof(a3mat4) * numNodes);
+		a3f64 t0;
+		a3ui32 i;
+		if (!reference)
+			return -1;
+
+		// scalar reference; one untimed pass first so both paths start warm
+		a3kinematicsSolveForwardScalar(state, affine);
+		t0 = a3animationBenchmarkTime();
+		for (i = 0; i < passes; ++i)
+			a3kinematicsSolveForwardScalar(state, affine);
+		result_out->scalarTime = (a3animationBenchmarkTime() - t0) / (a3f64)passes;
+		memcpy(reference, state->objectSpace->transform, sizeof(a3mat4) * numNodes);
+
+		// vector path, every node marked as after a full pose change
+		for (i = 0; i <= passes; ++i)
+		{
+			if (i == 1)
+				t0 = a3animationBenchmarkTime();
+			a3hierarchyStateSetDirty(state, 0, numNodes);
+			if (affine)
+				a3kinematicsSolveForwardAffine(state);
+			else
+				a3kinematicsSolveForward(state);
+		}
+		result_out->vectorTime = (a3animationBenchmarkTime() - t0) / (a3f64)passes;
+
+		result_out->maxError = a3animationBenchmarkInternalMaxError(reference->mm, state->objectSpace->transform->mm, numNodes * 16);
+		result_out->count = numNodes;
+		result_out->passes = passes;
+		free(reference);
+		return numNodes;
+	}
+	return -1;
+}
+
+// time FK on synthetic chain
+a3i32 a3animationBenchmarkForwardChain(a3_AnimationBenchmark *result_out, const a3ui32 nodeCount, const a3boolean affine, const a3ui32 passes)
+{
+	if (result_out && nodeCount && passes)
+	{
+		a3_Hierarchy hierarchy[1] = { 0 };
+		a3_HierarchyPoseGroup poseGroup[1] = { 0 };
+		a3_HierarchyState state[1] = { 0 };
+		a3i32 ret = -1;
+		if (a3animationBenchmarkInternalCreateChain(hierarchy, poseGroup, nodeCount))
+		{
+			if (a3hierarchyStateCreate(state, poseGroup) >= 0)
+			{
+				a3animationBenchmarkInternalPoseChain(state, a3true);
+				ret = a3animationBenchmarkForward(result_out, state, affine, passes);
+				a3hierarchyStateRelease(state);
+			}
+			a3hierarchyPoseGroupRelease(poseGroup);
+			a3hierarchyRelease(hierarchy);
+		}
+		return ret;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+// time skinning job
+a3i32 a3animationBenchmarkSkinning(a3_AnimationBenchmark *result_out, const a3_SkinningJob *job, const a3boolean dualQuat, const a3ui32 passes)
+{
+	if (result_out && job && job->mesh && passes)
+	{
+		a3i32(*const skin)(const a3_SkinningJob *job) = dualQuat ? a3skinningDualQuat : a3skinningLinear;
+		a3i32(*const skinScalar)(const a3_SkinningJob *job) = dualQuat ? a3skinningDualQuatScalar : a3skinningLinearScalar;
+		a3vec3 *const output[4] = { job->position_out, job->normal_out, job->tangent_out, job->bitangent_out };
+		const a3ui32 vertexCount = job->mesh->vertexCount;
+		a3vec3 *reference;
+		a3f64 t0;
+		a3real err;
+		a3ui32 i;
+
+		// the untimed first pass also checks the job
+		if (skinScalar(job) < 0)
+			return -1;
+		reference = (a3vec3 *)malloc(sizeof(a3vec3) * vertexCount * 4);
+		if (!reference)
+			return -1;
+
+		t0 = a3animationBenchmarkTime();
+		for (i = 0; i < passes; ++i)
+			skinScalar(job);
+		result_out->scalarTime = (a3animationBenchmarkTime() - t0) / (a3f64)passes;
+		for (i = 0; i < 4; ++i)
+			if (output[i])
+				memcpy(reference + vertexCount * i, output[i], sizeof(a3vec3) * vertexCount);
+
+		skin(job);
+		t0 = a3animationBenchmarkTime();
+		for (i = 0; i < passes; ++i)
+			skin(job);
+		result_out->vectorTime = (a3animationBenchmarkTime() - t0) / (a3f64)passes;
+
+		result_out->maxError = a3real_zero;
+		for (i = 0; i < 4; ++i)
+			if (output[i])
+			{
+				err = a3animationBenchmarkInternalMaxError(reference[vertexCount * i].v, output[i]->v, vertexCount * 3);
+				result_out->maxError = a3maximum(result_out->maxError, err);
+			}
+		result_out->count = job->vertexCount;
+		result_out->passes = passes;
+		free(reference);
+		return job->vertexCount;
+	}
+	return -1;
+}
+
+// time skinning on synthetic chain mesh
+a3i32 a3animationBenchmarkSkinningChain(a3_AnimationBenchmark *result_out, const a3ui32 vertexCount, const a3ui32 nodeCount, const a3boolean dualQuat, const a3ui32 passes)
+{
+	if (result_out && vertexCount && nodeCount && passes)
+	{
+		a3_Hierarchy hierarchy[1] = { 0 };
+		a3_HierarchyPoseGroup poseGroup[1] = { 0 };
+		a3_HierarchyState bindState[1] = { 0 }, state[1] = { 0 };
+		a3_SkinMesh mesh[1] = { 0 };
+		a3_SkinningJob job[1];
+		const size_t paletteSize = sizeof(a3dualquat) * nodeCount;
+		const size_t streamSize = sizeof(a3vec3) * vertexCount;
+		const size_t weightSize = sizeof(a3vec4) * vertexCount;
+		const size_t indexSize = sizeof(a3i32) * a3skinning_influenceMax * vertexCount;
+		void *data;
+		a3ubyte *ptr;
+		a3dualquat *paletteDualQuat;
+		a3vec3 *stream;
+		a3vec4 *weight;
+		a3i32 *index, ret = -1;
+		a3ui32 i, j, k, c;
+
+		if (a3animationBenchmarkInternalCreateChain(hierarchy, poseGroup, nodeCount))
+		{
+			if (a3hierarchyStateCreate(bindState, poseGroup) >= 0 && a3hierarchyStateCreate(state, poseGroup) >= 0)
+			{
+				// bound straight, skinned twisted
+				a3animationBenchmarkInternalPoseChain(bindState, a3false);
+				a3kinematicsSolveForward(bindState);
+				a3hierarchyStateUpdateObjectInverse(bindState, a3hierarchyScale_ignore);
+				a3animationBenchmarkInternalPoseChain(state, a3true);
+				a3kinematicsSolveForward(state);
+				a3hierarchyStateUpdateObjectBindToCurrent(state, bindState->objectSpaceInverse);
+
+				// dual quaternion palette first so it is 16-byte aligned
+				data = malloc(paletteSize + streamSize * 8 + weightSize + indexSize + 15);
+				if (data)
+				{
+					ptr = (a3ubyte *)(((size_t)data + 15) & ~(size_t)15);
+					paletteDualQuat = (a3dualquat *)ptr;
+					stream = (a3vec3 *)(ptr + paletteSize);
+					weight = (a3vec4 *)(stream + vertexCount * 8);
+					index = (a3i32 *)(weight + vertexCount);
+
+					// vertex i sits around bone i mod node count, with weight 
+					//	spread over its neighbors in the chain
+					for (i = 0; i < vertexCount; ++i)
+					{
+						j = i % nodeCount;
+						c = 1 + i % a3skinning_influenceMax;
+						stream[i].x = (a3real)((a3i32)(i * 7 % 11) - 5) * (a3real)0.05;
+						stream[i].y = (a3real)j + (a3real)(i / nodeCount % 8) * (a3real)0.125;
+						stream[i].z = (a3real)((a3i32)(i * 5 % 13) - 6) * (a3real)0.05;
+						stream[vertexCount + i] = a3vec3_x;
+						stream[vertexCount * 2 + i] = a3vec3_y;
+						stream[vertexCount * 3 + i] = a3vec3_z;
+						for (k = 0; k < a3skinning_influenceMax; ++k)
+						{
+							weight[i].v[k] = k < c ? (a3real)(c - k) / (a3real)(c * (c + 1) / 2) : a3real_zero;
+							index[i * a3skinning_influenceMax + k] = k < c ? (a3i32)a3minimum(j + k, nodeCount - 1) : (a3i32)j;
+						}
+					}
+					mesh->position = stream;
+					mesh->normal = stream + vertexCount;
+					mesh->tangent = stream + vertexCount * 2;
+					mesh->bitangent = stream + vertexCount * 3;
+					mesh->blendWeight = weight;
+					mesh->blendIndex = index;
+					mesh->vertexCount = vertexCount;
+					mesh->paletteCount = nodeCount;
+					mesh->bucketOffset[a3skinning_influenceMax] = vertexCount;
+
+					a3skinningJobInit(job, mesh, state, stream + vertexCount * 4, stream + vertexCount * 5, stream + vertexCount * 6, stream + vertexCount * 7);
+					a3skinningPaletteDualQuat(paletteDualQuat, job->palette, nodeCount);
+					job->paletteDualQuat = paletteDualQuat;
+					ret = a3animationBenchmarkSkinning(result_out, job, dualQuat, passes);
+					free(data);
+				}
+			}
+			a3hierarchyStateRelease(state);
+			a3hierarchyStateRelease(bindState);
+			a3hierarchyPoseGroupRelease(poseGroup);
+			a3hierarchyRelease(hierarchy);
+		}
+		return ret;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,417 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationCache.c
+	Implementation of memory-mappable animation cache.
+*/
+
+#include "../a3_AnimationCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else	// !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+
+// sections start on 16-byte boundaries
+#define A3_ANIMATIONCACHE_ALIGN		16
+#define a3animationCacheInternalAlign(sz)	(((sz) + (A3_ANIMATIONCACHE_ALIGN - 1)) & ~(A3_ANIMATIONCACHE_ALIGN - 1))
+
+// cache sections in file order
+enum a3_AnimationCacheInternalSection
+{
+	a3cache_parentIndex,
+	a3cache_nodeName,
+	a3cache_rotate,
+	a3cache_translate,
+	a3cache_scale,
+	a3cache_keyframe,
+	a3cache_clip,
+
+	a3cache_sectionMax
+};
+
+// file header
+typedef struct a3_AnimationCacheInternalHeader
+{
+	a3byte tag[4];
+	a3ui32 version;
+	a3ui32 fileSize;
+	a3ui32 nodeCount, poseCount, keyframeCount, clipCount;
+	a3ui32 offset[a3cache_sectionMax];
+} a3_AnimationCacheInternalHeader;
+
+// stored keyframe and clip records; pool structures hold pointers, so only 
+//	the values needed to rebuild them are stored
+typedef struct a3_AnimationCacheInternalKeyframe
+{
+	a3real duration;
+	a3ui32 data;
+} a3_AnimationCacheInternalKeyframe;
+
+typedef struct a3_AnimationCacheInternalClip
+{
+	a3byte name[a3keyframeAnimation_nameLenMax];
+	a3ui32 keyframeIndex_first, keyframeIndex_final;
+	a3_ClipTransition transitionForward, transitionReverse;
+} a3_AnimationCacheInternalClip;
+
+// read-only file view
+typedef struct a3_AnimationCacheInternalMapping
+{
+	const a3ubyte *view;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file, mapping;
+#endif	// _WIN32
+} a3_AnimationCacheInternalMapping;
+
+static const a3byte a3animationCacheInternalTag[4] = { 'A', '3', 'A', 'C' };
+
+
+//-----------------------------------------------------------------------------
+
+// get modification time, zero if missing
+static inline a3i64 a3animationCacheInternalGetTime(const a3byte *filePath)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (filePath && !_stat64(filePath, &info))
+		return (a3i64)info.st_mtime;
+#else	// !_WIN32
+	struct stat info;
+	if (filePath && !stat(filePath, &info))
+		return (a3i64)info.st_mtime;
+#endif	// _WIN32
+	return 0;
+}
+
+// pad section of given size to next boundary
+static inline a3ui32 a3animationCacheInternalPad(FILE *fp, const a3ui32 size)
+{
+	static const a3ubyte pad[A3_ANIMATIONCACHE_ALIGN] = { 0 };
+	return (a3ui32)fwrite(pad, 1, a3animationCacheInternalAlign(size) - size, fp);
+}
+
+// write whole section with padding
+static inline a3ui32 a3animationCacheInternalWrite(FILE *fp, const void *data, const a3ui32 size)
+{
+	return ((a3ui32)fwrite(data, 1, size, fp) + a3animationCacheInternalPad(fp, size));
+}
+
+// map whole file read-only
+static inline a3_AnimationCacheInternalMapping *a3animationCacheInternalMap(const a3byte *filePath)
+{
+	a3_AnimationCacheInternalMapping *mapping = (a3_AnimationCacheInternalMapping *)malloc(sizeof(a3_AnimationCacheInternalMapping));
+#ifdef _WIN32
+	LARGE_INTEGER size;
+#else	// !_WIN32
+	struct stat info;
+	void *view;
+	int fd;
+#endif	// _WIN32
+	if (mapping)
+	{
+		memset(mapping, 0, sizeof(a3_AnimationCacheInternalMapping));
+#ifdef _WIN32
+		mapping->file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (mapping->file != INVALID_HANDLE_VALUE)
+		{
+			if (GetFileSizeEx(mapping->file, &size) && size.QuadPart > 0)
+			{
+				mapping->size = (size_t)size.QuadPart;
+				mapping->mapping = CreateFileMappingA(mapping->file, 0, PAGE_READONLY, 0, 0, 0);
+				if (mapping->mapping)
+				{
+					mapping->view = (const a3ubyte *)MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0);
+					if (mapping->view)
+						return mapping;
+					CloseHandle(mapping->mapping);
+				}
+			}
+			CloseHandle(mapping->file);
+		}
+#else	// !_WIN32
+		fd = open(filePath, O_RDONLY);
+		if (fd >= 0)
+		{
+			if (!fstat(fd, &info) && info.st_size > 0)
+			{
+				mapping->size = (size_t)info.st_size;
+				view = mmap(0, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (view != MAP_FAILED)
+				{
+					// the mapping stays valid after the descriptor closes
+					mapping->view = (const a3ubyte *)view;
+					close(fd);
+					return mapping;
+				}
+			}
+			close(fd);
+		}
+#endif	// _WIN32
+		free(mapping);
+	}
+	return 0;
+}
+
+
+// check that a section of count0 * count1 elements lies within the file; 
+//	written as divisions so that no product can overflow
+static inline a3boolean a3animationCacheInternalFits(const a3_AnimationCacheInternalHeader *header, const a3ui32 section, const a3ui32 count0, const a3ui32 count1, const a3ui32 elemSize)
+{
+	const a3ui32 offset = header->offset[section];
+	a3ui32 capacity;
+	if (offset % A3_ANIMATIONCACHE_ALIGN || offset > header->fileSize)
+		return a3false;
+	capacity = (header->fileSize - offset) / elemSize;
+	return (count0 <= capacity && (!count0 || count1 <= capacity / count0));
+}
+
+// check that a stored transition only refers to stored clips and keyframes
+static inline a3boolean a3animationCacheInternalValidTransition(const a3_ClipTransition *transition, const a3_AnimationCacheInternalHeader *header)
+{
+	return (transition->clip < header->clipCount && transition->keyframe < header->keyframeCount);
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3animationCacheSave(const a3_HierarchyPoseGroup *poseGroup, const a3_KeyframePool *keyframePool_opt, const a3_ClipPool *clipPool_opt, const a3byte *cacheFilePath)
+{
+	if (poseGroup && poseGroup->hierarchy && cacheFilePath && *cacheFilePath)
+	{
+		const a3_Hierarchy *hierarchy = poseGroup->hierarchy;
+		const a3ui32 count = poseGroup->poseCount * hierarchy->numNodes;
+		a3_AnimationCacheInternalHeader header = { 0 };
+		a3_AnimationCacheInternalKeyframe keyframe;
+		a3_AnimationCacheInternalClip clip;
+		a3ui32 size[a3cache_sectionMax], i, ret = 0;
+		FILE *fp;
+
+		// layout
+		memcpy(header.tag, a3animationCacheInternalTag, sizeof(header.tag));
+		header.version = a3animationCache_version;
+		header.nodeCount = hierarchy->numNodes;
+		header.poseCount = poseGroup->poseCount;
+		header.keyframeCount = (keyframePool_opt && keyframePool_opt->keyframe) ? keyframePool_opt->count : 0;
+		header.clipCount = (clipPool_opt && clipPool_opt->clip) ? clipPool_opt->count : 0;
+		size[a3cache_parentIndex] = sizeof(a3i32) * header.nodeCount;
+		size[a3cache_nodeName] = a3node_nameSize * header.nodeCount;
+		size[a3cache_rotate] = sizeof(a3quat) * count;
+		size[a3cache_translate] = sizeof(a3vec3) * count;
+		size[a3cache_scale] = sizeof(a3vec3) * count;
+		size[a3cache_keyframe] = sizeof(a3_AnimationCacheInternalKeyframe) * header.keyframeCount;
+		size[a3cache_clip] = sizeof(a3_AnimationCacheInternalClip) * header.clipCount;
+		header.fileSize = a3animationCacheInternalAlign(sizeof(header));
+		for (i = 0; i < a3cache_sectionMax; ++i)
+		{
+			header.offset[i] = header.fileSize;
+			header.fileSize += a3animationCacheInternalAlign(size[i]);
+		}
+
+		fp = fopen(cacheFilePath, "wb");
+		if (fp)
+		{
+			ret += a3animationCacheInternalWrite(fp, &header, sizeof(header));
+			ret += a3animationCacheInternalWrite(fp, hierarchy->parentIndex, size[a3cache_parentIndex]);
+			ret += a3animationCacheInternalWrite(fp, hierarchy->nodeName, size[a3cache_nodeName]);
+			ret += a3animationCacheInternalWrite(fp, poseGroup->rotate, size[a3cache_rotate]);
+			ret += a3animationCacheInternalWrite(fp, poseGroup->translate, size[a3cache_translate]);
+			ret += a3animationCacheInternalWrite(fp, poseGroup->scale, size[a3cache_scale]);
+			for (i = 0; i < header.keyframeCount; ++i)
+			{
+				keyframe.duration = keyframePool_opt->keyframe[i].duration;
+				keyframe.data = keyframePool_opt->keyframe[i].data;
+				ret += (a3ui32)fwrite(&keyframe, 1, sizeof(keyframe), fp);
+			}
+			ret += a3animationCacheInternalPad(fp, size[a3cache_keyframe]);
+			for (i = 0; i < header.clipCount; ++i)
+			{
+				memcpy(clip.name, clipPool_opt->clip[i].name, sizeof(clip.name));
+				clip.keyframeIndex_first = clipPool_opt->clip[i].keyframeIndex_first;
+				clip.keyframeIndex_final = clipPool_opt->clip[i].keyframeIndex_final;
+				clip.transitionForward = clipPool_opt->clip[i].transitionForward;
+				clip.transitionReverse = clipPool_opt->clip[i].transitionReverse;
+				ret += (a3ui32)fwrite(&clip, 1, sizeof(clip), fp);
+			}
+			ret += a3animationCacheInternalPad(fp, size[a3cache_clip]);
+			fclose(fp);
+			return ret;
+		}
+		printf("\n A3 Warning: Could not write animation cache \'%s\'.", cacheFilePath);
+	}
+	return -1;
+}
+
+a3i32 a3animationCacheLoad(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, a3_KeyframePool *keyframePool_out_opt, a3_ClipPool *clipPool_out_opt, const a3byte *cacheFilePath)
+{
+	if (poseGroup_out && !poseGroup_out->hierarchy && hierarchy_out && !hierarchy_out->parentIndex && cacheFilePath && *cacheFilePath && 
+		(!keyframePool_out_opt || !keyframePool_out_opt->keyframe) && (!clipPool_out_opt || !clipPool_out_opt->clip))
+	{
+		a3_AnimationCacheInternalMapping *mapping = a3animationCacheInternalMap(cacheFilePath);
+		const a3_AnimationCacheInternalHeader *header;
+		const a3_AnimationCacheInternalKeyframe *keyframe;
+		const a3_AnimationCacheInternalClip *clip;
+		const a3i32 *parentIndex;
+		const a3byte *name;
+		a3ui32 i, j;
+		a3boolean failed;
+		if (mapping)
+		{
+			// validate before touching anything else
+			header = (const a3_AnimationCacheInternalHeader *)mapping->view;
+			failed = !(mapping->size >= sizeof(*header) &&
+				!memcmp(header->tag, a3animationCacheInternalTag, sizeof(header->tag)) &&
+				header->version == a3animationCache_version &&
+				header->fileSize == mapping->size && header->nodeCount && header->poseCount &&
+				a3animationCacheInternalFits(header, a3cache_parentIndex, header->nodeCount, 1, sizeof(a3i32)) &&
+				a3animationCacheInternalFits(header, a3cache_nodeName, header->nodeCount, 1, a3node_nameSize) &&
+				a3animationCacheInternalFits(header, a3cache_rotate, header->poseCount, header->nodeCount, sizeof(a3quat)) &&
+				a3animationCacheInternalFits(header, a3cache_translate, header->poseCount, header->nodeCount, sizeof(a3vec3)) &&
+				a3animationCacheInternalFits(header, a3cache_scale, header->poseCount, header->nodeCount, sizeof(a3vec3)) &&
+				a3animationCacheInternalFits(header, a3cache_keyframe, header->keyframeCount, 1, sizeof(a3_AnimationCacheInternalKeyframe)) &&
+				a3animationCacheInternalFits(header, a3cache_clip, header->clipCount, 1, sizeof(a3_AnimationCacheInternalClip)));
+
+			// hierarchy is copied so it has its own lookup tables
+			if (!failed)
+			{
+				parentIndex = (const a3i32 *)(mapping->view + header->offset[a3cache_parentIndex]);
+				name = (const a3byte *)(mapping->view + header->offset[a3cache_nodeName]);
+				failed = a3hierarchyCreate(hierarchy_out, header->nodeCount, 0) < 0;
+				for (i = 0; !failed && i < header->nodeCount; ++i, name += a3node_nameSize)
+					failed = parentIndex[i] < -1 || a3hierarchySetNode(hierarchy_out, i, parentIndex[i], name) < 0;
+			}
+
+			// pose group views channels in place; only pose views are 
+			//	allocated; the view has no write access, so the mutable 
+			//	channel pointers must only be read (a write faults)
+			if (!failed)
+			{
+				poseGroup_out->data = malloc(sizeof(a3_HierarchyPose) * header->poseCount);
+				failed = !poseGroup_out->data;
+			}
+			if (!failed)
+			{
+				poseGroup_out->hpose = (a3_HierarchyPose *)poseGroup_out->data;
+				poseGroup_out->rotate = (a3quat *)(mapping->view + header->offset[a3cache_rotate]);
+				poseGroup_out->translate = (a3vec3 *)(mapping->view + header->offset[a3cache_translate]);
+				poseGroup_out->scale = (a3vec3 *)(mapping->view + header->offset[a3cache_scale]);
+				poseGroup_out->poseCount = header->poseCount;
+				poseGroup_out->hierarchy = hierarchy_out;
+				poseGroup_out->mapping = mapping;
+				for (i = j = 0; i < header->poseCount; ++i, j += header->nodeCount)
+				{
+					poseGroup_out->hpose[i].rotate = poseGroup_out->rotate + j;
+					poseGroup_out->hpose[i].translate = poseGroup_out->translate + j;
+					poseGroup_out->hpose[i].scale = poseGroup_out->scale + j;
+				}
+			}
+
+			// pools are rebuilt from stored values; requested pools that 
+			//	are stored but cannot be rebuilt fail the whole load
+			if (!failed && keyframePool_out_opt && header->keyframeCount)
+			{
+				failed = a3keyframePoolCreate(keyframePool_out_opt, header->keyframeCount) < 0;
+				keyframe = (const a3_AnimationCacheInternalKeyframe *)(mapping->view + header->offset[a3cache_keyframe]);
+				for (i = 0; !failed && i < header->keyframeCount; ++i)
+					failed = a3keyframeInit(keyframePool_out_opt->keyframe + i, keyframe[i].duration, keyframe[i].data) < 0;
+				if (!failed)
+					a3keyframePoolCalculateTime(keyframePool_out_opt, 0);
+			}
+			if (!failed && keyframePool_out_opt && clipPool_out_opt && header->keyframeCount && header->clipCount)
+			{
+				failed = a3clipPoolCreate(clipPool_out_opt, header->clipCount) < 0;
+				clip = (const a3_AnimationCacheInternalClip *)(mapping->view + header->offset[a3cache_clip]);
+				for (i = 0; !failed && i < header->clipCount; ++i)
+				{
+					failed = !a3animationCacheInternalValidTransition(&clip[i].transitionForward, header) || 
+						!a3animationCacheInternalValidTransition(&clip[i].transitionReverse, header) || 
+						a3clipInit(clipPool_out_opt, i, clip[i].name, keyframePool_out_opt, clip[i].keyframeIndex_first, clip[i].keyframeIndex_final) < 0;
+					if (!failed)
+					{
+						clipPool_out_opt->clip[i].transitionForward = clip[i].transitionForward;
+						clipPool_out_opt->clip[i].transitionReverse = clip[i].transitionReverse;
+					}
+				}
+				if (!failed)
+					a3clipPoolCalculateRate(clipPool_out_opt);
+			}
+
+			// done
+			if (!failed)
+				return poseGroup_out->poseCount;
+
+			// pose group release also unmaps, if it got that far
+			printf("\n A3 Warning: Ignoring invalid or outdated animation cache \'%s\'.", cacheFilePath);
+			if (clipPool_out_opt)
+				a3clipPoolRelease(clipPool_out_opt);
+			if (keyframePool_out_opt)
+				a3keyframePoolRelease(keyframePool_out_opt);
+			if (poseGroup_out->hierarchy)
+				a3hierarchyPoseGroupRelease(poseGroup_out);
+			else
+			{
+				free(poseGroup_out->data);
+				poseGroup_out->data = 0;
+				a3animationCacheUnmap(mapping);
+			}
+			a3hierarchyRelease(hierarchy_out);
+		}
+	}
+	return -1;
+}
+
+a3boolean a3animationCacheIsStale(const a3byte *cacheFilePath, const a3byte *sourceFilePath)
+{
+	const a3i64 cacheTime = a3animationCacheInternalGetTime(cacheFilePath);
+	return (!cacheTime || cacheTime < a3animationCacheInternalGetTime(sourceFilePath));
+}
+
+a3i32 a3animationCacheUnmap(void *mapping)
+{
+	a3_AnimationCacheInternalMapping *const m = (a3_AnimationCacheInternalMapping *)mapping;
+	if (m)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m->view);
+		CloseHandle(m->mapping);
+		CloseHandle(m->file);
+#else	// !_WIN32
+		munmap((void *)m->view, m->size);
+#endif	// _WIN32
+		free(m);
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
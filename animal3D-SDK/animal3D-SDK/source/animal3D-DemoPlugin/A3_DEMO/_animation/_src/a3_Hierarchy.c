@@ -34,21 +34,172 @@
 
 //-----------------------------------------------------------------------------
 
-inline a3ret a3hierarchyInternalGetIndex(const a3_Hierarchy *hierarchy, const a3byte name[a3node_nameSize])
+// 32-bit FNV-1a over the name string
+static inline a3ui32 a3hierarchyInternalHashName(const a3byte name[a3node_nameSize])
+{
+	a3ui32 i, hash = 2166136261u;
+	for (i = 0; i < a3node_nameSize && name[i]; ++i)
+		hash = (hash ^ (a3ubyte)name[i]) * 16777619u;
+	return hash;
+}
+
+// name table: unnamed nodes are never indexed
+static inline void a3hierarchyInternalInsertName(const a3_Hierarchy *hierarchy, const a3ui32 index)
+{
+	const a3ui32 bucket = (hierarchy->nameHash[index] = a3hierarchyInternalHashName(hierarchy->nodeName[index])) & hierarchy->nameBucketMask;
+	if (*hierarchy->nodeName[index])
+	{
+		hierarchy->nameNext[index] = hierarchy->nameBucket[bucket];
+		hierarchy->nameBucket[bucket] = index;
+	}
+}
+
+static inline void a3hierarchyInternalRemoveName(const a3_Hierarchy *hierarchy, const a3ui32 index)
+{
+	a3i32 *link = hierarchy->nameBucket + (hierarchy->nameHash[index] & hierarchy->nameBucketMask);
+	while (*link >= 0 && *link != (a3i32)index)
+		link = hierarchy->nameNext + *link;
+	if (*link >= 0)
+		*link = hierarchy->nameNext[index];
+	hierarchy->nameNext[index] = -1;
+}
+
+static inline a3ret a3hierarchyInternalGetIndexHashed(const a3_Hierarchy *hierarchy, const a3ui32 nameHash, const a3byte name[a3node_nameSize])
+{
+	// lowest matching index wins, as with a linear scan
+	a3i32 i = hierarchy->nameBucket[nameHash & hierarchy->nameBucketMask], ret = -1;
+	for (; i >= 0; i = hierarchy->nameNext[i])
+		if (hierarchy->nameHash[i] == nameHash && (!name || !strncmp(hierarchy->nodeName[i], name, a3node_nameSize)))
+			if (ret < 0 || i < ret)
+				ret = i;
+	return ret;
+}
+
+static inline a3ret a3hierarchyInternalGetIndex(const a3_Hierarchy *hierarchy, const a3byte name[a3node_nameSize])
 {
 	a3ui32 i;
+	if (*name && hierarchy->nameBucket)
+		return a3hierarchyInternalGetIndexHashed(hierarchy, a3hierarchyInternalHashName(name), name);
 	for (i = 0; i < hierarchy->numNodes; ++i)
-		if (!strncmp(hierarchy->nodes[i].name, name, a3node_nameSize))
+		if (!strncmp(hierarchy->nodeName[i], name, a3node_nameSize))
 			return i;
 	return -1;
 }
 
-inline void a3hierarchyInternalSetNode(a3_HierarchyNode *node, const a3ui32 index, const a3i32 parentIndex, const a3byte name[a3node_nameSize])
+// allocate dense parent array with the name blob after it; callers only 
+//	clear the parent array, so every derived table starts out empty
+static inline a3boolean a3hierarchyInternalCreateNodes(a3_Hierarchy *hierarchy, const a3ui32 numNodes)
+{
+	hierarchy->nodeName = 0;
+	hierarchy->numNodes = 0;
+	hierarchy->levelNodeIndex = hierarchy->levelOffset = hierarchy->nodeLevel = 0;
+	hierarchy->numLevels = 0;
+	hierarchy->subtreeFirst = hierarchy->subtreeEnd = hierarchy->childOffset = hierarchy->childIndex = 0;
+	hierarchy->isDepthFirst = 0;
+	hierarchy->nameHash = 0;
+	hierarchy->nameNext = hierarchy->nameBucket = 0;
+	hierarchy->nameBucketMask = 0;
+	hierarchy->parentIndex = (a3i32 *)malloc((sizeof(a3i32) + a3node_nameSize) * numNodes);
+	if (hierarchy->parentIndex)
+	{
+		hierarchy->nodeName = (a3byte(*)[a3node_nameSize])(hierarchy->parentIndex + numNodes);
+		hierarchy->numNodes = numNodes;
+		return 1;
+	}
+	return 0;
+}
+
+// allocate empty name table, at least two buckets per node
+static inline a3boolean a3hierarchyInternalCreateNameTable(a3_Hierarchy *hierarchy)
+{
+	a3ui32 bucketCount = 1;
+	while (bucketCount < hierarchy->numNodes * 2)
+		bucketCount <<= 1;
+	hierarchy->nameHash = (a3ui32 *)malloc(sizeof(a3ui32) * hierarchy->numNodes * 2 + sizeof(a3i32) * bucketCount);
+	if (!hierarchy->nameHash)
+		return 0;
+	hierarchy->nameNext = (a3i32 *)(hierarchy->nameHash + hierarchy->numNodes);
+	hierarchy->nameBucket = hierarchy->nameNext + hierarchy->numNodes;
+	hierarchy->nameBucketMask = bucketCount - 1;
+	memset(hierarchy->nameHash, 0, sizeof(a3ui32) * hierarchy->numNodes);
+	memset(hierarchy->nameNext, -1, sizeof(a3i32) * hierarchy->numNodes);
+	memset(hierarchy->nameBucket, -1, sizeof(a3i32) * bucketCount);
+	return 1;
+}
+
+// index every node name
+static inline a3boolean a3hierarchyInternalBuildNameTable(a3_Hierarchy *hierarchy)
+{
+	a3ui32 i;
+	if (!a3hierarchyInternalCreateNameTable(hierarchy))
+		return 0;
+	for (i = hierarchy->numNodes; i > 0; --i)
+		a3hierarchyInternalInsertName(hierarchy, i - 1);
+	return 1;
+}
+
+static inline void a3hierarchyInternalSetNode(const a3_Hierarchy *hierarchy, const a3ui32 index, const a3i32 parentIndex, const a3byte name[a3node_nameSize])
 {
-	strncpy(node->name, name, a3node_nameSize);
-	node->name[a3node_nameSize - 1] = 0;
-	node->index = index;
-	node->parentIndex = parentIndex;
+	strncpy(hierarchy->nodeName[index], name, a3node_nameSize);
+	hierarchy->nodeName[index][a3node_nameSize - 1] = 0;
+	hierarchy->parentIndex[index] = parentIndex;
+}
+
+// split serialization: tag, version and node count, dense parent array, 
+//	then name blob (node index is implied by position)
+typedef struct a3_HierarchyInternalStreamHeader
+{
+	a3byte tag[4];
+	a3ui32 version;
+	a3ui32 numNodes;
+} a3_HierarchyInternalStreamHeader;
+
+static const a3byte a3hierarchyInternalStreamTag[4] = { 'A', '3', 'H', 'R' };
+
+static inline a3ui32 a3hierarchyInternalGetSplitSize(const a3ui32 numNodes)
+{
+	return (sizeof(a3_HierarchyInternalStreamHeader) + (sizeof(a3i32) + a3node_nameSize) * numNodes);
+}
+
+static inline void a3hierarchyInternalSetStreamHeader(a3_HierarchyInternalStreamHeader *header_out, const a3ui32 numNodes)
+{
+	memcpy(header_out->tag, a3hierarchyInternalStreamTag, sizeof(header_out->tag));
+	header_out->version = a3hierarchy_streamVersion;
+	header_out->numNodes = numNodes;
+}
+
+static inline a3boolean a3hierarchyInternalValidStreamHeader(const a3_HierarchyInternalStreamHeader *header)
+{
+	if (memcmp(header->tag, a3hierarchyInternalStreamTag, sizeof(header->tag)) || header->version != a3hierarchy_streamVersion)
+	{
+		printf("\n A3 ERROR: Hierarchy stream has wrong tag or version (expected %u).", (a3ui32)a3hierarchy_streamVersion);
+		return 0;
+	}
+	return (header->numNodes > 0);
+}
+
+// after reading the split form: terminate names, check that parents come 
+//	first (as a3hierarchySetNode requires) and index names; releases the 
+//	hierarchy if anything is wrong
+static inline a3boolean a3hierarchyInternalFinishStream(a3_Hierarchy *hierarchy)
+{
+	a3ui32 i;
+	for (i = 0; i < hierarchy->numNodes; ++i)
+	{
+		hierarchy->nodeName[i][a3node_nameSize - 1] = 0;
+		if (hierarchy->parentIndex[i] < -1 || hierarchy->parentIndex[i] >= (a3i32)i)
+		{
+			printf("\n A3 ERROR: Hierarchy stream has a node listed before its parent.");
+			a3hierarchyRelease(hierarchy);
+			return 0;
+		}
+	}
+	if (!a3hierarchyInternalBuildNameTable(hierarchy))
+	{
+		a3hierarchyRelease(hierarchy);
+		return 0;
+	}
+	return 1;
 }
 
 
@@ -58,14 +209,20 @@ a3ret a3hierarchyCreate(a3_Hierarchy *hierarchy_out, const a3ui32 numNodes, cons
 {
 	if (hierarchy_out && numNodes)
 	{
-		if (!hierarchy_out->nodes)
+		if (!hierarchy_out->parentIndex)
 		{
-			const a3ui32 dataSize = sizeof(a3_HierarchyNode) * numNodes;
 			a3ui32 i;
 			const a3byte *tmpName;
-			hierarchy_out->nodes = (a3_HierarchyNode *)malloc(dataSize);
-			memset(hierarchy_out->nodes, 0, dataSize);
-			hierarchy_out->numNodes = numNodes;
+			if (!a3hierarchyInternalCreateNodes(hierarchy_out, numNodes))
+				return -1;
+			memset(hierarchy_out->nodeName, 0, a3node_nameSize * numNodes);
+			for (i = 0; i < numNodes; ++i)
+				hierarchy_out->parentIndex[i] = -1;
+			if (!a3hierarchyInternalCreateNameTable(hierarchy_out))
+			{
+				a3hierarchyRelease(hierarchy_out);
+				return -1;
+			}
 			if (names_opt)
 			{
 				for (i = 0; i < numNodes; ++i)
@@ -73,8 +230,9 @@ a3ret a3hierarchyCreate(a3_Hierarchy *hierarchy_out, const a3ui32 numNodes, cons
 					{
 						if (a3hierarchyInternalGetIndex(hierarchy_out, tmpName) < 0)
 						{
-							strncpy(hierarchy_out->nodes[i].name, tmpName, a3node_nameSize);
-							hierarchy_out->nodes[i].name[a3node_nameSize - 1] = 0;
+							strncpy(hierarchy_out->nodeName[i], tmpName, a3node_nameSize);
+							hierarchy_out->nodeName[i][a3node_nameSize - 1] = 0;
+							a3hierarchyInternalInsertName(hierarchy_out, i);
 						}
 						else
 							printf("\n A3 Warning: Ignoring duplicate name string passed to hierarchy allocator.");
@@ -90,15 +248,20 @@ a3ret a3hierarchyCreate(a3_Hierarchy *hierarchy_out, const a3ui32 numNodes, cons
 
 a3ret a3hierarchySetNode(const a3_Hierarchy *hierarchy, const a3ui32 index, const a3i32 parentIndex, const a3byte name[a3node_nameSize])
 {
-	a3_HierarchyNode *node;
 	if (hierarchy)
 	{
-		if (hierarchy->nodes && index < hierarchy->numNodes)
+		if (hierarchy->parentIndex && index < hierarchy->numNodes)
 		{
 			if ((a3i32)index > parentIndex)
 			{
-				node = hierarchy->nodes + index;
-				a3hierarchyInternalSetNode(node, index, parentIndex, name);
+				if (hierarchy->nameBucket)
+				{
+					a3hierarchyInternalRemoveName(hierarchy, index);
+					a3hierarchyInternalSetNode(hierarchy, index, parentIndex, name);
+					a3hierarchyInternalInsertName(hierarchy, index);
+				}
+				else
+					a3hierarchyInternalSetNode(hierarchy, index, parentIndex, name);
 				return index;
 			}
 			else
@@ -111,39 +274,187 @@ a3ret a3hierarchySetNode(const a3_Hierarchy *hierarchy, const a3ui32 index, cons
 a3ret a3hierarchyGetNodeIndex(const a3_Hierarchy *hierarchy, const a3byte name[a3node_nameSize])
 {
 	if (hierarchy)
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 			return a3hierarchyInternalGetIndex(hierarchy, name);
 	return -1;
 }
 
+a3ui32 a3hierarchyHashName(const a3byte name[a3node_nameSize])
+{
+	if (name)
+		return a3hierarchyInternalHashName(name);
+	return 0;
+}
+
+a3ret a3hierarchyGetNodeIndexByHash(const a3_Hierarchy *hierarchy, const a3ui32 nameHash, const a3byte name_opt[a3node_nameSize])
+{
+	if (hierarchy)
+		if (hierarchy->parentIndex && hierarchy->nameBucket)
+			return a3hierarchyInternalGetIndexHashed(hierarchy, nameHash, name_opt);
+	return -1;
+}
+
 a3ret a3hierarchyGetNodeNames(const a3byte *nameList_out[], const a3_Hierarchy *hierarchy)
 {
 	a3ui32 i;
 	if (hierarchy && nameList_out)
 	{
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 		{
 			for (i = 0; i < hierarchy->numNodes; ++i)
-				nameList_out[i] = hierarchy->nodes[i].name;
+				nameList_out[i] = hierarchy->nodeName[i];
 			return hierarchy->numNodes;
 		}
 	}
 	return -1;
 }
 
+a3ret a3hierarchyBuildLevels(a3_Hierarchy *hierarchy)
+{
+	a3ui32 i, j, level, numLevels;
+	a3i32 parentIndex;
+	if (hierarchy)
+	{
+		if (hierarchy->parentIndex)
+		{
+			// one block: level node list, depth per node, offsets (at most 
+			//	one level per node, plus terminator)
+			free(hierarchy->levelNodeIndex);
+			hierarchy->levelNodeIndex = (a3ui32 *)malloc(sizeof(a3ui32) * (hierarchy->numNodes * 3 + 1));
+			if (!hierarchy->levelNodeIndex)
+			{
+				hierarchy->levelOffset = hierarchy->nodeLevel = 0;
+				hierarchy->numLevels = 0;
+				return -1;
+			}
+			hierarchy->nodeLevel = hierarchy->levelNodeIndex + hierarchy->numNodes;
+			hierarchy->levelOffset = hierarchy->nodeLevel + hierarchy->numNodes;
+
+			// parents precede children, so depth is known in one pass
+			for (i = numLevels = 0; i < hierarchy->numNodes; ++i)
+			{
+				parentIndex = hierarchy->parentIndex[i];
+				level = parentIndex >= 0 ? hierarchy->nodeLevel[parentIndex] + 1 : 0;
+				hierarchy->nodeLevel[i] = level;
+				if (level >= numLevels)
+					numLevels = level + 1;
+			}
+			hierarchy->numLevels = numLevels;
+
+			// count sort by level, stable so index order is kept in a level
+			memset(hierarchy->levelOffset, 0, sizeof(a3ui32) * (numLevels + 1));
+			for (i = 0; i < hierarchy->numNodes; ++i)
+				++hierarchy->levelOffset[hierarchy->nodeLevel[i] + 1];
+			for (level = 0; level < numLevels; ++level)
+				hierarchy->levelOffset[level + 1] += hierarchy->levelOffset[level];
+			for (i = 0; i < hierarchy->numNodes; ++i)
+			{
+				level = hierarchy->nodeLevel[i];
+				j = hierarchy->levelOffset[level]++;
+				hierarchy->levelNodeIndex[j] = i;
+			}
+
+			// placement shifted offsets up by one level; shift back
+			for (level = numLevels; level > 0; --level)
+				hierarchy->levelOffset[level] = hierarchy->levelOffset[level - 1];
+			hierarchy->levelOffset[0] = 0;
+
+			return numLevels;
+		}
+	}
+	return -1;
+}
+
+a3ret a3hierarchyBuildSubtrees(a3_Hierarchy *hierarchy)
+{
+	a3ui32 i, j, k, n, position;
+	a3i32 parentIndex;
+	if (hierarchy)
+	{
+		if (hierarchy->parentIndex)
+		{
+			// one block: preorder position, subtree end, child offsets, 
+			//	child list
+			n = hierarchy->numNodes;
+			free(hierarchy->subtreeFirst);
+			hierarchy->subtreeFirst = (a3ui32 *)malloc(sizeof(a3ui32) * (n * 4 + 1));
+			if (!hierarchy->subtreeFirst)
+			{
+				hierarchy->subtreeEnd = hierarchy->childOffset = hierarchy->childIndex = 0;
+				hierarchy->isDepthFirst = 0;
+				return -1;
+			}
+			hierarchy->subtreeEnd = hierarchy->subtreeFirst + n;
+			hierarchy->childOffset = hierarchy->subtreeEnd + n;
+			hierarchy->childIndex = hierarchy->childOffset + n + 1;
+
+			// child table: count sort by parent, roots excluded
+			memset(hierarchy->childOffset, 0, sizeof(a3ui32) * (n + 1));
+			for (i = 0; i < n; ++i)
+				if ((parentIndex = hierarchy->parentIndex[i]) >= 0)
+					++hierarchy->childOffset[parentIndex + 1];
+			for (i = 0; i < n; ++i)
+				hierarchy->childOffset[i + 1] += hierarchy->childOffset[i];
+			for (i = 0; i < n; ++i)
+				if ((parentIndex = hierarchy->parentIndex[i]) >= 0)
+					hierarchy->childIndex[hierarchy->childOffset[parentIndex]++] = i;
+			for (i = n; i > 0; --i)
+				hierarchy->childOffset[i] = hierarchy->childOffset[i - 1];
+			hierarchy->childOffset[0] = 0;
+
+			// subtree sizes, children last (stored in end temporarily)
+			for (i = 0; i < n; ++i)
+				hierarchy->subtreeEnd[i] = 1;
+			for (i = n; i > 0; --i)
+				if ((parentIndex = hierarchy->parentIndex[i - 1]) >= 0)
+					hierarchy->subtreeEnd[parentIndex] += hierarchy->subtreeEnd[i - 1];
+
+			// preorder positions: roots take consecutive blocks, then each 
+			//	node hands out blocks to its children, parents first
+			for (i = position = 0; i < n; ++i)
+				if (hierarchy->parentIndex[i] < 0)
+				{
+					hierarchy->subtreeFirst[i] = position;
+					position += hierarchy->subtreeEnd[i];
+				}
+			for (i = 0; i < n; ++i)
+				for (j = hierarchy->childOffset[i], position = hierarchy->subtreeFirst[i] + 1; 
+					j < hierarchy->childOffset[i + 1]; ++j)
+				{
+					k = hierarchy->childIndex[j];
+					hierarchy->subtreeFirst[k] = position;
+					position += hierarchy->subtreeEnd[k];
+				}
+
+			// sizes become ends
+			for (i = 0, hierarchy->isDepthFirst = 1; i < n; ++i)
+			{
+				hierarchy->subtreeEnd[i] += hierarchy->subtreeFirst[i];
+				hierarchy->isDepthFirst = hierarchy->isDepthFirst && (hierarchy->subtreeFirst[i] == i);
+			}
+
+			return n;
+		}
+	}
+	return -1;
+}
+
 a3ret a3hierarchySaveBinary(const a3_Hierarchy *hierarchy, const a3_FileStream *fileStream)
 {
 	FILE *fp;
 	a3ui32 ret = 0;
+	a3_HierarchyInternalStreamHeader header;
 	if (hierarchy && fileStream)
 	{
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 		{
 			fp = fileStream->stream;
 			if (fp)
 			{
-				ret += (a3ui32)fwrite(&hierarchy->numNodes, 1, sizeof(a3ui32), fp);
-				ret += (a3ui32)fwrite(hierarchy->nodes, 1, sizeof(a3_HierarchyNode) * hierarchy->numNodes, fp);
+				a3hierarchyInternalSetStreamHeader(&header, hierarchy->numNodes);
+				ret += (a3ui32)fwrite(&header, 1, sizeof(header), fp);
+				ret += (a3ui32)fwrite(hierarchy->parentIndex, 1, sizeof(a3i32) * hierarchy->numNodes, fp);
+				ret += (a3ui32)fwrite(hierarchy->nodeName, 1, a3node_nameSize * hierarchy->numNodes, fp);
 			}
 			return ret;
 		}
@@ -155,19 +466,27 @@ a3ret a3hierarchyLoadBinary(a3_Hierarchy *hierarchy, const a3_FileStream *fileSt
 {
 	FILE *fp;
 	a3ui32 ret = 0;
-	a3ui32 dataSize = 0;
+	a3_HierarchyInternalStreamHeader header;
 	if (hierarchy && fileStream)
 	{
-		if (!hierarchy->nodes)
+		if (!hierarchy->parentIndex)
 		{
 			fp = fileStream->stream;
 			if (fp)
 			{
-				ret += (a3ui32)fread(&hierarchy->numNodes, 1, sizeof(a3ui32), fp);
-
-				dataSize = sizeof(a3_HierarchyNode) * hierarchy->numNodes;
-				hierarchy->nodes = (a3_HierarchyNode *)malloc(dataSize);
-				ret += (a3ui32)fread(hierarchy->nodes, 1, dataSize, fp);
+				ret += (a3ui32)fread(&header, 1, sizeof(header), fp);
+				if (ret < sizeof(header) || !a3hierarchyInternalValidStreamHeader(&header) ||
+					!a3hierarchyInternalCreateNodes(hierarchy, header.numNodes))
+					return 0;
+				ret += (a3ui32)fread(hierarchy->parentIndex, 1, sizeof(a3i32) * header.numNodes, fp);
+				ret += (a3ui32)fread(hierarchy->nodeName, 1, a3node_nameSize * header.numNodes, fp);
+				if (ret < a3hierarchyInternalGetSplitSize(header.numNodes))
+				{
+					a3hierarchyRelease(hierarchy);
+					return 0;
+				}
+				if (!a3hierarchyInternalFinishStream(hierarchy))
+					return 0;
 			}
 			return ret;
 		}
@@ -178,12 +497,15 @@ a3ret a3hierarchyLoadBinary(a3_Hierarchy *hierarchy, const a3_FileStream *fileSt
 a3ret a3hierarchyCopyToString(const a3_Hierarchy *hierarchy, a3byte *str)
 {
 	const a3byte *const start = str;
+	a3_HierarchyInternalStreamHeader header;
 	if (hierarchy && str)
 	{
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 		{
-			str = (a3byte *)((a3ui32 *)memcpy(str, &hierarchy->numNodes, sizeof(a3ui32)) + 1);
-			str = (a3byte *)((a3_HierarchyNode *)memcpy(str, hierarchy->nodes, sizeof(a3_HierarchyNode) * hierarchy->numNodes) + hierarchy->numNodes);
+			a3hierarchyInternalSetStreamHeader(&header, hierarchy->numNodes);
+			str = (a3byte *)memcpy(str, &header, sizeof(header)) + sizeof(header);
+			str = (a3byte *)((a3i32 *)memcpy(str, hierarchy->parentIndex, sizeof(a3i32) * hierarchy->numNodes) + hierarchy->numNodes);
+			str = (a3byte *)memcpy(str, hierarchy->nodeName, a3node_nameSize * hierarchy->numNodes) + a3node_nameSize * hierarchy->numNodes;
 
 			// done
 			return (a3i32)(str - start);
@@ -195,18 +517,22 @@ a3ret a3hierarchyCopyToString(const a3_Hierarchy *hierarchy, a3byte *str)
 a3ret a3hierarchyCopyFromString(a3_Hierarchy *hierarchy, const a3byte *str)
 {
 	const a3byte *const start = str;
-	a3ui32 dataSize = 0;
+	a3_HierarchyInternalStreamHeader header;
 	if (hierarchy && str)
 	{
-		if (!hierarchy->nodes)
+		if (!hierarchy->parentIndex)
 		{
-			memcpy(&hierarchy->numNodes, str, sizeof(a3ui32));
-			str += sizeof(a3ui32);
-
-			dataSize = sizeof(a3_HierarchyNode) * hierarchy->numNodes;
-			hierarchy->nodes = (a3_HierarchyNode *)malloc(dataSize);
-			memcpy(hierarchy->nodes, str, dataSize);
-			str += dataSize;
+			memcpy(&header, str, sizeof(header));
+			str += sizeof(header);
+			if (!a3hierarchyInternalValidStreamHeader(&header) ||
+				!a3hierarchyInternalCreateNodes(hierarchy, header.numNodes))
+				return 0;
+			memcpy(hierarchy->parentIndex, str, sizeof(a3i32) * header.numNodes);
+			str += sizeof(a3i32) * header.numNodes;
+			memcpy(hierarchy->nodeName, str, a3node_nameSize * header.numNodes);
+			str += a3node_nameSize * header.numNodes;
+			if (!a3hierarchyInternalFinishStream(hierarchy))
+				return 0;
 
 			// done
 			return (a3i32)(str - start);
@@ -219,11 +545,9 @@ a3ret a3hierarchyGetStringSize(const a3_Hierarchy *hierarchy)
 {
 	if (hierarchy)
 	{
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 		{
-			const a3ui32 dataSize
-				= sizeof(a3ui32)
-				+ sizeof(a3_HierarchyNode) * hierarchy->numNodes;
+			const a3ui32 dataSize = a3hierarchyInternalGetSplitSize(hierarchy->numNodes);
 			return dataSize;
 		}
 	}
@@ -234,11 +558,22 @@ a3ret a3hierarchyRelease(a3_Hierarchy *hierarchy)
 {
 	if (hierarchy)
 	{
-		if (hierarchy->nodes)
+		if (hierarchy->parentIndex)
 		{
-			free(hierarchy->nodes);
-			hierarchy->nodes = 0;
+			free(hierarchy->parentIndex);
+			free(hierarchy->levelNodeIndex);
+			free(hierarchy->subtreeFirst);
+			free(hierarchy->nameHash);
+			hierarchy->parentIndex = 0;
+			hierarchy->nodeName = 0;
 			hierarchy->numNodes = 0;
+			hierarchy->levelNodeIndex = hierarchy->levelOffset = hierarchy->nodeLevel = 0;
+			hierarchy->numLevels = 0;
+			hierarchy->subtreeFirst = hierarchy->subtreeEnd = hierarchy->childOffset = hierarchy->childIndex = 0;
+			hierarchy->isDepthFirst = 0;
+			hierarchy->nameHash = 0;
+			hierarchy->nameNext = hierarchy->nameBucket = 0;
+			hierarchy->nameBucketMask = 0;
 			return 1;
 		}
 	}
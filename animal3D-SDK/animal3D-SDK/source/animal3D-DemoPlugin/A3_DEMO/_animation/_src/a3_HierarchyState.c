@@ -23,22 +23,252 @@
 */
 
 #include "../a3_HierarchyState.h"
+#include "../a3_AnimationCache.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_HIERARCHYSTATE_SSE
+#include <xmmintrin.h>
+#endif	// SSE
+
+
+//-----------------------------------------------------------------------------
+
+// channel streams start on 16-byte boundaries so they can be streamed with 
+//	aligned vector loads
+#define A3_HIERARCHYSTATE_ALIGN		16
+#define a3hierarchyStateInternalAlign(sz)	(((sz) + (A3_HIERARCHYSTATE_ALIGN - 1)) & ~(A3_HIERARCHYSTATE_ALIGN - 1))
+
+static inline a3ubyte *a3hierarchyStateInternalAlignPtr(void *ptr)
+{
+	return (a3ubyte *)a3hierarchyStateInternalAlign((size_t)ptr);
+}
+
+// reset a range of channel streams to identity
+static inline void a3hierarchyStateInternalResetChannels(a3quat *rotate, a3vec3 *translate, a3vec3 *scale, const a3ui32 count)
+{
+	a3ui32 i;
+	for (i = 0; i < count; ++i)
+		rotate[i] = a3quat_identity;
+	for (i = 0; i < count; ++i)
+		translate[i] = a3vec3_zero;
+	for (i = 0; i < count; ++i)
+		scale[i] = a3vec3_one;
+}
+
+
+//-----------------------------------------------------------------------------
+// skinning palette kernels; state transforms are 16-byte aligned, the 
+//	inverse bind pose and 3x4 palette belong to the caller and may not be
+
+#ifdef A3_HIERARCHYSTATE_SSE
+
+// dot product of all four components, in every component
+static inline __m128 a3hierarchyStateInternalDot(const __m128 a, const __m128 b)
+{
+	__m128 m = _mm_mul_ps(a, b);
+	m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+// cross product of xyz; w is zero
+static inline __m128 a3hierarchyStateInternalCross(const __m128 a, const __m128 b)
+{
+	return _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2))),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))));
+}
+
+// affine inverse: the rows of the inverse basis are the basis columns 
+//	(rigid), the same over squared scale (uniform), or cross products of 
+//	pairs over the determinant (general); transposing makes them columns, 
+//	and translation is the negated inverse basis applied to the original
+static inline void a3hierarchyStateInternalInverse(a3mat4 *m_out, const a3mat4 *m, const a3_HierarchyScaleMode scaleMode)
+{
+	const __m128 a = _mm_load_ps(m->v[0].v), b = _mm_load_ps(m->v[1].v), c = _mm_load_ps(m->v[2].v);
+	const a3real *t = m->v[3].v;
+	__m128 r0, r1, r2, r3 = _mm_setzero_ps(), s;
+	switch (scaleMode)
+	{
+	case a3hierarchyScale_general:
+		r0 = a3hierarchyStateInternalCross(b, c);
+		r1 = a3hierarchyStateInternalCross(c, a);
+		r2 = a3hierarchyStateInternalCross(a, b);
+		s = _mm_div_ps(_mm_set1_ps(a3real_one), a3hierarchyStateInternalDot(a, r0));
+		r0 = _mm_mul_ps(r0, s);
+		r1 = _mm_mul_ps(r1, s);
+		r2 = _mm_mul_ps(r2, s);
+		break;
+	case a3hierarchyScale_uniform:
+		s = _mm_div_ps(_mm_set1_ps(a3real_one), a3hierarchyStateInternalDot(a, a));
+		r0 = _mm_mul_ps(a, s);
+		r1 = _mm_mul_ps(b, s);
+		r2 = _mm_mul_ps(c, s);
+		break;
+	default:
+		r0 = a;
+		r1 = b;
+		r2 = c;
+		break;
+	}
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(m_out->v[0].v, r0);
+	_mm_store_ps(m_out->v[1].v, r1);
+	_mm_store_ps(m_out->v[2].v, r2);
+	_mm_store_ps(m_out->v[3].v, _mm_sub_ps(_mm_set_ps(a3real_one, a3real_zero, a3real_zero, a3real_zero), _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(r0, _mm_set1_ps(t[0])), _mm_mul_ps(r1, _mm_set1_ps(t[1]))),
+		_mm_mul_ps(r2, _mm_set1_ps(t[2])))));
+}
+
+// affine product, optionally also stored as top three rows
+static inline void a3hierarchyStateInternalProductAffine(a3mat4 *m_out, a3vec4 *rows_out_opt, const a3mat4 *mL, const a3mat4 *mR)
+{
+	const __m128 c0 = _mm_load_ps(mL->v[0].v), c1 = _mm_load_ps(mL->v[1].v), c2 = _mm_load_ps(mL->v[2].v), c3 = _mm_load_ps(mL->v[3].v);
+	const a3real *r = mR->mm;
+	__m128 o0, o1, o2, o3;
+	o0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(r[0])), _mm_mul_ps(c1, _mm_set1_ps(r[1]))), _mm_mul_ps(c2, _mm_set1_ps(r[2])));
+	o1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(r[4])), _mm_mul_ps(c1, _mm_set1_ps(r[5]))), _mm_mul_ps(c2, _mm_set1_ps(r[6])));
+	o2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(r[8])), _mm_mul_ps(c1, _mm_set1_ps(r[9]))), _mm_mul_ps(c2, _mm_set1_ps(r[10])));
+	o3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(r[12])), _mm_mul_ps(c1, _mm_set1_ps(r[13]))), _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(r[14])), c3));
+	_mm_store_ps(m_out->v[0].v, o0);
+	_mm_store_ps(m_out->v[1].v, o1);
+	_mm_store_ps(m_out->v[2].v, o2);
+	_mm_store_ps(m_out->v[3].v, o3);
+	if (rows_out_opt)
+	{
+		_MM_TRANSPOSE4_PS(o0, o1, o2, o3);
+		_mm_storeu_ps(rows_out_opt[0].v, o0);
+		_mm_storeu_ps(rows_out_opt[1].v, o1);
+		_mm_storeu_ps(rows_out_opt[2].v, o2);
+	}
+}
+
+#else	// !A3_HIERARCHYSTATE_SSE
+
+static inline void a3hierarchyStateInternalInverse(a3mat4 *m_out, const a3mat4 *m, const a3_HierarchyScaleMode scaleMode)
+{
+	switch (scaleMode)
+	{
+	case a3hierarchyScale_general:
+		a3real4x4TransformInverse(m_out->m, m->m);
+		break;
+	case a3hierarchyScale_uniform:
+		a3real4x4TransformInverseUniformScale(m_out->m, m->m);
+		break;
+	default:
+		a3real4x4TransformInverseIgnoreScale(m_out->m, m->m);
+		break;
+	}
+}
+
+static inline void a3hierarchyStateInternalProductAffine(a3mat4 *m_out, a3vec4 *rows_out_opt, const a3mat4 *mL, const a3mat4 *mR)
+{
+	a3ui32 i;
+	a3real4x4ProductTransform(m_out->m, mL->m, mR->m);
+	if (rows_out_opt)
+		for (i = 0; i < 3; ++i)
+		{
+			rows_out_opt[i].x = m_out->m[0][i];
+			rows_out_opt[i].y = m_out->m[1][i];
+			rows_out_opt[i].z = m_out->m[2][i];
+			rows_out_opt[i].w = m_out->m[3][i];
+		}
+}
+
+#endif	// A3_HIERARCHYSTATE_SSE
+
+// bind-to-current for nodes marked, then clear marks
+static inline a3i32 a3hierarchyStateInternalBindToCurrent(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse, a3vec4 *palette3x4_out_opt)
+{
+	const a3mat4 *objectSpace = state->objectSpace->transform, *bindInverse = objectSpaceBindInverse->transform;
+	a3mat4 *bindToCurrent = state->objectSpaceBindToCurrent->transform;
+	a3ui32 i, j, bits, count;
+	for (i = count = 0; i < state->dirtyWordCount; ++i)
+	{
+		for (bits = state->objectDirty[i], j = i << 5; bits; ++j, bits >>= 1)
+			if (bits & 1)
+			{
+				a3hierarchyStateInternalProductAffine(bindToCurrent + j, palette3x4_out_opt ? palette3x4_out_opt + j * 3 : 0, objectSpace + j, bindInverse + j);
+				++count;
+			}
+		state->objectDirty[i] = 0;
+	}
+	state->counter->skinning += count;
+	return count;
+}
+
 
 //-----------------------------------------------------------------------------
 
 // initialize pose set given an initialized hierarchy and key pose count
 a3i32 a3hierarchyPoseGroupCreate(a3_HierarchyPoseGroup *poseGroup_out, const a3_Hierarchy *hierarchy, const a3ui32 poseCount)
 {
+	if (poseGroup_out && hierarchy && !poseGroup_out->hierarchy && hierarchy->parentIndex && poseCount)
+	{
+		const a3ui32 nodeCount = hierarchy->numNodes;
+		const a3ui32 count = nodeCount * poseCount;
+		const size_t hposeSize = a3hierarchyStateInternalAlign(sizeof(a3_HierarchyPose) * poseCount);
+		const size_t rotateSize = a3hierarchyStateInternalAlign(sizeof(a3quat) * count);
+		const size_t translateSize = a3hierarchyStateInternalAlign(sizeof(a3vec3) * count);
+		const size_t scaleSize = a3hierarchyStateInternalAlign(sizeof(a3vec3) * count);
+		const size_t dataSize = hposeSize + rotateSize + translateSize + scaleSize;
+		a3ubyte *data;
+		a3ui32 i, j;
+
+		// one block for everything, aligned manually
+		poseGroup_out->data = malloc(dataSize + A3_HIERARCHYSTATE_ALIGN);
+		if (poseGroup_out->data)
+		{
+			data = a3hierarchyStateInternalAlignPtr(poseGroup_out->data);
+			poseGroup_out->hpose = (a3_HierarchyPose *)data;
+			poseGroup_out->rotate = (a3quat *)(data += hposeSize);
+			poseGroup_out->translate = (a3vec3 *)(data += rotateSize);
+			poseGroup_out->scale = (a3vec3 *)(data += translateSize);
+			poseGroup_out->hierarchy = hierarchy;
+			poseGroup_out->poseCount = poseCount;
+
+			// each hierarchy pose views one slice of every channel
+			for (i = j = 0; i < poseCount; ++i, j += nodeCount)
+			{
+				poseGroup_out->hpose[i].rotate = poseGroup_out->rotate + j;
+				poseGroup_out->hpose[i].translate = poseGroup_out->translate + j;
+				poseGroup_out->hpose[i].scale = poseGroup_out->scale + j;
+			}
+			a3hierarchyStateInternalResetChannels(poseGroup_out->rotate, poseGroup_out->translate, poseGroup_out->scale, count);
+
+			// done
+			return poseCount;
+		}
+	}
 	return -1;
 }
 
 // release pose set
 a3i32 a3hierarchyPoseGroupRelease(a3_HierarchyPoseGroup *poseGroup)
 {
+	if (poseGroup && poseGroup->hierarchy)
+	{
+		free(poseGroup->data);
+		a3animationCacheUnmap(poseGroup->mapping);
+		memset(poseGroup, 0, sizeof(a3_HierarchyPoseGroup));
+		return 1;
+	}
+	return -1;
+}
+
+// convert channel streams to transforms for a range of nodes
+a3i32 a3hierarchyPoseConvert(const a3_HierarchyTransform *transform_out, const a3_HierarchyPose *pose, const a3ui32 nodeCount)
+{
+	a3ui32 i;
+	if (transform_out && transform_out->transform && pose && pose->rotate)
+	{
+		for (i = 0; i < nodeCount; ++i)
+			a3spatialPoseConvert(transform_out->transform + i, pose->rotate + i, pose->translate + i, pose->scale + i);
+		return nodeCount;
+	}
 	return -1;
 }
 
@@ -48,18 +278,381 @@ a3i32 a3hierarchyPoseGroupRelease(a3_HierarchyPoseGroup *poseGroup)
 // initialize hierarchy state given an initialized hierarchy
 a3i32 a3hierarchyStateCreate(a3_HierarchyState *state_out, const a3_HierarchyPoseGroup *poseGroup)
 {
+	if (state_out && poseGroup && !state_out->poseGroup && poseGroup->hierarchy)
+	{
+		const a3ui32 nodeCount = poseGroup->hierarchy->numNodes;
+		const a3ui32 wordCount = (nodeCount + 31) >> 5;
+		const size_t rotateSize = a3hierarchyStateInternalAlign(sizeof(a3quat) * nodeCount);
+		const size_t translateSize = a3hierarchyStateInternalAlign(sizeof(a3vec3) * nodeCount);
+		const size_t scaleSize = a3hierarchyStateInternalAlign(sizeof(a3vec3) * nodeCount);
+		const size_t transformSize = a3hierarchyStateInternalAlign(sizeof(a3mat4) * nodeCount);
+		const size_t dirtySize = a3hierarchyStateInternalAlign(sizeof(a3ui32) * wordCount);
+		const size_t counterSize = a3hierarchyStateInternalAlign(sizeof(a3_HierarchyStateCounter));
+		const size_t dataSize = rotateSize + translateSize + scaleSize + transformSize * 4 + dirtySize * 2 + counterSize;
+		a3ubyte *data;
+		a3ui32 i;
+
+		state_out->data = malloc(dataSize + A3_HIERARCHYSTATE_ALIGN);
+		if (state_out->data)
+		{
+			data = a3hierarchyStateInternalAlignPtr(state_out->data);
+			state_out->localPose->rotate = (a3quat *)data;
+			state_out->localPose->translate = (a3vec3 *)(data += rotateSize);
+			state_out->localPose->scale = (a3vec3 *)(data += translateSize);
+			state_out->localSpace->transform = (a3mat4 *)(data += scaleSize);
+			state_out->objectSpace->transform = (a3mat4 *)(data += transformSize);
+			state_out->objectSpaceInverse->transform = (a3mat4 *)(data += transformSize);
+			state_out->objectSpaceBindToCurrent->transform = (a3mat4 *)(data += transformSize);
+			state_out->localDirty = (a3ui32 *)(data += transformSize);
+			state_out->objectDirty = (a3ui32 *)(data += dirtySize);
+			state_out->counter = (a3_HierarchyStateCounter *)(data += dirtySize);
+			state_out->dirtyWordCount = wordCount;
+			state_out->poseGroup = poseGroup;
+
+			// start at identity
+			a3hierarchyStateInternalResetChannels(state_out->localPose->rotate, state_out->localPose->translate, state_out->localPose->scale, nodeCount);
+			for (i = 0; i < nodeCount; ++i)
+			{
+				state_out->localSpace->transform[i] = a3mat4_identity;
+				state_out->objectSpace->transform[i] = a3mat4_identity;
+				state_out->objectSpaceInverse->transform[i] = a3mat4_identity;
+				state_out->objectSpaceBindToCurrent->transform[i] = a3mat4_identity;
+			}
+
+			// everything is dirty until first solved
+			memset(state_out->localDirty, 0, dirtySize * 2);
+			memset(state_out->counter, 0, sizeof(a3_HierarchyStateCounter));
+			a3hierarchyStateSetDirty(state_out, 0, nodeCount);
+			memcpy(state_out->objectDirty, state_out->localDirty, sizeof(a3ui32) * wordCount);
+
+			// done
+			return nodeCount;
+		}
+	}
 	return -1;
 }
 
 // release hierarchy state
 a3i32 a3hierarchyStateRelease(a3_HierarchyState *state)
 {
+	if (state && state->poseGroup)
+	{
+		free(state->data);
+		memset(state, 0, sizeof(a3_HierarchyState));
+		return 1;
+	}
+	return -1;
+}
+
+
+// mark range of nodes dirty
+a3i32 a3hierarchyStateSetDirty(const a3_HierarchyState *state, const a3ui32 firstIndex, const a3ui32 nodeCount)
+{
+	if (state && state->poseGroup && firstIndex < state->poseGroup->hierarchy->numNodes)
+	{
+		const a3ui32 lastIndex = a3minimum(firstIndex + nodeCount, state->poseGroup->hierarchy->numNodes);
+		a3ui32 *dirty = state->localDirty;
+		a3ui32 i = firstIndex;
+
+		// partial words at the ends, whole words in between
+		for (; i < lastIndex && (i & 31); ++i)
+			dirty[i >> 5] |= 1u << (i & 31);
+		for (; i + 32 <= lastIndex; i += 32)
+			dirty[i >> 5] = 0xffffffff;
+		for (; i < lastIndex; ++i)
+			dirty[i >> 5] |= 1u << (i & 31);
+		return (lastIndex - firstIndex);
+	}
+	return -1;
+}
+
+// dirty local-space update
+a3i32 a3hierarchyStateUpdateLocalSpaceDirty(const a3_HierarchyState *state)
+{
+	if (state && state->poseGroup)
+	{
+		const a3_HierarchyPose *pose = state->localPose;
+		a3mat4 *localSpace = state->localSpace->transform;
+		a3ui32 i, j, bits, count;
+		for (i = count = 0; i < state->dirtyWordCount; ++i)
+			for (bits = state->localDirty[i], j = i << 5; bits; ++j, bits >>= 1)
+				if (bits & 1)
+				{
+					a3spatialPoseConvert(localSpace + j, pose->rotate + j, pose->translate + j, pose->scale + j);
+					++count;
+				}
+		state->counter->localSpace += count;
+		return count;
+	}
+	return -1;
+}
+
+
+// update inverse object-space matrices, all nodes
+a3i32 a3hierarchyStateUpdateObjectInverse(const a3_HierarchyState *state, const a3_HierarchyScaleMode scaleMode)
+{
+	if (state && state->poseGroup && scaleMode <= a3hierarchyScale_general)
+	{
+		const a3mat4 *objectSpace = state->objectSpace->transform;
+		a3mat4 *objectSpaceInverse = state->objectSpaceInverse->transform;
+		const a3ui32 nodeCount = state->poseGroup->hierarchy->numNodes;
+		a3ui32 i;
+		for (i = 0; i < nodeCount; ++i)
+			a3hierarchyStateInternalInverse(objectSpaceInverse + i, objectSpace + i, scaleMode);
+		return nodeCount;
+	}
+	return -1;
+}
+
+// update bind-to-current
+a3i32 a3hierarchyStateUpdateObjectBindToCurrent(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse)
+{
+	if (state && state->poseGroup && objectSpaceBindInverse && objectSpaceBindInverse->transform)
+		return a3hierarchyStateInternalBindToCurrent(state, objectSpaceBindInverse, 0);
+	return -1;
+}
+
+// update bind-to-current and 3x4 palette
+a3i32 a3hierarchyStateUpdateObjectBindToCurrent3x4(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse, a3vec4 *palette3x4_out)
+{
+	if (state && state->poseGroup && objectSpaceBindInverse && objectSpaceBindInverse->transform && palette3x4_out)
+		return a3hierarchyStateInternalBindToCurrent(state, objectSpaceBindInverse, palette3x4_out);
 	return -1;
 }
 
 
 //-----------------------------------------------------------------------------
 
+// HTR loading
+
+// HTR file sections
+enum a3_HierarchyStateInternalSectionHTR
+{
+	a3htr_none,
+	a3htr_header,
+	a3htr_hierarchy,
+	a3htr_basePose,
+	a3htr_frames,
+	a3htr_end,
+};
+
+// read consecutive numbers from a line, no allocation
+static inline a3ui32 a3hierarchyStateInternalReadReals(a3real *value_out, const a3ui32 count, const a3byte *str)
+{
+	a3byte *end;
+	a3ui32 i;
+	for (i = 0; i < count; ++i, str = end)
+	{
+		value_out[i] = (a3real)strtod(str, &end);
+		if (end == str)
+			break;
+	}
+	return i;
+}
+
+// meters per HTR calibration unit; zero if unknown
+static inline a3real a3hierarchyStateInternalUnitsHTR(const a3byte *units)
+{
+	if (!strcmp(units, "mm"))
+		return (a3real)0.001;
+	if (!strcmp(units, "cm"))
+		return (a3real)0.01;
+	if (!strcmp(units, "dm"))
+		return (a3real)0.1;
+	if (!strcmp(units, "m"))
+		return a3real_one;
+	if (!strcmp(units, "in"))
+		return (a3real)0.0254;
+	if (!strcmp(units, "ft"))
+		return (a3real)0.3048;
+	return a3real_zero;
+}
+
+// store one node pose as read from file: translation, Euler angles held 
+//	in the rotation channel until the conversion pass, and bone scale
+static inline void a3hierarchyStateInternalStoreRawHTR(const a3_HierarchyPose *pose, const a3ui32 nodeIndex, const a3real value[7], const a3ui32 boneAxis)
+{
+	pose->translate[nodeIndex].x = value[0];
+	pose->translate[nodeIndex].y = value[1];
+	pose->translate[nodeIndex].z = value[2];
+	pose->rotate[nodeIndex].x = value[3];
+	pose->rotate[nodeIndex].y = value[4];
+	pose->rotate[nodeIndex].z = value[5];
+	pose->rotate[nodeIndex].w = a3real_zero;
+	pose->scale[nodeIndex] = a3vec3_one;
+	pose->scale[nodeIndex].v[boneAxis] = value[6];
+}
+
+a3i32 a3hierarchyPoseGroupLoadHTR(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, const a3byte *resourceFilePath)
+{
+	if (poseGroup_out && !poseGroup_out->hierarchy && hierarchy_out && !hierarchy_out->parentIndex && resourceFilePath && *resourceFilePath)
+	{
+		FILE *fp = fopen(resourceFilePath, "r");
+		a3byte line[512], key[a3node_nameSize * 2], value[a3node_nameSize * 2], *str;
+		a3real raw[7], scaleFactor = a3real_one, unitScale = a3real_one;
+		a3ui32 numSegments = 0, numFrames = 0, boneAxis = 1, frame = 0, i, j, count;
+		a3i32 nodeIndex = -1, parentIndex;
+		a3boolean eulerXYZ = 0, radians = 0, failed = 0;
+		enum a3_HierarchyStateInternalSectionHTR section = a3htr_none;
+		a3quat base;
+		a3vec3 offset;
+
+		if (!fp)
+		{
+			printf("\n A3 Warning: Could not open HTR file \'%s\'.", resourceFilePath);
+			return -1;
+		}
+		setvbuf(fp, 0, _IOFBF, 1 << 16);
+
+		// single pass over lines
+		while (!failed && section != a3htr_end && fgets(line, sizeof(line), fp))
+		{
+			// trim line ending, skip blanks and comments
+			for (str = line + strlen(line); str > line && (str[-1] == '\n' || str[-1] == '\r'); *(--str) = 0);
+			for (str = line; *str == ' ' || *str == '\t'; ++str);
+			if (!*str || *str == '#')
+				continue;
+
+			// section tag
+			if (*str == '[')
+			{
+				if (!strncmp(str, "[Header]", 8))
+					section = a3htr_header;
+				else if (!strncmp(str, "[SegmentNames&Hierarchy]", 24))
+				{
+					// header is done: everything can be allocated now
+					section = a3htr_hierarchy;
+					failed = (numSegments == 0 ||
+						a3hierarchyCreate(hierarchy_out, numSegments, 0) < 0 ||
+						a3hierarchyPoseGroupCreate(poseGroup_out, hierarchy_out, numFrames + 1) < 0);
+					nodeIndex = 0;
+				}
+				else if (!strncmp(str, "[BasePosition]", 14))
+					section = a3htr_basePose;
+				else if (!strncmp(str, "[EndOfFile]", 11))
+					section = a3htr_end;
+				else
+				{
+					// segment frame block
+					section = a3htr_frames;
+					str[strcspn(str, "]")] = 0;
+					nodeIndex = hierarchy_out->parentIndex ? a3hierarchyGetNodeIndex(hierarchy_out, str + 1) : -1;
+					frame = 0;
+					if (nodeIndex < 0)
+						printf("\n A3 Warning: Skipping HTR frames for unknown segment \'%s\'.", str + 1);
+				}
+				continue;
+			}
+
+			switch (section)
+			{
+			case a3htr_header:
+				if (sscanf(str, "%63s %63s", key, value) == 2)
+				{
+					if (!strcmp(key, "NumSegments"))
+						numSegments = (a3ui32)atoi(value);
+					else if (!strcmp(key, "NumFrames"))
+						numFrames = (a3ui32)atoi(value);
+					else if (!strcmp(key, "EulerRotationOrder"))
+					{
+						eulerXYZ = !strcmp(value, "XYZ");
+						if (!eulerXYZ && strcmp(value, "ZYX"))
+							printf("\n A3 Warning: Unsupported HTR rotation order \'%s\'; using ZYX.", value);
+					}
+					else if (!strcmp(key, "RotationUnits"))
+						radians = (*value == 'R' || *value == 'r');
+					else if (!strcmp(key, "BoneLengthAxis"))
+						boneAxis = (*value == 'X' || *value == 'x') ? 0 : (*value == 'Z' || *value == 'z') ? 2 : 1;
+					else if (!strcmp(key, "ScaleFactor"))
+						scaleFactor = (a3real)atof(value);
+					else if (!strcmp(key, "CalibrationUnits"))
+					{
+						unitScale = a3hierarchyStateInternalUnitsHTR(value);
+						if (unitScale == a3real_zero)
+						{
+							printf("\n A3 Warning: Unsupported HTR calibration units \'%s\'; using meters.", value);
+							unitScale = a3real_one;
+						}
+					}
+				}
+				break;
+			case a3htr_hierarchy:
+				if (sscanf(str, "%31s %31s", key, value) == 2 && (a3ui32)nodeIndex < numSegments)
+				{
+					// parents are listed before children
+					parentIndex = strcmp(value, "GLOBAL") ? a3hierarchyGetNodeIndex(hierarchy_out, value) : -1;
+					if (parentIndex < 0 && strcmp(value, "GLOBAL"))
+					{
+						printf("\n A3 Warning: HTR segment \'%s\' listed before its parent \'%s\'.", key, value);
+						failed = 1;
+					}
+					else
+						a3hierarchySetNode(hierarchy_out, nodeIndex++, parentIndex, key);
+				}
+				break;
+			case a3htr_basePose:
+				if (sscanf(str, "%31s", key) == 1 && (nodeIndex = a3hierarchyGetNodeIndex(hierarchy_out, key)) >= 0)
+				{
+					raw[6] = a3real_one;
+					a3hierarchyStateInternalReadReals(raw, 6, str + strlen(key));
+					a3hierarchyStateInternalStoreRawHTR(poseGroup_out->hpose, nodeIndex, raw, boneAxis);
+				}
+				break;
+			case a3htr_frames:
+				if (nodeIndex >= 0 && frame < numFrames)
+				{
+					// leading column is the frame number; rows are taken in order
+					strtol(str, &str, 10);
+					if (a3hierarchyStateInternalReadReals(raw, 7, str) == 7)
+						a3hierarchyStateInternalStoreRawHTR(poseGroup_out->hpose + (++frame), nodeIndex, raw, boneAxis);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		fclose(fp);
+
+		if (failed || !poseGroup_out->hierarchy)
+		{
+			printf("\n A3 Warning: Failed to load HTR file \'%s\'.", resourceFilePath);
+			a3hierarchyPoseGroupRelease(poseGroup_out);
+			a3hierarchyRelease(hierarchy_out);
+			return -1;
+		}
+
+		// batched conversion passes over whole channel streams; file scale 
+		//	and calibration units fold into one multiply to meters
+		count = poseGroup_out->poseCount * hierarchy_out->numNodes;
+		scaleFactor *= unitScale;
+		if (scaleFactor != a3real_one)
+			for (i = 0; i < count; ++i)
+				a3real3MulS(poseGroup_out->translate[i].v, scaleFactor);
+		if (radians)
+			for (i = 0; i < count; ++i)
+				a3real3MulS(poseGroup_out->rotate[i].qv, a3real_rad2deg);
+		if (eulerXYZ)
+			for (i = 0; i < count; ++i)
+				a3quatSetEulerXYZ(poseGroup_out->rotate[i].q, poseGroup_out->rotate[i].x, poseGroup_out->rotate[i].y, poseGroup_out->rotate[i].z);
+		else
+			for (i = 0; i < count; ++i)
+				a3quatSetEulerZYX(poseGroup_out->rotate[i].q, poseGroup_out->rotate[i].x, poseGroup_out->rotate[i].y, poseGroup_out->rotate[i].z);
+
+		// frames are relative to the base pose: compose base * frame
+		for (i = hierarchy_out->numNodes; i < count; ++i)
+		{
+			j = i % hierarchy_out->numNodes;
+			base = poseGroup_out->rotate[j];
+			a3quatVec3GetRotated(offset.v, poseGroup_out->translate[i].v, base.q);
+			a3real3Sum(poseGroup_out->translate[i].v, poseGroup_out->translate[j].v, offset.v);
+			a3quatConcatR(base.q, poseGroup_out->rotate[i].q);
+		}
+
+		// done
+		return poseGroup_out->poseCount;
+	}
+	return -1;
+}
 
 
 //-----------------------------------------------------------------------------
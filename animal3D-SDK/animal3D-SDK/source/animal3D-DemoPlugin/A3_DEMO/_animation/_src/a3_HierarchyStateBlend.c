@@ -24,9 +24,1585 @@
 
 #include "../a3_HierarchyStateBlend.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_HIERARCHYSTATEBLEND_SSE
+#include <xmmintrin.h>
+#endif	// SSE
+
+
+//-----------------------------------------------------------------------------
+
+// slerp without trigonometry (Eberly, "A Fast and Accurate Algorithm for 
+//	Computing SLERP"): for unit quaternions at most 90 degrees apart, with 
+//	x = cos(angle), the weights sin(t * angle) / sin(angle) are evaluated 
+//	as t * (1 + b1 * (1 + b2 * (... (1 + b8)))), bi = (u[i] t^2 - v[i])(x - 1); 
+//	the last pair is corrected by mu; with eight terms weights are within 
+//	1e-7 for rotations up to 90 degrees apart and 2e-5 at worst
+#define A3_POSEBLEND_SLERP_MU		1.85298109240830f
+#define A3_POSEBLEND_SLERP_TERMS	8
+
+static const a3real a3poseBlendInternalSlerpU[A3_POSEBLEND_SLERP_TERMS] = {
+	1.0f / (1.0f * 3.0f), 1.0f / (2.0f * 5.0f), 1.0f / (3.0f * 7.0f), 1.0f / (4.0f * 9.0f),
+	1.0f / (5.0f * 11.0f), 1.0f / (6.0f * 13.0f), 1.0f / (7.0f * 15.0f), A3_POSEBLEND_SLERP_MU / (8.0f * 17.0f),
+};
+static const a3real a3poseBlendInternalSlerpV[A3_POSEBLEND_SLERP_TERMS] = {
+	1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f,
+	5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f, A3_POSEBLEND_SLERP_MU * 8.0f / 17.0f,
+};
+
+// maximum number of poses in a weighted sum
+#define A3_POSEBLEND_SUM_MAX		4
+
+
+//-----------------------------------------------------------------------------
+// single-node kernels; whole channel when SSE is unavailable, otherwise 
+//	the nodes left over after groups of four
+
+static inline a3real a3poseBlendInternalSlerpWeight(const a3real xm1, const a3real t)
+{
+	const a3real t2 = t * t;
+	a3real r = a3real_one;
+	a3i32 i;
+	for (i = A3_POSEBLEND_SLERP_TERMS - 1; i >= 0; --i)
+		r = a3real_one + (a3poseBlendInternalSlerpU[i] * t2 - a3poseBlendInternalSlerpV[i]) * xm1 * r;
+	return (t * r);
+}
+
+// q0 null for identity
+static inline void a3poseBlendInternalQuatSlerp(a3real *q_out, const a3real *q0, const a3real *q1, const a3real t)
+{
+	const a3real x = q0 ? (q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3]) : q1[3];
+	const a3real c0 = a3poseBlendInternalSlerpWeight(a3absolute(x) - a3real_one, a3real_one - t);
+	const a3real c1 = x < a3real_zero ? -a3poseBlendInternalSlerpWeight(-x - a3real_one, t) : a3poseBlendInternalSlerpWeight(x - a3real_one, t);
+	if (q0)
+	{
+		q_out[0] = q0[0] * c0 + q1[0] * c1;
+		q_out[1] = q0[1] * c0 + q1[1] * c1;
+		q_out[2] = q0[2] * c0 + q1[2] * c1;
+		q_out[3] = q0[3] * c0 + q1[3] * c1;
+	}
+	else
+	{
+		q_out[0] = q1[0] * c1;
+		q_out[1] = q1[1] * c1;
+		q_out[2] = q1[2] * c1;
+		q_out[3] = q1[3] * c1 + c0;
+	}
+}
+
+static inline void a3poseBlendInternalQuatSum(a3real *q_out, const a3quat *const *q, const a3real *w, const a3ui32 count, const a3boolean normalize, const a3ui32 i)
+{
+	const a3real *q0 = q[0][i].q, *qk;
+	a3real r[4], wk, len;
+	a3ui32 k;
+	r[0] = q0[0] * w[0];
+	r[1] = q0[1] * w[0];
+	r[2] = q0[2] * w[0];
+	r[3] = q0[3] * w[0];
+	for (k = 1; k < count; ++k)
+	{
+		qk = q[k][i].q;
+		wk = (q0[0] * qk[0] + q0[1] * qk[1] + q0[2] * qk[2] + q0[3] * qk[3]) < a3real_zero ? -w[k] : w[k];
+		r[0] += qk[0] * wk;
+		r[1] += qk[1] * wk;
+		r[2] += qk[2] * wk;
+		r[3] += qk[3] * wk;
+	}
+	if (normalize)
+	{
+		len = a3sqrtSafeInverse(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+		r[0] *= len;
+		r[1] *= len;
+		r[2] *= len;
+		r[3] *= len;
+	}
+	q_out[0] = r[0];
+	q_out[1] = r[1];
+	q_out[2] = r[2];
+	q_out[3] = r[3];
+}
+
+static inline void a3poseBlendInternalQuatProduct(a3real *q_out, const a3real *qL, const a3real *qR)
+{
+	const a3real x = qL[3] * qR[0] + qL[0] * qR[3] + qL[1] * qR[2] - qL[2] * qR[1];
+	const a3real y = qL[3] * qR[1] - qL[0] * qR[2] + qL[1] * qR[3] + qL[2] * qR[0];
+	const a3real z = qL[3] * qR[2] + qL[0] * qR[1] - qL[1] * qR[0] + qL[2] * qR[3];
+	const a3real w = qL[3] * qR[3] - qL[0] * qR[0] - qL[1] * qR[1] - qL[2] * qR[2];
+	q_out[0] = x;
+	q_out[1] = y;
+	q_out[2] = z;
+	q_out[3] = w;
+}
+
+
+//-----------------------------------------------------------------------------
+// four-node kernels: rotations are transposed so that each register holds 
+//	one component of four quaternions, letting per-node dot products, 
+//	weights and products run without horizontal operations
+
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+
+typedef struct a3_PoseBlendQuat4
+{
+	__m128 x, y, z, w;
+} a3_PoseBlendQuat4;
+
+static inline void a3poseBlendInternalLoad4(a3_PoseBlendQuat4 *q_out, const a3quat *q)
+{
+	q_out->x = _mm_loadu_ps(q[0].q);
+	q_out->y = _mm_loadu_ps(q[1].q);
+	q_out->z = _mm_loadu_ps(q[2].q);
+	q_out->w = _mm_loadu_ps(q[3].q);
+	_MM_TRANSPOSE4_PS(q_out->x, q_out->y, q_out->z, q_out->w);
+}
+
+static inline void a3poseBlendInternalStore4(a3quat *q_out, const a3_PoseBlendQuat4 *q)
+{
+	__m128 x = q->x, y = q->y, z = q->z, w = q->w;
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(q_out[0].q, x);
+	_mm_storeu_ps(q_out[1].q, y);
+	_mm_storeu_ps(q_out[2].q, z);
+	_mm_storeu_ps(q_out[3].q, w);
+}
+
+// gather and scatter four quaternions at any node indices
+static inline void a3poseBlendInternalGather4(a3_PoseBlendQuat4 *q_out, const a3quat *q, const a3ui32 *index)
+{
+	q_out->x = _mm_loadu_ps(q[index[0]].q);
+	q_out->y = _mm_loadu_ps(q[index[1]].q);
+	q_out->z = _mm_loadu_ps(q[index[2]].q);
+	q_out->w = _mm_loadu_ps(q[index[3]].q);
+	_MM_TRANSPOSE4_PS(q_out->x, q_out->y, q_out->z, q_out->w);
+}
+
+static inline void a3poseBlendInternalScatter4(a3quat *q_out, const a3_PoseBlendQuat4 *q, const a3ui32 *index)
+{
+	__m128 x = q->x, y = q->y, z = q->z, w = q->w;
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(q_out[index[0]].q, x);
+	_mm_storeu_ps(q_out[index[1]].q, y);
+	_mm_storeu_ps(q_out[index[2]].q, z);
+	_mm_storeu_ps(q_out[index[3]].q, w);
+}
+
+static inline __m128 a3poseBlendInternalDot4(const a3_PoseBlendQuat4 *qL, const a3_PoseBlendQuat4 *qR)
+{
+	return _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(qL->x, qR->x), _mm_mul_ps(qL->y, qR->y)),
+		_mm_add_ps(_mm_mul_ps(qL->z, qR->z), _mm_mul_ps(qL->w, qR->w)));
+}
+
+// zero-length sums stay zero instead of becoming NaN (as a3sqrtSafeInverse)
+static inline void a3poseBlendInternalNormalize4(a3_PoseBlendQuat4 *q)
+{
+	const __m128 lenSq = a3poseBlendInternalDot4(q, q);
+	const __m128 lenInv = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lenSq)), _mm_cmpgt_ps(lenSq, _mm_setzero_ps()));
+	q->x = _mm_mul_ps(q->x, lenInv);
+	q->y = _mm_mul_ps(q->y, lenInv);
+	q->z = _mm_mul_ps(q->z, lenInv);
+	q->w = _mm_mul_ps(q->w, lenInv);
+}
+
+static inline __m128 a3poseBlendInternalSlerpWeight4(const __m128 xm1, const __m128 t)
+{
+	const __m128 one = _mm_set1_ps(1.0f), t2 = _mm_mul_ps(t, t);
+	__m128 r = one;
+	a3i32 i;
+	for (i = A3_POSEBLEND_SLERP_TERMS - 1; i >= 0; --i)
+		r = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(
+			_mm_mul_ps(_mm_set1_ps(a3poseBlendInternalSlerpU[i]), t2), _mm_set1_ps(a3poseBlendInternalSlerpV[i])), xm1), r));
+	return _mm_mul_ps(t, r);
+}
+
+// q0 null for identity
+static inline void a3poseBlendInternalSlerp4(a3_PoseBlendQuat4 *q_out, const a3_PoseBlendQuat4 *q0, const a3_PoseBlendQuat4 *q1, const __m128 t)
+{
+	const __m128 one = _mm_set1_ps(1.0f), sign = _mm_set1_ps(-0.0f);
+	const __m128 x = q0 ? a3poseBlendInternalDot4(q0, q1) : q1->w;
+	const __m128 s = _mm_and_ps(x, sign), xm1 = _mm_sub_ps(_mm_andnot_ps(sign, x), one);
+	const __m128 c0 = a3poseBlendInternalSlerpWeight4(xm1, _mm_sub_ps(one, t));
+	const __m128 c1 = _mm_xor_ps(a3poseBlendInternalSlerpWeight4(xm1, t), s);
+	if (q0)
+	{
+		q_out->x = _mm_add_ps(_mm_mul_ps(q0->x, c0), _mm_mul_ps(q1->x, c1));
+		q_out->y = _mm_add_ps(_mm_mul_ps(q0->y, c0), _mm_mul_ps(q1->y, c1));
+		q_out->z = _mm_add_ps(_mm_mul_ps(q0->z, c0), _mm_mul_ps(q1->z, c1));
+		q_out->w = _mm_add_ps(_mm_mul_ps(q0->w, c0), _mm_mul_ps(q1->w, c1));
+	}
+	else
+	{
+		q_out->x = _mm_mul_ps(q1->x, c1);
+		q_out->y = _mm_mul_ps(q1->y, c1);
+		q_out->z = _mm_mul_ps(q1->z, c1);
+		q_out->w = _mm_add_ps(_mm_mul_ps(q1->w, c1), c0);
+	}
+}
+
+static inline void a3poseBlendInternalSum4(a3_PoseBlendQuat4 *q_out, const a3quat *const *q, const __m128 *w, const a3ui32 count, const a3boolean normalize, const a3ui32 i)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	a3_PoseBlendQuat4 q0, qk;
+	__m128 wk;
+	a3ui32 k;
+	a3poseBlendInternalLoad4(&q0, q[0] + i);
+	q_out->x = _mm_mul_ps(q0.x, w[0]);
+	q_out->y = _mm_mul_ps(q0.y, w[0]);
+	q_out->z = _mm_mul_ps(q0.z, w[0]);
+	q_out->w = _mm_mul_ps(q0.w, w[0]);
+	for (k = 1; k < count; ++k)
+	{
+		a3poseBlendInternalLoad4(&qk, q[k] + i);
+		wk = _mm_xor_ps(w[k], _mm_and_ps(a3poseBlendInternalDot4(&q0, &qk), sign));
+		q_out->x = _mm_add_ps(q_out->x, _mm_mul_ps(qk.x, wk));
+		q_out->y = _mm_add_ps(q_out->y, _mm_mul_ps(qk.y, wk));
+		q_out->z = _mm_add_ps(q_out->z, _mm_mul_ps(qk.z, wk));
+		q_out->w = _mm_add_ps(q_out->w, _mm_mul_ps(qk.w, wk));
+	}
+	if (normalize)
+		a3poseBlendInternalNormalize4(q_out);
+}
+
+static inline void a3poseBlendInternalProduct4(a3_PoseBlendQuat4 *q_out, const a3_PoseBlendQuat4 *qL, const a3_PoseBlendQuat4 *qR)
+{
+	const __m128 x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qL->w, qR->x), _mm_mul_ps(qL->x, qR->w)), _mm_mul_ps(qL->y, qR->z)), _mm_mul_ps(qL->z, qR->y));
+	const __m128 y = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(qL->w, qR->y), _mm_mul_ps(qL->x, qR->z)), _mm_add_ps(_mm_mul_ps(qL->y, qR->w), _mm_mul_ps(qL->z, qR->x)));
+	const __m128 z = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(qL->w, qR->z), _mm_mul_ps(qL->x, qR->y)), _mm_mul_ps(qL->y, qR->x)), _mm_mul_ps(qL->z, qR->w));
+	const __m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(qL->w, qR->w), _mm_mul_ps(qL->x, qR->x)), _mm_mul_ps(qL->y, qR->y)), _mm_mul_ps(qL->z, qR->z));
+	q_out->x = x;
+	q_out->y = y;
+	q_out->z = z;
+	q_out->w = w;
+}
+
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+
 
 //-----------------------------------------------------------------------------
+// channel stream operations; translate and scale streams are treated as 
+//	flat arrays of 3 * nodeCount components
+
+// out = c + sum(w[k] * in[k])
+static inline void a3poseBlendInternalSum(a3real *out, const a3real *const *in, const a3real *w, const a3ui32 inCount, const a3real c, const a3ui32 count)
+{
+	a3ui32 i = 0, k;
+	a3real r;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	__m128 wv[A3_POSEBLEND_SUM_MAX], cv = _mm_set1_ps(c), rv;
+	for (k = 0; k < inCount; ++k)
+		wv[k] = _mm_set1_ps(w[k]);
+	for (; i + 4 <= count; i += 4)
+	{
+		for (rv = cv, k = 0; k < inCount; ++k)
+			rv = _mm_add_ps(rv, _mm_mul_ps(_mm_loadu_ps(in[k] + i), wv[k]));
+		_mm_storeu_ps(out + i, rv);
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+	{
+		for (r = c, k = 0; k < inCount; ++k)
+			r += in[k][i] * w[k];
+		out[i] = r;
+	}
+}
+
+// out = a * (w * b + c)
+static inline void a3poseBlendInternalProductSum(a3real *out, const a3real *a, const a3real *b, const a3real w, const a3real c, const a3ui32 count)
+{
+	a3ui32 i = 0;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 wv = _mm_set1_ps(w), cv = _mm_set1_ps(c);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(b + i), wv), cv)));
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+		out[i] = a[i] * (b[i] * w + c);
+}
+
+// out = 1 / a
+static inline void a3poseBlendInternalReciprocal(a3real *out, const a3real *a, const a3ui32 count)
+{
+	a3ui32 i = 0;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_div_ps(one, _mm_loadu_ps(a + i)));
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+		out[i] = a3recip(a[i]);
+}
+
+// rotations: out = normalize?(sum(w[k] * q[k])), each aligned to q[0]
+static inline void a3poseBlendInternalRotateSum(a3quat *q_out, const a3quat *const *q, const a3real *w, const a3ui32 inCount, const a3boolean normalize, const a3ui32 count)
+{
+	a3ui32 i = 0;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	a3_PoseBlendQuat4 r;
+	__m128 wv[A3_POSEBLEND_SUM_MAX];
+	a3ui32 k;
+	for (k = 0; k < inCount; ++k)
+		wv[k] = _mm_set1_ps(w[k]);
+	for (; i + 4 <= count; i += 4)
+	{
+		a3poseBlendInternalSum4(&r, q, wv, inCount, normalize, i);
+		a3poseBlendInternalStore4(q_out + i, &r);
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+		a3poseBlendInternalQuatSum(q_out[i].q, q, w, inCount, normalize, i);
+}
+
+// rotations: out = slerp(q0, q1, t), q0 null for identity
+static inline void a3poseBlendInternalRotateSlerp(a3quat *q_out, const a3quat *q0, const a3quat *q1, const a3real t, const a3ui32 count)
+{
+	a3ui32 i = 0;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 tv = _mm_set1_ps(t);
+	a3_PoseBlendQuat4 r, r0, r1;
+	for (; i + 4 <= count; i += 4)
+	{
+		if (q0)
+			a3poseBlendInternalLoad4(&r0, q0 + i);
+		a3poseBlendInternalLoad4(&r1, q1 + i);
+		a3poseBlendInternalSlerp4(&r, q0 ? &r0 : 0, &r1, tv);
+		a3poseBlendInternalStore4(q_out + i, &r);
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+		a3poseBlendInternalQuatSlerp(q_out[i].q, q0 ? q0[i].q : 0, q1[i].q, t);
+}
+
+// rotations: out = qL * slerp(identity, qR, t), skipping the slerp if t is 1
+static inline void a3poseBlendInternalRotateProduct(a3quat *q_out, const a3quat *qL, const a3quat *qR, const a3real t, const a3ui32 count)
+{
+	const a3boolean scaled = (t != a3real_one);
+	a3ui32 i = 0;
+	a3real r[4];
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 tv = _mm_set1_ps(t);
+	a3_PoseBlendQuat4 rL, rR;
+	for (; i + 4 <= count; i += 4)
+	{
+		a3poseBlendInternalLoad4(&rL, qL + i);
+		a3poseBlendInternalLoad4(&rR, qR + i);
+		if (scaled)
+			a3poseBlendInternalSlerp4(&rR, 0, &rR, tv);
+		a3poseBlendInternalProduct4(&rR, &rL, &rR);
+		a3poseBlendInternalStore4(q_out + i, &rR);
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+	{
+		r[0] = qR[i].x;
+		r[1] = qR[i].y;
+		r[2] = qR[i].z;
+		r[3] = qR[i].w;
+		if (scaled)
+			a3poseBlendInternalQuatSlerp(r, 0, r, t);
+		a3poseBlendInternalQuatProduct(q_out[i].q, qL[i].q, r);
+	}
+}
+
+// rotations: out = conjugate(q)
+static inline void a3poseBlendInternalRotateConjugate(a3quat *q_out, const a3quat *q, const a3ui32 count)
+{
+	a3ui32 i;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 sign = _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f);
+	for (i = 0; i < count; ++i)
+		_mm_storeu_ps(q_out[i].q, _mm_xor_ps(_mm_loadu_ps(q[i].q), sign));
+#else	// !A3_HIERARCHYSTATEBLEND_SSE
+	for (i = 0; i < count; ++i)
+	{
+		q_out[i].x = -q[i].x;
+		q_out[i].y = -q[i].y;
+		q_out[i].z = -q[i].z;
+		q_out[i].w = q[i].w;
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+}
+
+// rotations: out = identity
+static inline void a3poseBlendInternalRotateReset(a3quat *q_out, const a3ui32 count)
+{
+	a3ui32 i;
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 identity = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	for (i = 0; i < count; ++i)
+		_mm_storeu_ps(q_out[i].q, identity);
+#else	// !A3_HIERARCHYSTATEBLEND_SSE
+	for (i = 0; i < count; ++i)
+		q_out[i] = a3quat_identity;
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+}
+
+// rotations: out = slerp(slerp(q00, q01, u0), slerp(q10, q11, u0), u1)
+static inline void a3poseBlendInternalRotateBilinear(a3quat *q_out, const a3quat *q00, const a3quat *q01, const a3quat *q10, const a3quat *q11, const a3real u0, const a3real u1, const a3ui32 count)
+{
+	a3ui32 i = 0;
+	a3real r0[4], r1[4];
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 u0v = _mm_set1_ps(u0), u1v = _mm_set1_ps(u1);
+	a3_PoseBlendQuat4 rA, rB, rC;
+	for (; i + 4 <= count; i += 4)
+	{
+		a3poseBlendInternalLoad4(&rA, q00 + i);
+		a3poseBlendInternalLoad4(&rB, q01 + i);
+		a3poseBlendInternalSlerp4(&rC, &rA, &rB, u0v);
+		a3poseBlendInternalLoad4(&rA, q10 + i);
+		a3poseBlendInternalLoad4(&rB, q11 + i);
+		a3poseBlendInternalSlerp4(&rA, &rA, &rB, u0v);
+		a3poseBlendInternalSlerp4(&rB, &rC, &rA, u1v);
+		a3poseBlendInternalStore4(q_out + i, &rB);
+	}
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+	for (; i < count; ++i)
+	{
+		a3poseBlendInternalQuatSlerp(r0, q00[i].q, q01[i].q, u0);
+		a3poseBlendInternalQuatSlerp(r1, q10[i].q, q11[i].q, u0);
+		a3poseBlendInternalQuatSlerp(q_out[i].q, r0, r1, u1);
+	}
+}
+
+// pose has all channel streams
+static inline a3boolean a3poseBlendInternalValid(const a3_HierarchyPose *pose)
+{
+	return (pose && pose->rotate && pose->translate && pose->scale);
+}
+
+
+//-----------------------------------------------------------------------------
+// masked operations: nodes are found by scanning bitsets, and nodes that 
+//	need real blending are batched four at a time with their rotations 
+//	gathered into transposed form
+
+// index of lowest set bit (de Bruijn sequence)
+static const a3ubyte a3poseMaskInternalBitIndex[32] = {
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9,
+};
+
+static inline a3ui32 a3poseMaskInternalLowestBit(const a3ui32 bits)
+{
+	return a3poseMaskInternalBitIndex[((bits & (0 - bits)) * 0x077CB531u) >> 27];
+}
+
+static inline void a3poseBlendInternalCopyNode(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3ui32 i)
+{
+	pose_out->rotate[i] = pose_in->rotate[i];
+	pose_out->translate[i] = pose_in->translate[i];
+	pose_out->scale[i] = pose_in->scale[i];
+}
+
+// blend one node by weight w: lerp, or add if additive
+static inline void a3poseBlendInternalBlendNode(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real w, const a3boolean additive, const a3ui32 i)
+{
+	const a3quat *rotate[2] = { pose0->rotate, pose1->rotate };
+	const a3real *t0 = pose0->translate[i].v, *t1 = pose1->translate[i].v, *s0 = pose0->scale[i].v, *s1 = pose1->scale[i].v;
+	a3real *t = pose_out->translate[i].v, *s = pose_out->scale[i].v;
+	a3real r[4];
+	a3ui32 j;
+	if (additive)
+	{
+		a3poseBlendInternalQuatSlerp(r, 0, pose1->rotate[i].q, w);
+		a3poseBlendInternalQuatProduct(pose_out->rotate[i].q, pose0->rotate[i].q, r);
+		for (j = 0; j < 3; ++j)
+		{
+			t[j] = t0[j] + t1[j] * w;
+			s[j] = s0[j] * (a3real_one + (s1[j] - a3real_one) * w);
+		}
+	}
+	else
+	{
+		r[0] = a3real_one - w;
+		r[1] = w;
+		a3poseBlendInternalQuatSum(pose_out->rotate[i].q, rotate, r, 2, a3true, i);
+		for (j = 0; j < 3; ++j)
+		{
+			t[j] = t0[j] + (t1[j] - t0[j]) * w;
+			s[j] = s0[j] + (s1[j] - s0[j]) * w;
+		}
+	}
+}
+
+// blend four nodes, each by its own weight
+static inline void a3poseBlendInternalBlendNode4(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real *w, const a3boolean additive, const a3ui32 *index)
+{
+#ifdef A3_HIERARCHYSTATEBLEND_SSE
+	const __m128 wv = _mm_loadu_ps(w), one = _mm_set1_ps(1.0f), sign = _mm_set1_ps(-0.0f);
+	const a3real *t0, *t1, *s0, *s1;
+	a3real *t, *s;
+	a3_PoseBlendQuat4 q0, q1;
+	__m128 w0, w1;
+	a3ui32 i, j;
+	a3poseBlendInternalGather4(&q0, pose0->rotate, index);
+	a3poseBlendInternalGather4(&q1, pose1->rotate, index);
+	if (additive)
+	{
+		a3poseBlendInternalSlerp4(&q1, 0, &q1, wv);
+		a3poseBlendInternalProduct4(&q0, &q0, &q1);
+	}
+	else
+	{
+		w0 = _mm_sub_ps(one, wv);
+		w1 = _mm_xor_ps(wv, _mm_and_ps(a3poseBlendInternalDot4(&q0, &q1), sign));
+		q0.x = _mm_add_ps(_mm_mul_ps(q0.x, w0), _mm_mul_ps(q1.x, w1));
+		q0.y = _mm_add_ps(_mm_mul_ps(q0.y, w0), _mm_mul_ps(q1.y, w1));
+		q0.z = _mm_add_ps(_mm_mul_ps(q0.z, w0), _mm_mul_ps(q1.z, w1));
+		q0.w = _mm_add_ps(_mm_mul_ps(q0.w, w0), _mm_mul_ps(q1.w, w1));
+		a3poseBlendInternalNormalize4(&q0);
+	}
+	a3poseBlendInternalScatter4(pose_out->rotate, &q0, index);
+
+	// three components per node are not worth transposing
+	for (i = 0; i < 4; ++i)
+	{
+		t0 = pose0->translate[index[i]].v;
+		t1 = pose1->translate[index[i]].v;
+		s0 = pose0->scale[index[i]].v;
+		s1 = pose1->scale[index[i]].v;
+		t = pose_out->translate[index[i]].v;
+		s = pose_out->scale[index[i]].v;
+		if (additive)
+			for (j = 0; j < 3; ++j)
+			{
+				t[j] = t0[j] + t1[j] * w[i];
+				s[j] = s0[j] * (a3real_one + (s1[j] - a3real_one) * w[i]);
+			}
+		else
+			for (j = 0; j < 3; ++j)
+			{
+				t[j] = t0[j] + (t1[j] - t0[j]) * w[i];
+				s[j] = s0[j] + (s1[j] - s0[j]) * w[i];
+			}
+	}
+#else	// !A3_HIERARCHYSTATEBLEND_SSE
+	a3ui32 i;
+	for (i = 0; i < 4; ++i)
+		a3poseBlendInternalBlendNode(pose_out, pose0, pose1, w[i], additive, index[i]);
+#endif	// A3_HIERARCHYSTATEBLEND_SSE
+}
+
+// nodes outside the optional selection bitset are not touched
+static inline a3i32 a3poseBlendInternalMasked(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3_HierarchyPoseMask *mask, const a3real param, const a3boolean additive, const a3ui32 *select_opt)
+{
+	const a3real u = a3clamp(a3real_zero, a3real_one, param);
+	const a3boolean isInPlace = (pose_out->rotate == pose0->rotate && pose_out->translate == pose0->translate && pose_out->scale == pose0->scale);
+	const a3boolean isFull = (u >= a3real_one);
+	const a3ui32 tail = mask->nodeCount & 31;
+	a3ui32 index[4], count = 0, written = 0, word, bits, select, i;
+	a3real w[4], r[4];
+
+	for (word = 0; word < mask->wordCount; ++word)
+	{
+		select = select_opt ? select_opt[word] : ~0u;
+
+		// nodes left at pose 0: untouched in place, otherwise copied
+		if (!isInPlace)
+		{
+			bits = (u > a3real_zero ? ~mask->nonzero[word] : ~0u) & (word + 1 < mask->wordCount || !tail ? ~0u : (1u << tail) - 1) & select;
+			for (; bits; bits &= bits - 1, ++written)
+				a3poseBlendInternalCopyNode(pose_out, pose0, (word << 5) + a3poseMaskInternalLowestBit(bits));
+		}
+		if (u <= a3real_zero)
+			continue;
+
+		// nodes of full weight: copy pose 1, or add the whole delta
+		bits = isFull ? (mask->full[word] & select) : 0;
+		for (; bits; bits &= bits - 1, ++written)
+		{
+			i = (word << 5) + a3poseMaskInternalLowestBit(bits);
+			if (additive)
+			{
+				a3poseBlendInternalQuatProduct(r, pose0->rotate[i].q, pose1->rotate[i].q);
+				pose_out->rotate[i].x = r[0];
+				pose_out->rotate[i].y = r[1];
+				pose_out->rotate[i].z = r[2];
+				pose_out->rotate[i].w = r[3];
+				a3real3Sum(pose_out->translate[i].v, pose0->translate[i].v, pose1->translate[i].v);
+				pose_out->scale[i].x = pose0->scale[i].x * pose1->scale[i].x;
+				pose_out->scale[i].y = pose0->scale[i].y * pose1->scale[i].y;
+				pose_out->scale[i].z = pose0->scale[i].z * pose1->scale[i].z;
+			}
+			else
+				a3poseBlendInternalCopyNode(pose_out, pose1, i);
+		}
+
+		// the rest blend, in batches of four
+		bits = (isFull ? (mask->nonzero[word] & ~mask->full[word]) : mask->nonzero[word]) & select;
+		for (; bits; bits &= bits - 1, ++written)
+		{
+			i = (word << 5) + a3poseMaskInternalLowestBit(bits);
+			index[count] = i;
+			w[count] = u * mask->weight[i];
+			if (++count == 4)
+			{
+				a3poseBlendInternalBlendNode4(pose_out, pose0, pose1, w, additive, index);
+				count = 0;
+			}
+		}
+	}
+	for (i = 0; i < count; ++i)
+		a3poseBlendInternalBlendNode(pose_out, pose0, pose1, w[i], additive, index[i]);
+	return written;
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3hierarchyPoseCopy(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_in))
+	{
+		if (pose_out->rotate != pose_in->rotate)
+			memcpy(pose_out->rotate, pose_in->rotate, sizeof(a3quat) * nodeCount);
+		if (pose_out->translate != pose_in->translate)
+			memcpy(pose_out->translate, pose_in->translate, sizeof(a3vec3) * nodeCount);
+		if (pose_out->scale != pose_in->scale)
+			memcpy(pose_out->scale, pose_in->scale, sizeof(a3vec3) * nodeCount);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseReset(const a3_HierarchyPose *pose_out, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out))
+	{
+		a3poseBlendInternalRotateReset(pose_out->rotate, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, 0, 0, 0, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalSum(pose_out->scale->v, 0, 0, 0, a3real_one, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+// linear family: weighted sums of up to four poses
+static inline a3i32 a3hierarchyPoseInternalSum(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *const *pose, const a3real *w, const a3ui32 count, const a3boolean normalize, const a3ui32 nodeCount)
+{
+	const a3quat *rotate[A3_POSEBLEND_SUM_MAX];
+	const a3real *translate[A3_POSEBLEND_SUM_MAX], *scale[A3_POSEBLEND_SUM_MAX];
+	a3ui32 k;
+	if (!a3poseBlendInternalValid(pose_out))
+		return -1;
+	for (k = 0; k < count; ++k)
+	{
+		if (!a3poseBlendInternalValid(pose[k]))
+			return -1;
+		rotate[k] = pose[k]->rotate;
+		translate[k] = pose[k]->translate->v;
+		scale[k] = pose[k]->scale->v;
+	}
+	a3poseBlendInternalRotateSum(pose_out->rotate, rotate, w, count, normalize, nodeCount);
+	a3poseBlendInternalSum(pose_out->translate->v, translate, w, count, a3real_zero, nodeCount * 3);
+	a3poseBlendInternalSum(pose_out->scale->v, scale, w, count, a3real_zero, nodeCount * 3);
+	return nodeCount;
+}
+
+a3i32 a3hierarchyPoseLerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount)
+{
+	const a3_HierarchyPose *pose[2] = { pose0, pose1 };
+	const a3real w[2] = { a3real_one - u, u };
+	return a3hierarchyPoseInternalSum(pose_out, pose, w, 2, a3false, nodeCount);
+}
+
+a3i32 a3hierarchyPoseNlerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount)
+{
+	const a3_HierarchyPose *pose[2] = { pose0, pose1 };
+	const a3real w[2] = { a3real_one - u, u };
+	return a3hierarchyPoseInternalSum(pose_out, pose, w, 2, a3true, nodeCount);
+}
+
+a3i32 a3hierarchyPoseSlerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose0) && a3poseBlendInternalValid(pose1))
+	{
+		const a3real *translate[2] = { pose0->translate->v, pose1->translate->v };
+		const a3real *scale[2] = { pose0->scale->v, pose1->scale->v };
+		const a3real w[2] = { a3real_one - u, u };
+		a3poseBlendInternalRotateSlerp(pose_out->rotate, pose0->rotate, pose1->rotate, u, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, translate, w, 2, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalSum(pose_out->scale->v, scale, w, 2, a3real_zero, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseAdd(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_base, const a3_HierarchyPose *pose_delta, const a3real u, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_base) && a3poseBlendInternalValid(pose_delta))
+	{
+		const a3real *translate[2] = { pose_base->translate->v, pose_delta->translate->v };
+		const a3real w[2] = { a3real_one, u };
+		a3poseBlendInternalRotateProduct(pose_out->rotate, pose_base->rotate, pose_delta->rotate, u, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, translate, w, 2, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalProductSum(pose_out->scale->v, pose_base->scale->v, pose_delta->scale->v, u, a3real_one - u, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseScale(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3real u, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_in))
+	{
+		const a3real *translate = pose_in->translate->v, *scale = pose_in->scale->v;
+		a3poseBlendInternalRotateSlerp(pose_out->rotate, 0, pose_in->rotate, u, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, &translate, &u, 1, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalSum(pose_out->scale->v, &scale, &u, 1, a3real_one - u, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseInvert(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_in))
+	{
+		const a3real *translate = pose_in->translate->v, w = -a3real_one;
+		a3poseBlendInternalRotateConjugate(pose_out->rotate, pose_in->rotate, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, &translate, &w, 1, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalReciprocal(pose_out->scale->v, pose_in->scale->v, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseConcat(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_lh, const a3_HierarchyPose *pose_rh, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_lh) && a3poseBlendInternalValid(pose_rh))
+	{
+		const a3real *translate[2] = { pose_lh->translate->v, pose_rh->translate->v };
+		const a3real w[2] = { a3real_one, a3real_one };
+		a3poseBlendInternalRotateProduct(pose_out->rotate, pose_lh->rotate, pose_rh->rotate, a3real_one, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, translate, w, 2, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalProductSum(pose_out->scale->v, pose_lh->scale->v, pose_rh->scale->v, a3real_one, a3real_zero, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseTriangular(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3_HierarchyPose *pose2, const a3real u1, const a3real u2, const a3ui32 nodeCount)
+{
+	const a3_HierarchyPose *pose[3] = { pose0, pose1, pose2 };
+	const a3real w[3] = { a3real_one - u1 - u2, u1, u2 };
+	return a3hierarchyPoseInternalSum(pose_out, pose, w, 3, a3true, nodeCount);
+}
+
+a3i32 a3hierarchyPoseBilinear(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose00, const a3_HierarchyPose *pose01, const a3_HierarchyPose *pose10, const a3_HierarchyPose *pose11, const a3real u0, const a3real u1, const a3ui32 nodeCount)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose00) && a3poseBlendInternalValid(pose01) && a3poseBlendInternalValid(pose10) && a3poseBlendInternalValid(pose11))
+	{
+		// bilinear weights expand to a single weighted sum
+		const a3real *translate[4] = { pose00->translate->v, pose01->translate->v, pose10->translate->v, pose11->translate->v };
+		const a3real *scale[4] = { pose00->scale->v, pose01->scale->v, pose10->scale->v, pose11->scale->v };
+		const a3real w[4] = { (a3real_one - u0) * (a3real_one - u1), u0 * (a3real_one - u1), (a3real_one - u0) * u1, u0 * u1 };
+		a3poseBlendInternalRotateBilinear(pose_out->rotate, pose00->rotate, pose01->rotate, pose10->rotate, pose11->rotate, u0, u1, nodeCount);
+		a3poseBlendInternalSum(pose_out->translate->v, translate, w, 4, a3real_zero, nodeCount * 3);
+		a3poseBlendInternalSum(pose_out->scale->v, scale, w, 4, a3real_zero, nodeCount * 3);
+		return nodeCount;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// blend programs
+
+// block alignment
+#define A3_HIERARCHYSTATEBLEND_ALIGN		16
+#define a3hierarchyBlendInternalAlign(sz)	(((sz) + (A3_HIERARCHYSTATEBLEND_ALIGN - 1)) & ~(A3_HIERARCHYSTATEBLEND_ALIGN - 1))
+
+static inline a3ubyte *a3hierarchyBlendInternalAlignPtr(void *ptr)
+{
+	return (a3ubyte *)a3hierarchyBlendInternalAlign((size_t)ptr);
+}
+
+// graph node state while compiling
+enum
+{
+	a3blendInternal_unvisited = -1,
+	a3blendInternal_visiting = -2,
+};
+
+// op being compiled; inputs refer to other compiled ops until slots are 
+//	assigned, fixed poses are ops that never run
+typedef struct a3_HierarchyBlendInternalOp
+{
+	a3_HierarchyBlendOp op;
+	a3ui32 pose;
+	a3i32 lastUse;
+	a3boolean isPose, isConstant, isPinned;
+} a3_HierarchyBlendInternalOp;
+
+typedef struct a3_HierarchyBlendInternalCompiler
+{
+	const a3_HierarchyPoseGroup *poseGroup;
+	const a3_HierarchyBlendNode *node;
+	a3ui32 nodeCount;
+
+	// compiled op for each graph node, or visit state
+	a3i32 *result;
+
+	a3_HierarchyBlendInternalOp *op;
+	a3ui32 opCount, paramCount, controllerCount;
+} a3_HierarchyBlendInternalCompiler;
+
+static inline a3ui32 a3hierarchyBlendInternalInputCount(const a3_HierarchyBlendOpCode code)
+{
+	return (code == a3blendOp_sample ? 0 : code == a3blendOp_copy ? 1 : 2);
+}
+
+static inline a3_HierarchyBlendInternalOp *a3hierarchyBlendInternalEmit(a3_HierarchyBlendInternalCompiler *compiler, const a3_HierarchyBlendOpCode code)
+{
+	a3_HierarchyBlendInternalOp *op = compiler->op + compiler->opCount;
+	memset(op, 0, sizeof(a3_HierarchyBlendInternalOp));
+	op->op.code = code;
+	op->op.param = -1;
+	return op;
+}
+
+// fold graph node into compiled ops, depth first so inputs come before 
+//	the ops reading them; returns op index holding node's result
+static a3i32 a3hierarchyBlendInternalFold(a3_HierarchyBlendInternalCompiler *compiler, const a3ui32 nodeIndex)
+{
+	const a3_HierarchyBlendNode *node = compiler->node + nodeIndex;
+	a3_HierarchyBlendInternalOp *op;
+	a3i32 result = -1, input0, input1;
+	a3boolean isConstantWeight;
+
+	// out of range or cycle
+	if (nodeIndex >= compiler->nodeCount || compiler->result[nodeIndex] == a3blendInternal_visiting)
+		return -1;
+	if (compiler->result[nodeIndex] >= 0)
+		return compiler->result[nodeIndex];
+	compiler->result[nodeIndex] = a3blendInternal_visiting;
+	isConstantWeight = (node->param < 0);
+
+	switch (node->type)
+	{
+	case a3blendNode_pose:
+		if (node->source < compiler->poseGroup->poseCount)
+		{
+			op = a3hierarchyBlendInternalEmit(compiler, a3blendOp_copy);
+			op->pose = node->source;
+			op->isPose = op->isConstant = a3true;
+			result = compiler->opCount++;
+		}
+		break;
+	case a3blendNode_sample:
+		op = a3hierarchyBlendInternalEmit(compiler, a3blendOp_sample);
+		op->op.source = node->source;
+		compiler->controllerCount = a3maximum(compiler->controllerCount, node->source + 1);
+		result = compiler->opCount++;
+		break;
+	case a3blendNode_lerp:
+	case a3blendNode_add:
+	case a3blendNode_layer:
+		// a constant weight that selects one input drops the other subtree, 
+		//	as does a mask with no weighted nodes
+		if ((isConstantWeight && node->weight == a3real_zero) || (node->mask && !node->mask->nonzeroCount))
+			result = a3hierarchyBlendInternalFold(compiler, node->input[0]);
+		else if (node->type == a3blendNode_lerp && (node->input[0] == node->input[1]))
+			result = a3hierarchyBlendInternalFold(compiler, node->input[0]);
+		else if (node->type == a3blendNode_lerp && isConstantWeight && node->weight == a3real_one)
+			result = a3hierarchyBlendInternalFold(compiler, node->input[1]);
+		else if (node->mask ? (node->mask->weight && node->mask->nodeCount == compiler->poseGroup->hierarchy->numNodes) : (node->type != a3blendNode_layer))
+		{
+			input0 = a3hierarchyBlendInternalFold(compiler, node->input[0]);
+			input1 = a3hierarchyBlendInternalFold(compiler, node->input[1]);
+			if (input0 >= 0 && input1 >= 0)
+			{
+				op = a3hierarchyBlendInternalEmit(compiler, 
+					node->type == a3blendNode_lerp ? a3blendOp_lerp : node->type == a3blendNode_add ? a3blendOp_add : a3blendOp_layer);
+				op->op.in[0] = input0;
+				op->op.in[1] = input1;
+				op->op.param = node->param;
+				op->op.weight = node->weight;
+				op->op.mask = node->mask;
+				op->isConstant = isConstantWeight && compiler->op[input0].isConstant && compiler->op[input1].isConstant;
+				if (!isConstantWeight)
+					compiler->paramCount = a3maximum(compiler->paramCount, (a3ui32)node->param + 1);
+				result = compiler->opCount++;
+			}
+		}
+		break;
+	}
+	compiler->result[nodeIndex] = result;
+	return result;
+}
+
+static inline a3i32 a3hierarchyBlendInternalSample(const a3_HierarchyPoseGroup *poseGroup, const a3_HierarchyPose *pose_out, const a3_HierarchyBlendSampleKey *key, const a3ui32 nodeCount)
+{
+	const a3_Clip *clip;
+	const a3_Keyframe *keyframe;
+	a3ui32 next;
+	if (key->clipPool && key->clip < key->clipPool->count)
+	{
+		// blend toward the next keyframe; the final one blends toward where 
+		//	the clip continues, or holds if it pauses there
+		clip = key->clipPool->clip + key->clip;
+		keyframe = clip->keyframePool->keyframe;
+		next = key->keyframe < clip->keyframeIndex_final ? key->keyframe + 1 : 
+			clip->transitionForward.pause ? key->keyframe : clip->transitionForward.keyframe;
+		if (keyframe[key->keyframe].data < poseGroup->poseCount && keyframe[next].data < poseGroup->poseCount)
+			return a3hierarchyPoseNlerp(pose_out, poseGroup->hpose + keyframe[key->keyframe].data, poseGroup->hpose + keyframe[next].data, key->keyframeParam, nodeCount);
+	}
+	return -1;
+}
+
+static inline a3i32 a3hierarchyBlendInternalSampleController(const a3_HierarchyPoseGroup *poseGroup, const a3_HierarchyPose *pose_out, const a3_ClipController *clipCtrl, const a3ui32 nodeCount)
+{
+	a3_HierarchyBlendSampleKey key[1];
+	key->clipPool = clipCtrl->clipPool;
+	key->clip = clipCtrl->clip;
+	key->keyframe = clipCtrl->keyframe;
+	key->keyframeParam = clipCtrl->keyframeParam;
+	return a3hierarchyBlendInternalSample(poseGroup, pose_out, key, nodeCount);
+}
+
+static inline a3i32 a3hierarchyBlendInternalExecute(const a3_HierarchyBlendProgram *program, const a3_HierarchyBlendOp *op, const a3_HierarchyPose *pose_out, const a3real *param, const a3_ClipController *controller)
+{
+	const a3ui32 nodeCount = program->poseGroup->hierarchy->numNodes;
+	const a3_HierarchyPose *out = op->out ? program->slot + op->out : pose_out;
+	const a3_HierarchyPose *in0 = program->slot + op->in[0], *in1 = program->slot + op->in[1];
+	const a3real weight = op->param >= 0 ? param[op->param] : op->weight;
+	switch (op->code)
+	{
+	case a3blendOp_copy:
+		return a3hierarchyPoseCopy(out, in0, nodeCount);
+	case a3blendOp_sample:
+		if (program->sampleCache && program->sampleCache->poseGroup == program->poseGroup)
+			return a3hierarchySampleCacheSample(program->sampleCache, out, controller + op->source, a3poseChannel_all);
+		return a3hierarchyBlendInternalSampleController(program->poseGroup, out, controller + op->source, nodeCount);
+	case a3blendOp_lerp:
+		return a3hierarchyPoseNlerp(out, in0, in1, weight, nodeCount);
+	case a3blendOp_add:
+		if (op->mask)
+			return a3poseBlendInternalMasked(out, in0, in1, op->mask, weight, a3true, 0);
+		return a3hierarchyPoseAdd(out, in0, in1, weight, nodeCount);
+	case a3blendOp_layer:
+		return a3poseBlendInternalMasked(out, in0, in1, op->mask, weight, a3false, 0);
+	}
+	return -1;
+}
+
+// sampled pose changes unless the controller only moved in time within a 
+//	keyframe that blends a pose with itself
+static inline a3boolean a3hierarchyBlendInternalSampleChanged(const a3_HierarchyBlendSampleKey *last, const a3_ClipController *clipCtrl)
+{
+	const a3_Clip *clip;
+	const a3_Keyframe *keyframe;
+	a3ui32 next;
+	if (last->clipPool != clipCtrl->clipPool || last->clip != clipCtrl->clip || last->keyframe != clipCtrl->keyframe)
+		return a3true;
+	if (last->keyframeParam == clipCtrl->keyframeParam)
+		return a3false;
+	if (clipCtrl->clipPool && clipCtrl->clip < clipCtrl->clipPool->count)
+	{
+		clip = clipCtrl->clipPool->clip + clipCtrl->clip;
+		keyframe = clip->keyframePool->keyframe;
+		next = clipCtrl->keyframe < clip->keyframeIndex_final ? clipCtrl->keyframe + 1 : 
+			clip->transitionForward.pause ? clipCtrl->keyframe : clip->transitionForward.keyframe;
+		return (keyframe[clipCtrl->keyframe].data != keyframe[next].data);
+	}
+	return a3true;
+}
+
+// view of a pose starting at a node
+static inline void a3hierarchyBlendInternalView(a3_HierarchyPose *view_out, const a3_HierarchyPose *pose, const a3ui32 first)
+{
+	view_out->rotate = pose->rotate + first;
+	view_out->translate = pose->translate + first;
+	view_out->scale = pose->scale + first;
+}
+
+// tracked execution: marks the nodes of the op's slot that change, from 
+//	its inputs' marks, its weight and its controller, and recomputes only 
+//	those (all nodes if 'all'); returns -1 if the op fails
+static inline a3i32 a3hierarchyBlendInternalExecuteMarked(const a3_HierarchyBlendProgram *program, const a3_HierarchyBlendOp *op, const a3_HierarchyPose *pose_out, const a3real *param, const a3_ClipController *controller, const a3boolean all)
+{
+	const a3ui32 nodeCount = program->poseGroup->hierarchy->numNodes, wordCount = program->wordCount;
+	const a3ui32 *dirty0 = program->slotDirty + op->in[0] * wordCount, *dirty1 = program->slotDirty + op->in[1] * wordCount;
+	const a3_HierarchyPose *out = op->out ? program->slot + op->out : pose_out;
+	const a3_HierarchyPose *in0 = program->slot + op->in[0], *in1 = program->slot + op->in[1];
+	const a3real weight = op->param >= 0 ? param[op->param] : op->weight;
+	const a3boolean weightChanged = (op->param >= 0 && program->paramLast[op->param] != weight);
+	const a3boolean sampleChanged = (op->code == a3blendOp_sample && !all && 
+		a3hierarchyBlendInternalSampleChanged(program->sampleLast + op->source, controller + op->source));
+	const a3ui32 tail = nodeCount & 31;
+	a3ui32 *dirty = program->slotDirty + op->out * wordCount;
+	a3_HierarchyPose outView[1], inView0[1], inView1[1];
+	a3ui32 i, first, any;
+	a3i32 ret = 0;
+
+	// marks: everything, or what the inputs, weight and controller change
+	for (i = any = 0; i < wordCount; ++i)
+	{
+		if (all)
+			dirty[i] = ~0u;
+		else switch (op->code)
+		{
+		case a3blendOp_copy:
+			dirty[i] = dirty0[i];
+			break;
+		case a3blendOp_sample:
+			dirty[i] = sampleChanged ? ~0u : 0;
+			break;
+		case a3blendOp_lerp:
+		case a3blendOp_add:
+			if (!op->mask)
+			{
+				dirty[i] = weightChanged ? ~0u : (dirty0[i] | dirty1[i]);
+				break;
+			}
+			// masked add: as layer
+		case a3blendOp_layer:
+			dirty[i] = dirty0[i] | ((dirty1[i] | (weightChanged ? ~0u : 0)) & op->mask->nonzero[i]);
+			break;
+		}
+		if (i + 1 == wordCount && tail)
+			dirty[i] &= (1u << tail) - 1;
+		any |= dirty[i];
+	}
+	if (!any)
+		return 0;
+
+	// samples and whole-pose updates run over everything, masked blends 
+	//	select marked nodes, the rest run over each span of marked nodes
+	if (all || op->code == a3blendOp_sample || op->code == a3blendOp_copy)
+		return a3hierarchyBlendInternalExecute(program, op, pose_out, param, controller);
+	if (op->mask)
+		return a3poseBlendInternalMasked(out, in0, in1, op->mask, weight, op->code == a3blendOp_add, dirty);
+	for (i = 0; i < nodeCount && ret >= 0; )
+	{
+		if (!dirty[i >> 5])
+		{
+			i = (i + 32) & ~31u;
+			continue;
+		}
+		if (!(dirty[i >> 5] & (1u << (i & 31))))
+		{
+			++i;
+			continue;
+		}
+		for (first = i; i < nodeCount && (dirty[i >> 5] & (1u << (i & 31))); ++i);
+		a3hierarchyBlendInternalView(outView, out, first);
+		a3hierarchyBlendInternalView(inView0, in0, first);
+		a3hierarchyBlendInternalView(inView1, in1, first);
+		ret = op->code == a3blendOp_lerp ? a3hierarchyPoseNlerp(outView, inView0, inView1, weight, i - first) : 
+			a3hierarchyPoseAdd(outView, inView0, inView1, weight, i - first);
+	}
+	return ret;
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3hierarchyPoseMaskCreate(a3_HierarchyPoseMask *mask_out, const a3ui32 nodeCount)
+{
+	if (mask_out && !mask_out->weight && nodeCount)
+	{
+		const a3ui32 wordCount = (nodeCount + 31) >> 5;
+		mask_out->data = malloc(sizeof(a3real) * nodeCount + sizeof(a3ui32) * wordCount * 2);
+		if (mask_out->data)
+		{
+			memset(mask_out->data, 0, sizeof(a3real) * nodeCount + sizeof(a3ui32) * wordCount * 2);
+			mask_out->weight = (a3real *)mask_out->data;
+			mask_out->nonzero = (a3ui32 *)(mask_out->weight + nodeCount);
+			mask_out->full = mask_out->nonzero + wordCount;
+			mask_out->nodeCount = nodeCount;
+			mask_out->wordCount = wordCount;
+			mask_out->nonzeroCount = mask_out->fullCount = 0;
+			return nodeCount;
+		}
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseMaskRelease(a3_HierarchyPoseMask *mask)
+{
+	if (mask && mask->weight)
+	{
+		free(mask->data);
+		mask->weight = 0;
+		mask->nonzero = mask->full = 0;
+		mask->data = 0;
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseMaskSetBranch(a3_HierarchyPoseMask *mask, const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex, const a3real weight)
+{
+	a3ui32 i, count;
+	if (mask && mask->weight && hierarchy && hierarchy->parentIndex && nodeIndex < hierarchy->numNodes && mask->nodeCount == hierarchy->numNodes)
+	{
+		for (i = count = 0; i < mask->nodeCount; ++i)
+			if (a3hierarchyIsAncestorNode(hierarchy, nodeIndex, i) > 0)
+			{
+				mask->weight[i] = weight;
+				++count;
+			}
+		return count;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseMaskUpdate(a3_HierarchyPoseMask *mask)
+{
+	a3ui32 i, bit;
+	if (mask && mask->weight)
+	{
+		memset(mask->nonzero, 0, sizeof(a3ui32) * mask->wordCount * 2);
+		mask->nonzeroCount = mask->fullCount = 0;
+		for (i = 0; i < mask->nodeCount; ++i)
+		{
+			mask->weight[i] = a3clamp(a3real_zero, a3real_one, mask->weight[i]);
+			bit = 1u << (i & 31);
+			if (mask->weight[i] > a3real_zero)
+			{
+				mask->nonzero[i >> 5] |= bit;
+				++mask->nonzeroCount;
+			}
+			if (mask->weight[i] >= a3real_one)
+			{
+				mask->full[i >> 5] |= bit;
+				++mask->fullCount;
+			}
+		}
+		return mask->nonzeroCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyPoseLerpMasked(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3_HierarchyPoseMask *mask, const a3real u)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose0) && a3poseBlendInternalValid(pose1) && mask && mask->weight)
+		return a3poseBlendInternalMasked(pose_out, pose0, pose1, mask, u, a3false, 0);
+	return -1;
+}
+
+a3i32 a3hierarchyPoseAddMasked(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_base, const a3_HierarchyPose *pose_delta, const a3_HierarchyPoseMask *mask, const a3real u)
+{
+	if (a3poseBlendInternalValid(pose_out) && a3poseBlendInternalValid(pose_base) && a3poseBlendInternalValid(pose_delta) && mask && mask->weight)
+		return a3poseBlendInternalMasked(pose_out, pose_base, pose_delta, mask, u, a3true, 0);
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3hierarchyBlendProgramCompile(a3_HierarchyBlendProgram *program_out, const a3_HierarchyPoseGroup *poseGroup, const a3_HierarchyBlendNode *node, const a3ui32 nodeCount, const a3ui32 rootIndex, const a3boolean tracked)
+{
+	if (program_out && !program_out->poseGroup && poseGroup && poseGroup->hierarchy && node && rootIndex < nodeCount)
+	{
+		const a3ui32 hierarchyNodeCount = poseGroup->hierarchy->numNodes;
+		const size_t rotateSize = a3hierarchyBlendInternalAlign(sizeof(a3quat) * hierarchyNodeCount);
+		const size_t translateSize = a3hierarchyBlendInternalAlign(sizeof(a3vec3) * hierarchyNodeCount);
+		a3_HierarchyBlendInternalCompiler compiler[1];
+		a3_HierarchyBlendInternalOp *op, *input;
+		a3_HierarchyBlendOp *opOut;
+		const a3ui32 wordCount = (hierarchyNodeCount + 31) >> 5;
+		a3ui32 *slotFree, freeCount, arenaCount, poseCount, opCount, inputCount, i, j;
+		size_t opSize, slotSize, dirtySize, paramSize, sampleSize, dataSize;
+		a3ubyte *data;
+		a3i32 root;
+
+		// at most one op per graph node plus the final copy
+		compiler->op = (a3_HierarchyBlendInternalOp *)malloc((sizeof(a3_HierarchyBlendInternalOp) + sizeof(a3i32) + sizeof(a3ui32)) * (nodeCount + 1));
+		if (!compiler->op)
+			return -1;
+		compiler->result = (a3i32 *)(compiler->op + nodeCount + 1);
+		slotFree = (a3ui32 *)(compiler->result + nodeCount + 1);
+		compiler->poseGroup = poseGroup;
+		compiler->node = node;
+		compiler->nodeCount = nodeCount;
+		compiler->opCount = compiler->paramCount = compiler->controllerCount = 0;
+		for (i = 0; i < nodeCount; ++i)
+			compiler->result[i] = a3blendInternal_unvisited;
+
+		root = a3hierarchyBlendInternalFold(compiler, rootIndex);
+		if (root < 0)
+		{
+			free(compiler->op);
+			return -1;
+		}
+
+		// the result goes to the output slot: the root op writes it if it 
+		//	runs on every evaluation, otherwise it is copied there
+		if (compiler->op[root].isConstant)
+		{
+			op = a3hierarchyBlendInternalEmit(compiler, a3blendOp_copy);
+			op->op.in[0] = root;
+			++compiler->opCount;
+		}
+
+		// last reader of each result; constants read at evaluation are 
+		//	pinned to their own slots so that nothing overwrites them
+		for (i = 0, op = compiler->op; i < compiler->opCount; ++i, ++op)
+			op->lastUse = -1;
+		for (i = 0, op = compiler->op; i < compiler->opCount; ++i, ++op)
+			if (!op->isPose)
+				for (j = 0, inputCount = a3hierarchyBlendInternalInputCount(op->op.code); j < inputCount; ++j)
+				{
+					input = compiler->op + op->op.in[j];
+					input->lastUse = i;
+					input->isPinned |= (input->isConstant && !op->isConstant);
+				}
+
+		// assign arena slots in execution order, reusing the slot of any 
+		//	result read for the last time (ops allow output to alias input); 
+		//	tracked ops keep their own slots
+		for (i = 0, op = compiler->op, arenaCount = freeCount = 0, opCount = 0; i < compiler->opCount; ++i, ++op)
+			if (!op->isPose)
+			{
+				for (j = 0, inputCount = a3hierarchyBlendInternalInputCount(op->op.code); j < inputCount; ++j)
+				{
+					input = compiler->op + op->op.in[j];
+					if (!tracked && input->lastUse == (a3i32)i && !input->isPinned && !input->isPose && (j == 0 || op->op.in[1] != op->op.in[0]))
+						slotFree[freeCount++] = input->op.out;
+				}
+				if (i == compiler->opCount - 1)
+					op->op.out = 0;
+				else if (freeCount && !op->isPinned)
+					op->op.out = slotFree[--freeCount];
+				else
+					op->op.out = 1 + arenaCount++;
+				opCount += !op->isConstant;
+			}
+		for (i = 0, op = compiler->op, poseCount = 0; i < compiler->opCount; ++i, ++op)
+			if (op->isPose)
+				op->op.out = 1 + arenaCount + poseCount++;
+
+		// one block: ops, slots, tracking, arena
+		opSize = a3hierarchyBlendInternalAlign(sizeof(a3_HierarchyBlendOp) * opCount);
+		slotSize = a3hierarchyBlendInternalAlign(sizeof(a3_HierarchyPose) * (1 + arenaCount + poseCount));
+		dirtySize = tracked ? a3hierarchyBlendInternalAlign(sizeof(a3ui32) * wordCount * (1 + arenaCount + poseCount)) : 0;
+		paramSize = a3hierarchyBlendInternalAlign(sizeof(a3real) * compiler->paramCount);
+		sampleSize = a3hierarchyBlendInternalAlign(sizeof(a3_HierarchyBlendSampleKey) * compiler->controllerCount);
+		dataSize = opSize + slotSize + dirtySize + paramSize + sampleSize + (rotateSize + translateSize * 2) * arenaCount;
+		program_out->data = malloc(dataSize + A3_HIERARCHYSTATEBLEND_ALIGN);
+		if (!program_out->data)
+		{
+			free(compiler->op);
+			return -1;
+		}
+		data = a3hierarchyBlendInternalAlignPtr(program_out->data);
+		program_out->op = (a3_HierarchyBlendOp *)data;
+		program_out->slot = (a3_HierarchyPose *)(data += opSize);
+		program_out->slotDirty = tracked ? (a3ui32 *)(data += slotSize) : 0;
+		program_out->paramLast = (a3real *)(data += tracked ? dirtySize : slotSize);
+		program_out->sampleLast = (a3_HierarchyBlendSampleKey *)(data += paramSize);
+		data += sampleSize;
+		program_out->slot[0].rotate = 0;
+		program_out->slot[0].translate = program_out->slot[0].scale = 0;
+		for (i = 1; i <= arenaCount; ++i)
+		{
+			program_out->slot[i].rotate = (a3quat *)data;
+			program_out->slot[i].translate = (a3vec3 *)(data += rotateSize);
+			program_out->slot[i].scale = (a3vec3 *)(data += translateSize);
+			data += translateSize;
+		}
+		program_out->wordCount = wordCount;
+		program_out->isTracked = tracked;
+		program_out->outputLast->rotate = 0;
+		program_out->outputLast->translate = program_out->outputLast->scale = 0;
+		if (tracked)
+			memset(program_out->slotDirty, 0, dirtySize);
+		program_out->sampleCache = 0;
+		program_out->poseGroup = poseGroup;
+		program_out->opCount = opCount;
+		program_out->slotCount = 1 + arenaCount + poseCount;
+		program_out->arenaCount = arenaCount;
+		program_out->paramCount = compiler->paramCount;
+		program_out->controllerCount = compiler->controllerCount;
+
+		// bind fixed poses, resolve inputs to slots, then run constant ops 
+		//	once and keep the rest
+		for (i = 0, op = compiler->op; i < compiler->opCount; ++i, ++op)
+			if (op->isPose)
+				program_out->slot[op->op.out] = poseGroup->hpose[op->pose];
+		for (i = 0, op = compiler->op, opOut = program_out->op; i < compiler->opCount; ++i, ++op)
+			if (!op->isPose)
+			{
+				for (j = 0, inputCount = a3hierarchyBlendInternalInputCount(op->op.code); j < inputCount; ++j)
+					op->op.in[j] = compiler->op[op->op.in[j]].op.out;
+				for (; j < 2; ++j)
+					op->op.in[j] = 0;
+				if (op->isConstant)
+					a3hierarchyBlendInternalExecute(program_out, &op->op, 0, 0, 0);
+				else
+					*(opOut++) = op->op;
+			}
+
+		free(compiler->op);
+		return opCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyBlendProgramRelease(a3_HierarchyBlendProgram *program)
+{
+	if (program && program->poseGroup)
+	{
+		free(program->data);
+		program->poseGroup = 0;
+		program->op = 0;
+		program->slot = 0;
+		program->slotDirty = 0;
+		program->paramLast = 0;
+		program->sampleLast = 0;
+		program->isTracked = 0;
+		program->sampleCache = 0;
+		program->data = 0;
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyBlendProgramEvaluate(a3_HierarchyBlendProgram *program, const a3_HierarchyPose *pose_out, const a3real *param, const a3ui32 paramCount, const a3_ClipController *controller, const a3ui32 controllerCount)
+{
+	if (program && program->poseGroup && a3poseBlendInternalValid(pose_out) && 
+		(param || !program->paramCount) && paramCount >= program->paramCount && 
+		(controller || !program->controllerCount) && controllerCount >= program->controllerCount)
+	{
+		const a3_HierarchyBlendOp *op = program->op, *const end = op + program->opCount;
+
+		// slots and output no longer match what tracking recorded
+		program->outputLast->rotate = 0;
+		for (; op < end; ++op)
+			if (a3hierarchyBlendInternalExecute(program, op, pose_out, param, controller) < 0)
+				return -1;
+		return program->opCount;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchyBlendProgramEvaluateChanged(a3_HierarchyBlendProgram *program, const a3_HierarchyPose *pose_out, a3ui32 *dirty_out, const a3real *param, const a3ui32 paramCount, const a3_ClipController *controller, const a3ui32 controllerCount)
+{
+	if (program && program->poseGroup && program->isTracked && a3poseBlendInternalValid(pose_out) && dirty_out && 
+		(param || !program->paramCount) && paramCount >= program->paramCount && 
+		(controller || !program->controllerCount) && controllerCount >= program->controllerCount)
+	{
+		const a3_HierarchyBlendOp *op = program->op, *const end = op + program->opCount;
+		const a3boolean all = (program->outputLast->rotate != pose_out->rotate || 
+			program->outputLast->translate != pose_out->translate || program->outputLast->scale != pose_out->scale);
+		a3_HierarchyBlendSampleKey *key;
+		a3ui32 i, bits, count;
+
+		// a failed op leaves slots in an unknown state
+		program->outputLast->rotate = 0;
+		for (; op < end; ++op)
+			if (a3hierarchyBlendInternalExecuteMarked(program, op, pose_out, param, controller, all) < 0)
+				return -1;
+
+		// record what the slots now hold, then pass on the output's marks
+		for (i = 0; i < program->paramCount; ++i)
+			program->paramLast[i] = param[i];
+		for (i = 0, key = program->sampleLast; i < program->controllerCount; ++i, ++key)
+		{
+			key->clipPool = controller[i].clipPool;
+			key->clip = controller[i].clip;
+			key->keyframe = controller[i].keyframe;
+			key->keyframeParam = controller[i].keyframeParam;
+		}
+		*program->outputLast = *pose_out;
+		for (i = count = 0; i < program->wordCount; ++i)
+		{
+			dirty_out[i] |= bits = program->slotDirty[i];
+			for (; bits; bits &= bits - 1)
+				++count;
+		}
+		return count;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// sample cache
+
+// key for a controller's position, snapped to the tolerance
+static inline a3i32 a3hierarchySampleCacheInternalKey(a3_HierarchyBlendSampleKey *key_out, const a3_HierarchySampleCache *cache, const a3_ClipController *clipCtrl)
+{
+	const a3_Clip *clip;
+	a3real time;
+	a3i32 keyframe;
+	if (clipCtrl->clipPool && clipCtrl->clip < clipCtrl->clipPool->count)
+	{
+		key_out->clipPool = clipCtrl->clipPool;
+		key_out->clip = clipCtrl->clip;
+		if (cache->tolerance > a3real_zero)
+		{
+			clip = clipCtrl->clipPool->clip + clipCtrl->clip;
+			time = (a3real)(a3ui32)(a3maximum(clipCtrl->clipTime, a3real_zero) / cache->tolerance + a3real_half) * cache->tolerance;
+			keyframe = a3clipGetKeyframeIndex(clip, a3minimum(time, clip->duration), &time);
+			if (keyframe < 0)
+				return -1;
+			key_out->keyframe = (a3ui32)keyframe;
+			key_out->keyframeParam = time * clip->keyframePool->keyframe[keyframe].durationInv;
+		}
+		else
+		{
+			key_out->keyframe = clipCtrl->keyframe;
+			key_out->keyframeParam = clipCtrl->keyframeParam;
+		}
+		return 1;
+	}
+	return -1;
+}
+
+static inline a3ui32 a3hierarchySampleCacheInternalHash(const a3_HierarchyBlendSampleKey *key)
+{
+	a3ui32 h = (a3ui32)(size_t)key->clipPool * 0x9e3779b1;
+	h ^= key->clip * 0x85ebca77;
+	h ^= key->keyframe * 0xc2b2ae3d;
+	h ^= (a3ui32)(key->keyframeParam * (a3real)65536.0) * 0x27d4eb2f;
+	return (h ^ (h >> 15));
+}
+
+// find entry for key, adding and sampling it if absent; -1 if full
+static inline a3i32 a3hierarchySampleCacheInternalFind(a3_HierarchySampleCache *cache, const a3_HierarchyBlendSampleKey *key)
+{
+	const a3_HierarchyBlendSampleKey *other;
+	a3ui32 i = a3hierarchySampleCacheInternalHash(key) & cache->bucketMask;
+	a3i32 entry;
+
+	// linear probing; the table is never more than half full
+	for (; (entry = cache->bucket[i]) >= 0; i = (i + 1) & cache->bucketMask)
+	{
+		other = cache->key + entry;
+		if (other->clip == key->clip && other->keyframe == key->keyframe && 
+			other->keyframeParam == key->keyframeParam && other->clipPool == key->clipPool)
+		{
+			++cache->hitCount;
+			return entry;
+		}
+	}
+	++cache->missCount;
+	if (cache->count < cache->capacity)
+	{
+		entry = cache->count;
+		if (a3hierarchyBlendInternalSample(cache->poseGroup, cache->pose + entry, key, cache->poseGroup->hierarchy->numNodes) < 0)
+			return -1;
+		cache->key[entry] = *key;
+		cache->bucket[i] = entry;
+		++cache->count;
+		return entry;
+	}
+	return -1;
+}
+
+
+a3i32 a3hierarchySampleCacheCreate(a3_HierarchySampleCache *cache_out, const a3_HierarchyPoseGroup *poseGroup, const a3ui32 capacity, const a3real tolerance)
+{
+	if (cache_out && !cache_out->poseGroup && poseGroup && poseGroup->hierarchy && capacity && tolerance >= a3real_zero)
+	{
+		const a3ui32 nodeCount = poseGroup->hierarchy->numNodes;
+		const size_t rotateSize = a3hierarchyBlendInternalAlign(sizeof(a3quat) * nodeCount);
+		const size_t translateSize = a3hierarchyBlendInternalAlign(sizeof(a3vec3) * nodeCount);
+		a3ui32 bucketCount, i;
+		size_t keySize, poseSize, bucketSize;
+		a3ubyte *data;
+
+		for (bucketCount = 2; bucketCount < capacity * 2; bucketCount <<= 1);
+		keySize = a3hierarchyBlendInternalAlign(sizeof(a3_HierarchyBlendSampleKey) * capacity);
+		poseSize = a3hierarchyBlendInternalAlign(sizeof(a3_HierarchyPose) * capacity);
+		bucketSize = a3hierarchyBlendInternalAlign(sizeof(a3i32) * bucketCount);
+		cache_out->data = malloc(keySize + poseSize + bucketSize + (rotateSize + translateSize * 2) * capacity + A3_HIERARCHYSTATEBLEND_ALIGN);
+		if (cache_out->data)
+		{
+			data = a3hierarchyBlendInternalAlignPtr(cache_out->data);
+			cache_out->key = (a3_HierarchyBlendSampleKey *)data;
+			cache_out->pose = (a3_HierarchyPose *)(data += keySize);
+			cache_out->bucket = (a3i32 *)(data += poseSize);
+			data += bucketSize;
+			for (i = 0; i < capacity; ++i)
+			{
+				cache_out->pose[i].rotate = (a3quat *)data;
+				cache_out->pose[i].translate = (a3vec3 *)(data += rotateSize);
+				cache_out->pose[i].scale = (a3vec3 *)(data += translateSize);
+				data += translateSize;
+			}
+			cache_out->poseGroup = poseGroup;
+			cache_out->tolerance = tolerance;
+			cache_out->bucketMask = bucketCount - 1;
+			cache_out->capacity = capacity;
+			cache_out->hitCount = cache_out->missCount = 0;
+			a3hierarchySampleCacheClear(cache_out);
+			return capacity;
+		}
+	}
+	return -1;
+}
+
+a3i32 a3hierarchySampleCacheRelease(a3_HierarchySampleCache *cache)
+{
+	if (cache && cache->poseGroup)
+	{
+		free(cache->data);
+		memset(cache, 0, sizeof(a3_HierarchySampleCache));
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchySampleCacheClear(a3_HierarchySampleCache *cache)
+{
+	if (cache && cache->poseGroup)
+	{
+		memset(cache->bucket, -1, sizeof(a3i32) * (cache->bucketMask + 1));
+		cache->count = 0;
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3hierarchySampleCacheGet(a3_HierarchySampleCache *cache, const a3_HierarchyPose **pose_out, const a3_ClipController *clipCtrl)
+{
+	a3_HierarchyBlendSampleKey key[1];
+	a3i32 entry;
+	if (cache && cache->poseGroup && pose_out && clipCtrl && 
+		a3hierarchySampleCacheInternalKey(key, cache, clipCtrl) >= 0)
+	{
+		entry = a3hierarchySampleCacheInternalFind(cache, key);
+		if (entry >= 0)
+			*pose_out = cache->pose + entry;
+		return entry;
+	}
+	return -1;
+}
 
+a3i32 a3hierarchySampleCacheSample(a3_HierarchySampleCache *cache, const a3_HierarchyPose *pose_out, const a3_ClipController *clipCtrl, const a3ui32 channels)
+{
+	a3_HierarchyBlendSampleKey key[1];
+	const a3_HierarchyPose *pose;
+	a3ui32 nodeCount;
+	a3i32 entry;
+	if (cache && cache->poseGroup && a3poseBlendInternalValid(pose_out) && clipCtrl && 
+		a3hierarchySampleCacheInternalKey(key, cache, clipCtrl) >= 0)
+	{
+		nodeCount = cache->poseGroup->hierarchy->numNodes;
+		entry = a3hierarchySampleCacheInternalFind(cache, key);
+		if (entry < 0)
+			return a3hierarchyBlendInternalSample(cache->poseGroup, pose_out, key, nodeCount);
+		pose = cache->pose + entry;
+		if ((channels & a3poseChannel_all) == a3poseChannel_all)
+			return a3hierarchyPoseCopy(pose_out, pose, nodeCount);
+		if (channels & a3poseChannel_rotate)
+			memcpy(pose_out->rotate, pose->rotate, sizeof(a3quat) * nodeCount);
+		if (channels & a3poseChannel_translate)
+			memcpy(pose_out->translate, pose->translate, sizeof(a3vec3) * nodeCount);
+		if (channels & a3poseChannel_scale)
+			memcpy(pose_out->scale, pose->scale, sizeof(a3vec3) * nodeCount);
+		return nodeCount;
+	}
+	return -1;
+}
 
 
 //-----------------------------------------------------------------------------
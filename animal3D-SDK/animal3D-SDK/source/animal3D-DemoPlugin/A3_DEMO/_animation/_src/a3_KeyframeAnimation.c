@@ -23,7 +23,9 @@
 */
 
 #include "../a3_KeyframeAnimation.h"
+#include "../a3_Hierarchy.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -33,48 +35,433 @@
 #define A3_CLIP_SEARCHNAME		((clipName && *clipName) ? clipName : A3_CLIP_DEFAULTNAME)
 
 
+//-----------------------------------------------------------------------------
+
+// name table: unnamed clips are never indexed
+static inline void a3clipPoolInternalInsertName(a3_ClipPool* clipPool, const a3ui32 index)
+{
+	const a3ui32 bucket = (clipPool->nameHash[index] = a3hierarchyHashName(clipPool->clip[index].name)) & clipPool->nameBucketMask;
+	if (*clipPool->clip[index].name)
+	{
+		clipPool->nameNext[index] = clipPool->nameBucket[bucket];
+		clipPool->nameBucket[bucket] = index;
+	}
+}
+
+static inline void a3clipPoolInternalRemoveName(a3_ClipPool* clipPool, const a3ui32 index)
+{
+	a3i32* link = clipPool->nameBucket + (clipPool->nameHash[index] & clipPool->nameBucketMask);
+	while (*link >= 0 && *link != (a3i32)index)
+		link = clipPool->nameNext + *link;
+	if (*link >= 0)
+		*link = clipPool->nameNext[index];
+	clipPool->nameNext[index] = -1;
+}
+
+static inline a3i32 a3clipPoolInternalGetIndexHashed(const a3_ClipPool* clipPool, const a3ui32 nameHash, const a3byte name[a3keyframeAnimation_nameLenMax])
+{
+	// lowest matching index wins, as with a linear scan
+	a3i32 i = clipPool->nameBucket[nameHash & clipPool->nameBucketMask], ret = -1;
+	for (; i >= 0; i = clipPool->nameNext[i])
+		if (clipPool->nameHash[i] == nameHash && (!name || !strncmp(clipPool->clip[i].name, name, a3keyframeAnimation_nameLenMax)))
+			if (ret < 0 || i < ret)
+				ret = i;
+	return ret;
+}
+
+
 //-----------------------------------------------------------------------------
 
 // allocate keyframe pool
 a3i32 a3keyframePoolCreate(a3_KeyframePool* keyframePool_out, const a3ui32 count)
 {
+	a3ui32 i;
+	if (keyframePool_out && !keyframePool_out->keyframe && count)
+	{
+		keyframePool_out->keyframe = (a3_Keyframe*)malloc(sizeof(a3_Keyframe) * count);
+		if (keyframePool_out->keyframe)
+		{
+			keyframePool_out->count = count;
+			keyframePool_out->revision = 0;
+			keyframePool_out->duration = (a3real)count;
+			for (i = 0; i < count; ++i)
+			{
+				keyframePool_out->keyframe[i].index = i;
+				keyframePool_out->keyframe[i].time = (a3real)i;
+				a3keyframeInit(keyframePool_out->keyframe + i, a3real_one, i);
+			}
+			return count;
+		}
+	}
 	return -1;
 }
 
 // release keyframe pool
 a3i32 a3keyframePoolRelease(a3_KeyframePool* keyframePool)
 {
+	if (keyframePool && keyframePool->keyframe)
+	{
+		free(keyframePool->keyframe);
+		keyframePool->keyframe = 0;
+		keyframePool->count = 0;
+		return 1;
+	}
 	return -1;
 }
 
 // initialize keyframe
 a3i32 a3keyframeInit(a3_Keyframe* keyframe_out, const a3real duration, const a3ui32 value_x)
 {
+	if (keyframe_out && duration > a3real_zero)
+	{
+		keyframe_out->duration = duration;
+		keyframe_out->durationInv = a3recip(duration);
+		keyframe_out->data = value_x;
+		return keyframe_out->index;
+	}
+	return -1;
+}
+
+// recalculate keyframe start times
+a3i32 a3keyframePoolCalculateTime(a3_KeyframePool* keyframePool, const a3ui32 firstIndex)
+{
+	a3_Keyframe* keyframe;
+	a3real time;
+	a3ui32 i;
+	a3boolean changed = a3false;
+	if (keyframePool && keyframePool->keyframe && firstIndex < keyframePool->count)
+	{
+		// a start time or the end moves exactly when some duration before 
+		//	it changed; shifts alone do not stale clip rates, which only 
+		//	depend on durations, so recalculating unchanged keyframes keeps 
+		//	every clip's cached rate
+		keyframe = keyframePool->keyframe;
+		keyframe[0].time = a3real_zero;
+		for (i = firstIndex ? firstIndex : 1; i < keyframePool->count; ++i)
+		{
+			time = keyframe[i - 1].time + keyframe[i - 1].duration;
+			changed |= (keyframe[i].time != time);
+			keyframe[i].time = time;
+		}
+		time = keyframe[i - 1].time + keyframe[i - 1].duration;
+		changed |= (keyframePool->duration != time);
+		keyframePool->duration = time;
+		if (changed)
+			++keyframePool->revision;
+		return keyframePool->count;
+	}
 	return -1;
 }
 
 
-// allocate clip pool
+// allocate clip pool with its name table, at least two buckets per clip
 a3i32 a3clipPoolCreate(a3_ClipPool* clipPool_out, const a3ui32 count)
 {
+	a3ui32 i, bucketCount = 1;
+	if (clipPool_out && !clipPool_out->clip && count)
+	{
+		while (bucketCount < count * 2)
+			bucketCount <<= 1;
+		clipPool_out->clip = (a3_Clip*)malloc((sizeof(a3_Clip) + sizeof(a3ui32) + sizeof(a3i32)) * count + sizeof(a3i32) * bucketCount);
+		if (clipPool_out->clip)
+		{
+			memset(clipPool_out->clip, 0, sizeof(a3_Clip) * count);
+			clipPool_out->nameHash = (a3ui32*)(clipPool_out->clip + count);
+			clipPool_out->nameNext = (a3i32*)(clipPool_out->nameHash + count);
+			clipPool_out->nameBucket = clipPool_out->nameNext + count;
+			clipPool_out->nameBucketMask = bucketCount - 1;
+			memset(clipPool_out->nameHash, 0, sizeof(a3ui32) * count);
+			memset(clipPool_out->nameNext, -1, sizeof(a3i32) * count);
+			memset(clipPool_out->nameBucket, -1, sizeof(a3i32) * bucketCount);
+			clipPool_out->count = count;
+			for (i = 0; i < count; ++i)
+				clipPool_out->clip[i].index = i;
+			return count;
+		}
+	}
 	return -1;
 }
 
 // release clip pool
 a3i32 a3clipPoolRelease(a3_ClipPool* clipPool)
 {
+	if (clipPool && clipPool->clip)
+	{
+		free(clipPool->clip);
+		clipPool->clip = 0;
+		clipPool->count = 0;
+		clipPool->nameHash = 0;
+		clipPool->nameNext = 0;
+		clipPool->nameBucket = 0;
+		clipPool->nameBucketMask = 0;
+		return 1;
+	}
 	return -1;
 }
 
 // initialize clip with first and last indices
-a3i32 a3clipInit(a3_Clip* clip_out, const a3byte clipName[a3keyframeAnimation_nameLenMax], const a3_KeyframePool* keyframePool, const a3ui32 firstKeyframeIndex, const a3ui32 finalKeyframeIndex)
+a3i32 a3clipInit(a3_ClipPool* clipPool, const a3ui32 clipIndex, const a3byte clipName[a3keyframeAnimation_nameLenMax], a3_KeyframePool* keyframePool, const a3ui32 firstKeyframeIndex, const a3ui32 finalKeyframeIndex)
 {
+	a3_Clip* clip_out;
+	if (clipPool && clipPool->clip && clipIndex < clipPool->count && keyframePool && keyframePool->keyframe && 
+		firstKeyframeIndex <= finalKeyframeIndex && finalKeyframeIndex < keyframePool->count)
+	{
+		clip_out = clipPool->clip + clipIndex;
+		a3clipPoolInternalRemoveName(clipPool, clipIndex);
+		strncpy(clip_out->name, A3_CLIP_SEARCHNAME, a3keyframeAnimation_nameLenMax);
+		clip_out->name[a3keyframeAnimation_nameLenMax - 1] = 0;
+		a3clipPoolInternalInsertName(clipPool, clipIndex);
+		clip_out->keyframePool = keyframePool;
+		clip_out->keyframeIndex_first = firstKeyframeIndex;
+		clip_out->keyframeIndex_final = finalKeyframeIndex;
+		clip_out->keyframeCount = finalKeyframeIndex - firstKeyframeIndex + 1;
+		a3clipCalculateDuration(clip_out);
+		a3clipTransitionInit(&clip_out->transitionForward, clip_out, a3clipTransition_forward);
+		a3clipTransitionInit(&clip_out->transitionReverse, clip_out, a3clipTransition_reverse);
+		return clip_out->index;
+	}
+	return -1;
+}
+
+// detect uniform spacing of all clips
+a3i32 a3clipPoolCalculateRate(a3_ClipPool* clipPool)
+{
+	a3ui32 i;
+	a3i32 count = 0;
+	if (clipPool && clipPool->clip)
+	{
+		for (i = 0; i < clipPool->count; ++i)
+			if (a3clipCalculateRate(clipPool->clip + i) > 0)
+				++count;
+		return count;
+	}
 	return -1;
 }
 
 // get clip index from pool
 a3i32 a3clipGetIndexInPool(const a3_ClipPool* clipPool, const a3byte clipName[a3keyframeAnimation_nameLenMax])
 {
+	if (clipPool && clipPool->clip)
+		return a3clipPoolInternalGetIndexHashed(clipPool, a3hierarchyHashName(A3_CLIP_SEARCHNAME), A3_CLIP_SEARCHNAME);
+	return -1;
+}
+
+// hash clip name
+a3ui32 a3clipHashName(const a3byte clipName[a3keyframeAnimation_nameLenMax])
+{
+	return a3hierarchyHashName(A3_CLIP_SEARCHNAME);
+}
+
+// get clip index by hash
+a3i32 a3clipGetIndexInPoolByHash(const a3_ClipPool* clipPool, const a3ui32 nameHash, const a3byte clipName_opt[a3keyframeAnimation_nameLenMax])
+{
+	if (clipPool && clipPool->clip)
+		return a3clipPoolInternalGetIndexHashed(clipPool, nameHash, clipName_opt);
+	return -1;
+}
+
+// make handle
+a3i32 a3clipPoolGetHandle(a3_ClipHandle* handle_out, const a3_ClipPool* clipPool, const a3byte clipName[a3keyframeAnimation_nameLenMax])
+{
+	if (handle_out && clipPool && clipPool->clip)
+	{
+		strncpy(handle_out->name, A3_CLIP_SEARCHNAME, a3keyframeAnimation_nameLenMax);
+		handle_out->name[a3keyframeAnimation_nameLenMax - 1] = 0;
+		handle_out->nameHash = a3hierarchyHashName(handle_out->name);
+		handle_out->index = a3clipPoolInternalGetIndexHashed(clipPool, handle_out->nameHash, handle_out->name);
+		return handle_out->index;
+	}
+	return -1;
+}
+
+// resolve handle
+a3i32 a3clipPoolResolveHandle(const a3_ClipPool* clipPool, a3_ClipHandle* handle)
+{
+	if (clipPool && clipPool->clip && handle)
+	{
+		// still where it was; the name compare only runs when hashes match 
+		//	and rules out a different name with the same hash
+		if (handle->index >= 0 && (a3ui32)handle->index < clipPool->count && 
+			clipPool->nameHash[handle->index] == handle->nameHash && *clipPool->clip[handle->index].name && 
+			!strncmp(clipPool->clip[handle->index].name, handle->name, a3keyframeAnimation_nameLenMax))
+			return handle->index;
+		handle->index = a3clipPoolInternalGetIndexHashed(clipPool, handle->nameHash, handle->name);
+		return handle->index;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+// clip set file limits
+enum
+{
+	a3clipset_lineMax = 256,
+	a3clipset_tokenMax = 8,
+};
+
+// split data line after '@' into whitespace-separated tokens, stopping at 
+//	a comment; returns token count
+static inline a3ui32 a3clipPoolInternalTokenize(a3byte* token_out[a3clipset_tokenMax], a3byte* str)
+{
+	a3ui32 count = 0;
+	while (count < a3clipset_tokenMax)
+	{
+		while (*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n')
+			*(str++) = 0;
+		if (!*str || *str == '#')
+			break;
+		token_out[count++] = str;
+		while (*str && *str != ' ' && *str != '\t' && *str != '\r' && *str != '\n')
+			++str;
+		if (*str)
+			*(str++) = 0;
+	}
+	return count;
+}
+
+// parse transition command: > < >> << with optional trailing |, or lone |
+//	returns flags, zero if invalid
+static inline a3ui32 a3clipPoolInternalParseCommand(const a3byte* str)
+{
+	a3ui32 flags = 0;
+	if (*str == '>' || *str == '<')
+	{
+		flags = (*str == '>') ? a3clipTransition_forward : a3clipTransition_reverse;
+		if (str[1] == str[0])
+		{
+			flags |= a3clipTransition_skip;
+			++str;
+		}
+		++str;
+	}
+	if (*str == '|')
+	{
+		flags |= a3clipTransition_pause;
+		++str;
+	}
+	return *str ? 0 : flags;
+}
+
+// read transition (command and optional target name) starting at token
+//	returns next token index, flags and target clip index through pointers
+static inline a3ui32 a3clipPoolInternalParseTransition(a3ui32* flags_out, a3i32* target_out, a3byte* const token[a3clipset_tokenMax], const a3ui32 tokenCount, a3ui32 tokenIndex, const a3_ClipPool* clipPool, const a3ui32 clipIndex)
+{
+	*flags_out = 0;
+	*target_out = clipIndex;
+	if (tokenIndex < tokenCount)
+	{
+		*flags_out = a3clipPoolInternalParseCommand(token[tokenIndex++]);
+		if (tokenIndex < tokenCount && !strchr("<>|", *token[tokenIndex]))
+			*target_out = a3clipGetIndexInPool(clipPool, token[tokenIndex++]);
+	}
+	return tokenIndex;
+}
+
+
+
+// load clip set file
+a3i32 a3clipPoolLoad(a3_ClipPool* clipPool_out, a3_KeyframePool* keyframePool_out, const a3byte* resourceFilePath)
+{
+	if (clipPool_out && !clipPool_out->clip && keyframePool_out && !keyframePool_out->keyframe && resourceFilePath && *resourceFilePath)
+	{
+		FILE* fp = fopen(resourceFilePath, "r");
+		a3byte line[a3clipset_lineMax], *str, *token[a3clipset_tokenMax];
+		const a3byte* command[2];
+		a3ui32 clipCount = 0, keyframeCount = 0, tokenCount, pass, i, j, k, n, flags[2];
+		a3i32 first, final, target[2];
+		a3real duration;
+		a3_Clip* clip;
+
+		if (!fp)
+		{
+			printf("\n A3 Warning: Could not open clip set file \'%s\'.", resourceFilePath);
+			return -1;
+		}
+
+		// pass 0 counts clips and keyframes, pass 1 fills the pools, pass 2 
+		//	compiles transitions, which need every clip's name and timing
+		for (pass = 0; pass < 3; ++pass)
+		{
+			rewind(fp);
+			for (i = k = 0; fgets(line, sizeof(line), fp); )
+			{
+				for (str = line; *str == ' ' || *str == '\t'; ++str);
+				if (*str != '@')
+					continue;
+				tokenCount = a3clipPoolInternalTokenize(token, str + 1);
+				if (tokenCount < 4)
+					continue;
+				first = atoi(token[2]);
+				final = atoi(token[3]);
+				if (first < 0 || final < 0)
+				{
+					if (!pass)
+						printf("\n A3 Warning: Skipping clip \'%s\' with invalid frames.", token[0]);
+					continue;
+				}
+				n = (first <= final ? final - first : first - final) + 1;
+				clip = clipPool_out->clip + i;
+
+				switch (pass)
+				{
+				case 0:
+					++clipCount;
+					keyframeCount += n;
+					break;
+				case 1:
+					// one run of keyframes per clip, in playback order
+					for (j = 0; j < n; ++j)
+						keyframePool_out->keyframe[k + j].data = (a3ui32)(first <= final ? first + (a3i32)j : first - (a3i32)j);
+					a3clipInit(clipPool_out, i, token[0], keyframePool_out, k, k + n - 1);
+
+					// durations spread evenly; zero keeps the default per keyframe
+					duration = (a3real)atof(token[1]);
+					if (duration > a3real_zero)
+						a3clipDistributeDuration(clip, duration);
+					break;
+				case 2:
+					// reverse then forward
+					command[0] = tokenCount > 4 ? token[4] : "";
+					j = a3clipPoolInternalParseTransition(flags + 0, target + 0, token, tokenCount, 4, clipPool_out, i);
+					command[1] = j < tokenCount ? token[j] : "";
+					a3clipPoolInternalParseTransition(flags + 1, target + 1, token, tokenCount, j, clipPool_out, i);
+					for (j = 0; j < 2; ++j)
+					{
+						// a lone pause stays at the terminus that was reached, 
+						//	ready to play back the way it came
+						if (flags[j] == a3clipTransition_pause)
+							flags[j] |= j ? a3clipTransition_reverse : a3clipTransition_forward;
+						if (!flags[j] || target[j] < 0)
+							printf("\n A3 Warning: Invalid transition \'%s\' in clip \'%s\'; looping.", command[j], clip->name);
+						else
+							a3clipTransitionInit(j ? &clip->transitionForward : &clip->transitionReverse, clipPool_out->clip + target[j], flags[j]);
+					}
+					break;
+				}
+				++i;
+				k += n;
+			}
+
+			// allocate once counted
+			if (!pass && (!clipCount || 
+				a3keyframePoolCreate(keyframePool_out, keyframeCount) < 0 ||
+				a3clipPoolCreate(clipPool_out, clipCount) < 0))
+			{
+				a3keyframePoolRelease(keyframePool_out);
+				fclose(fp);
+				return -1;
+			}
+		}
+
+		// each distributed duration staled the rates of the clips before it
+		a3clipPoolCalculateRate(clipPool_out);
+
+		// done
+		fclose(fp);
+		return clipCount;
+	}
 	return -1;
 }
 
@@ -24,14 +24,228 @@
 
 #include "../a3_KeyframeAnimationController.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_CLIPCONTROLLER_SSE
+#include <xmmintrin.h>
+#endif	// SSE
+
+
+// macros to help with names
+#define A3_CLIPCTRL_DEFAULTNAME		("unnamed clip ctrl")
+#define A3_CLIPCTRL_SEARCHNAME		((ctrlName && *ctrlName) ? ctrlName : A3_CLIPCTRL_DEFAULTNAME)
+
+// batch alignment
+#define A3_CLIPCONTROLLER_ALIGN		16
+#define a3clipControllerInternalAlign(sz)	(((sz) + (A3_CLIPCONTROLLER_ALIGN - 1)) & ~(A3_CLIPCONTROLLER_ALIGN - 1))
+#define a3clipControllerInternalAlignPtr(p)	((a3ubyte *)(((size_t)(p) + (A3_CLIPCONTROLLER_ALIGN - 1)) & ~(size_t)(A3_CLIPCONTROLLER_ALIGN - 1)))
+
 
 //-----------------------------------------------------------------------------
 
 // initialize clip controller
 a3i32 a3clipControllerInit(a3_ClipController* clipCtrl_out, const a3byte ctrlName[a3keyframeAnimation_nameLenMax], const a3_ClipPool* clipPool, const a3ui32 clipIndex_pool)
 {
+	if (clipCtrl_out && clipPool && clipPool->clip && clipIndex_pool < clipPool->count)
+	{
+		strncpy(clipCtrl_out->name, A3_CLIPCTRL_SEARCHNAME, a3keyframeAnimation_nameLenMax);
+		clipCtrl_out->name[a3keyframeAnimation_nameLenMax - 1] = 0;
+		clipCtrl_out->playback = a3real_one;
+		return a3clipControllerSetClip(clipCtrl_out, clipPool, clipIndex_pool);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+// refresh cached durations and parameters of one batch controller
+static inline void a3clipControllerInternalBatchRefresh(a3_ClipControllerBatch* batch, const a3ui32 i)
+{
+	const a3_Clip* clip = batch->clipPool->clip + batch->clip[i];
+	const a3_Keyframe* keyframe = clip->keyframePool->keyframe + batch->keyframe[i];
+	batch->clipDurationInv[i] = clip->durationInv;
+	batch->keyframeDuration[i] = keyframe->duration;
+	batch->keyframeDurationInv[i] = keyframe->durationInv;
+	batch->keyframeParam[i] = batch->keyframeTime[i] * keyframe->durationInv;
+	batch->clipParam[i] = batch->clipTime[i] * clip->durationInv;
+}
+
+// put one batch controller (padding included) at the start of a valid 
+//	clip, or at its end if reversed
+static inline void a3clipControllerInternalBatchSetClip(a3_ClipControllerBatch* batch, const a3ui32 i, const a3ui32 clipIndex_pool)
+{
+	const a3_Clip* clip = batch->clipPool->clip + clipIndex_pool;
+	batch->clip[i] = clipIndex_pool;
+	if (batch->playback[i] < a3real_zero)
+	{
+		batch->keyframe[i] = clip->keyframeIndex_final;
+		batch->keyframeTime[i] = clip->keyframePool->keyframe[clip->keyframeIndex_final].duration;
+		batch->clipTime[i] = clip->duration;
+	}
+	else
+	{
+		batch->keyframe[i] = clip->keyframeIndex_first;
+		batch->keyframeTime[i] = batch->clipTime[i] = a3real_zero;
+	}
+	a3clipControllerInternalBatchRefresh(batch, i);
+}
+
+
+a3i32 a3clipControllerBatchCreate(a3_ClipControllerBatch* batch_out, const a3_ClipPool* clipPool, const a3ui32 count, const a3ui32 clipIndex_pool)
+{
+	if (batch_out && !batch_out->data && clipPool && clipPool->clip && clipIndex_pool < clipPool->count && 
+		clipPool->clip[clipIndex_pool].keyframePool && count)
+	{
+		const a3ui32 capacity = (count + 3) & ~3u;
+		const size_t streamSize = a3clipControllerInternalAlign(sizeof(a3real) * capacity);
+		const size_t dataSize = streamSize * 14;
+		a3ubyte *data;
+		a3ui32 i;
+
+		// one block of equally sized streams; all are 4-byte elements
+		batch_out->data = malloc(dataSize + A3_CLIPCONTROLLER_ALIGN);
+		if (batch_out->data)
+		{
+			data = a3clipControllerInternalAlignPtr(batch_out->data);
+			memset(data, 0, dataSize);
+			batch_out->clipTime = (a3real *)data;
+			batch_out->clipParam = (a3real *)(data += streamSize);
+			batch_out->keyframeTime = (a3real *)(data += streamSize);
+			batch_out->keyframeParam = (a3real *)(data += streamSize);
+			batch_out->playback = (a3real *)(data += streamSize);
+			batch_out->clip = (a3ui32 *)(data += streamSize);
+			batch_out->keyframe = (a3ui32 *)(data += streamSize);
+			batch_out->clipDurationInv = (a3real *)(data += streamSize);
+			batch_out->keyframeDuration = (a3real *)(data += streamSize);
+			batch_out->keyframeDurationInv = (a3real *)(data += streamSize);
+			batch_out->pending = (a3ui32 *)(data += streamSize);
+			batch_out->terminus = (a3ui32 *)(data += streamSize);
+			batch_out->terminusPlayback = (a3real *)(data += streamSize);
+			batch_out->clipPool = clipPool;
+			batch_out->count = count;
+			batch_out->capacity = capacity;
+			batch_out->pendingCount = batch_out->terminusCount = 0;
+
+			// padding stays paused on the same clip so it never leaves its keyframe
+			for (i = 0; i < capacity; ++i)
+				a3clipControllerInternalBatchSetClip(batch_out, i, clipIndex_pool);
+
+			// done
+			return count;
+		}
+	}
+	return -1;
+}
+
+a3i32 a3clipControllerBatchRelease(a3_ClipControllerBatch* batch)
+{
+	if (batch && batch->data)
+	{
+		free(batch->data);
+		memset(batch, 0, sizeof(a3_ClipControllerBatch));
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3clipControllerBatchSetClip(a3_ClipControllerBatch* batch, const a3ui32 ctrlIndex, const a3ui32 clipIndex_pool)
+{
+	if (batch && batch->data && ctrlIndex < batch->count && clipIndex_pool < batch->clipPool->count && batch->clipPool->clip[clipIndex_pool].keyframePool)
+	{
+		a3clipControllerInternalBatchSetClip(batch, ctrlIndex, clipIndex_pool);
+		return clipIndex_pool;
+	}
+	return -1;
+}
+
+a3i32 a3clipControllerBatchSetPlayback(a3_ClipControllerBatch* batch, const a3ui32 ctrlIndex, const a3real playback)
+{
+	if (batch && batch->data && ctrlIndex < batch->count)
+	{
+		batch->playback[ctrlIndex] = playback;
+		return ctrlIndex;
+	}
+	return -1;
+}
+
+a3i32 a3clipControllerBatchAdvance(a3_ClipControllerBatch* batch, const a3real dt)
+{
+	if (batch && batch->data)
+	{
+		a3ui32 i, pendingCount = 0;
+#ifdef A3_CLIPCONTROLLER_SSE
+		const __m128 zero = _mm_setzero_ps(), step = _mm_set1_ps(dt);
+		__m128 playback, keyframeTime, keyframeDuration;
+		a3i32 mask;
+
+		for (i = 0; i < batch->capacity; i += 4)
+		{
+			playback = _mm_mul_ps(_mm_load_ps(batch->playback + i), step);
+			keyframeTime = _mm_add_ps(_mm_load_ps(batch->keyframeTime + i), playback);
+			keyframeDuration = _mm_load_ps(batch->keyframeDuration + i);
+			_mm_store_ps(batch->keyframeTime + i, keyframeTime);
+			_mm_store_ps(batch->keyframeParam + i, _mm_mul_ps(keyframeTime, _mm_load_ps(batch->keyframeDurationInv + i)));
+			playback = _mm_add_ps(_mm_load_ps(batch->clipTime + i), playback);
+			_mm_store_ps(batch->clipTime + i, playback);
+			_mm_store_ps(batch->clipParam + i, _mm_mul_ps(playback, _mm_load_ps(batch->clipDurationInv + i)));
+
+			// left the keyframe on either side
+			mask = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(keyframeTime, zero), _mm_cmpgt_ps(keyframeTime, keyframeDuration)));
+			if (mask)
+			{
+				if (mask & 1) batch->pending[pendingCount++] = i + 0;
+				if (mask & 2) batch->pending[pendingCount++] = i + 1;
+				if (mask & 4) batch->pending[pendingCount++] = i + 2;
+				if (mask & 8) batch->pending[pendingCount++] = i + 3;
+			}
+		}
+#else	// !A3_CLIPCONTROLLER_SSE
+		a3real playback;
+
+		for (i = 0; i < batch->capacity; ++i)
+		{
+			playback = batch->playback[i] * dt;
+			batch->keyframeTime[i] += playback;
+			batch->keyframeParam[i] = batch->keyframeTime[i] * batch->keyframeDurationInv[i];
+			batch->clipTime[i] += playback;
+			batch->clipParam[i] = batch->clipTime[i] * batch->clipDurationInv[i];
+
+			// branch-free append: always write, only count if it left
+			batch->pending[pendingCount] = i;
+			pendingCount += (batch->keyframeTime[i] < a3real_zero) | (batch->keyframeTime[i] > batch->keyframeDuration[i]);
+		}
+#endif	// A3_CLIPCONTROLLER_SSE
+
+		batch->pendingCount = pendingCount;
+		return pendingCount;
+	}
+	return -1;
+}
+
+a3i32 a3clipControllerBatchResolve(a3_ClipControllerBatch* batch)
+{
+	if (batch && batch->data)
+	{
+		a3ui32 i, n;
+		a3real playback;
+
+		for (n = 0, batch->terminusCount = 0; n < batch->pendingCount; ++n)
+		{
+			i = batch->pending[n];
+			playback = batch->playback[i];
+			if (a3clipControllerInternalResolve(batch->clipPool, batch->clip + i, batch->keyframe + i, batch->keyframeTime + i, batch->clipTime + i, batch->playback + i))
+			{
+				batch->terminus[batch->terminusCount] = i;
+				batch->terminusPlayback[batch->terminusCount++] = playback;
+			}
+			a3clipControllerInternalBatchRefresh(batch, i);
+		}
+		batch->pendingCount = 0;
+		return batch->terminusCount;
+	}
 	return -1;
 }
 
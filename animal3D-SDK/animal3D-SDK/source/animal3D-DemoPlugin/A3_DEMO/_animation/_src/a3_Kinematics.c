@@ -24,6 +24,146 @@
 
 #include "../a3_Kinematics.h"
 
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_KINEMATICS_SSE
+#include <xmmintrin.h>
+#endif	// SSE
+
+
+//-----------------------------------------------------------------------------
+// internal matrix products; all hierarchy state transforms are 16-byte 
+//	aligned, so whole columns are loaded at once
+
+// scalar full product, column by column; the path taken without SSE and 
+//	the reference the vector path is checked and timed against
+static inline void a3kinematicsInternalProductScalar(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	a3ui32 j, k;
+	for (j = 0; j < 4; ++j)
+		for (k = 0; k < 4; ++k)
+			m_out->m[j][k] = mL->m[0][k] * mR->m[j][0] + mL->m[1][k] * mR->m[j][1]
+				+ mL->m[2][k] * mR->m[j][2] + mL->m[3][k] * mR->m[j][3];
+}
+
+// scalar affine product, same terms as the vector version
+static inline void a3kinematicsInternalProductAffineScalar(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	a3ui32 j, k;
+	for (j = 0; j < 3; ++j)
+		for (k = 0; k < 4; ++k)
+			m_out->m[j][k] = mL->m[0][k] * mR->m[j][0] + mL->m[1][k] * mR->m[j][1]
+				+ mL->m[2][k] * mR->m[j][2];
+	for (k = 0; k < 4; ++k)
+		m_out->m[3][k] = mL->m[0][k] * mR->m[3][0] + mL->m[1][k] * mR->m[3][1]
+			+ mL->m[2][k] * mR->m[3][2] + mL->m[3][k];
+}
+
+#ifdef A3_KINEMATICS_SSE
+
+// full product: each output column is a combination of all four parent 
+//	columns weighted by the local column
+static inline void a3kinematicsInternalProduct(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	const __m128 c0 = _mm_load_ps(mL->v[0].v), c1 = _mm_load_ps(mL->v[1].v), c2 = _mm_load_ps(mL->v[2].v), c3 = _mm_load_ps(mL->v[3].v);
+	const a3real *r = mR->mm;
+	a3real *o = m_out->mm;
+	a3ui32 j;
+	for (j = 0; j < 4; ++j, r += 4, o += 4)
+		_mm_store_ps(o, _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(r[0])), _mm_mul_ps(c1, _mm_set1_ps(r[1]))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(r[2])), _mm_mul_ps(c3, _mm_set1_ps(r[3])))));
+}
+
+// affine product: the local bottom row is (0, 0, 0, 1), so basis columns 
+//	only combine the parent basis and translation adds the parent origin; 
+//	the parent bottom row carries through untouched
+static inline void a3kinematicsInternalProductAffine(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	const __m128 c0 = _mm_load_ps(mL->v[0].v), c1 = _mm_load_ps(mL->v[1].v), c2 = _mm_load_ps(mL->v[2].v), c3 = _mm_load_ps(mL->v[3].v);
+	const a3real *r = mR->mm;
+	a3real *o = m_out->mm;
+	a3ui32 j;
+	for (j = 0; j < 3; ++j, r += 4, o += 4)
+		_mm_store_ps(o, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(c0, _mm_set1_ps(r[0])), _mm_mul_ps(c1, _mm_set1_ps(r[1]))),
+			_mm_mul_ps(c2, _mm_set1_ps(r[2]))));
+	_mm_store_ps(o, _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(c0, _mm_set1_ps(r[0])), _mm_mul_ps(c1, _mm_set1_ps(r[1]))),
+		_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(r[2])), c3)));
+}
+
+#else	// !A3_KINEMATICS_SSE
+
+static inline void a3kinematicsInternalProduct(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	a3kinematicsInternalProductScalar(m_out, mL, mR);
+}
+
+static inline void a3kinematicsInternalProductAffine(a3mat4 *m_out, const a3mat4 *mL, const a3mat4 *mR)
+{
+	a3kinematicsInternalProductAffineScalar(m_out, mL, mR);
+}
+
+#endif	// A3_KINEMATICS_SSE
+
+
+// solve nodes in range that are marked dirty or whose parent was solved: 
+//	in this pass (parents always precede children, so a parent's mark is 
+//	final before any child reads it), or, for parents before the range, 
+//	since the last skinning update; marks in the range then move to the 
+//	object dirty bits
+static inline a3ui32 a3kinematicsInternalSolveMarked(const a3_HierarchyState *hierarchyState, const a3ui32 firstIndex, const a3ui32 lastIndex, const a3boolean affine)
+{
+	const a3i32 *parentIndex = hierarchyState->poseGroup->hierarchy->parentIndex;
+	const a3mat4 *localSpace = hierarchyState->localSpace->transform;
+	a3mat4 *objectSpace = hierarchyState->objectSpace->transform;
+	a3ui32 *localDirty = hierarchyState->localDirty, *objectDirty = hierarchyState->objectDirty;
+	const a3ui32 firstWord = firstIndex >> 5, lastWord = (lastIndex + 31) >> 5;
+	a3ui32 i, bits, count;
+	a3i32 p;
+
+	// idle: nothing marked and no parents before the range
+	if (!firstIndex)
+	{
+		for (i = bits = 0; i < lastWord; ++i)
+			bits |= localDirty[i];
+		if (!bits)
+			return 0;
+	}
+
+	for (i = firstIndex, count = 0; i < lastIndex; ++i)
+	{
+		p = parentIndex[i];
+		if (!(localDirty[i >> 5] & (1u << (i & 31))))
+		{
+			if (p < 0 || !((p >= (a3i32)firstIndex ? localDirty : objectDirty)[p >> 5] & (1u << (p & 31))))
+				continue;
+			localDirty[i >> 5] |= 1u << (i & 31);
+		}
+		if (p < 0)
+			objectSpace[i] = localSpace[i];
+		else if (affine)
+			a3kinematicsInternalProductAffine(objectSpace + i, objectSpace + p, localSpace + i);
+		else
+			a3kinematicsInternalProduct(objectSpace + i, objectSpace + p, localSpace + i);
+		++count;
+	}
+
+	// hand marks in the range over to skinning
+	for (i = firstWord; i < lastWord; ++i)
+	{
+		bits = ~0u;
+		if (i == firstWord)
+			bits &= ~0u << (firstIndex & 31);
+		if (i + 1 == lastWord && (lastIndex & 31))
+			bits &= (1u << (lastIndex & 31)) - 1;
+		objectDirty[i] |= localDirty[i] & bits;
+		localDirty[i] &= ~bits;
+	}
+	hierarchyState->counter->objectSpace += count;
+	return count;
+}
+
 
 //-----------------------------------------------------------------------------
 
@@ -33,12 +173,101 @@ a3i32 a3kinematicsSolveForwardPartial(const a3_HierarchyState *hierarchyState, c
 	if (hierarchyState && hierarchyState->poseGroup && 
 		firstIndex < hierarchyState->poseGroup->hierarchy->numNodes && nodeCount)
 	{
-		// ****TO-DO: implement forward kinematics algorithm
-		//	- for all nodes starting at first index
-		//		- if node is not root (has parent node)
-		//			- object matrix = parent object matrix * local matrix
-		//		- else
-		//			- copy local matrix to object matrix
+		const a3ui32 numNodes = hierarchyState->poseGroup->hierarchy->numNodes;
+		const a3ui32 lastIndex = a3minimum(firstIndex + nodeCount, numNodes);
+		return a3kinematicsInternalSolveMarked(hierarchyState, firstIndex, lastIndex, a3false);
+	}
+	return -1;
+}
+
+// partial FK solver, affine transforms only
+a3i32 a3kinematicsSolveForwardPartialAffine(const a3_HierarchyState *hierarchyState, const a3ui32 firstIndex, const a3ui32 nodeCount)
+{
+	if (hierarchyState && hierarchyState->poseGroup &&
+		firstIndex < hierarchyState->poseGroup->hierarchy->numNodes && nodeCount)
+	{
+		const a3ui32 numNodes = hierarchyState->poseGroup->hierarchy->numNodes;
+		const a3ui32 lastIndex = a3minimum(firstIndex + nodeCount, numNodes);
+		return a3kinematicsInternalSolveMarked(hierarchyState, firstIndex, lastIndex, a3true);
+	}
+	return -1;
+}
+
+// scalar reference FK solver
+a3i32 a3kinematicsSolveForwardScalar(const a3_HierarchyState *hierarchyState, const a3boolean affine)
+{
+	if (hierarchyState && hierarchyState->poseGroup)
+	{
+		const a3ui32 numNodes = hierarchyState->poseGroup->hierarchy->numNodes;
+		const a3i32 *parentIndex = hierarchyState->poseGroup->hierarchy->parentIndex;
+		const a3mat4 *localSpace = hierarchyState->localSpace->transform;
+		a3mat4 *objectSpace = hierarchyState->objectSpace->transform;
+		a3ui32 i;
+		a3i32 p;
+		for (i = 0; i < numNodes; ++i)
+		{
+			p = parentIndex[i];
+			if (p < 0)
+				objectSpace[i] = localSpace[i];
+			else if (affine)
+				a3kinematicsInternalProductAffineScalar(objectSpace + i, objectSpace + p, localSpace + i);
+			else
+				a3kinematicsInternalProductScalar(objectSpace + i, objectSpace + p, localSpace + i);
+		}
+		return numNodes;
+	}
+	return -1;
+}
+
+// FK solver for a slice of one level
+a3i32 a3kinematicsSolveForwardLevel(const a3_HierarchyState *hierarchyState, const a3ui32 levelIndex, const a3ui32 firstInLevel, const a3ui32 nodeCount)
+{
+	if (hierarchyState && hierarchyState->poseGroup && hierarchyState->poseGroup->hierarchy->levelNodeIndex && 
+		levelIndex < hierarchyState->poseGroup->hierarchy->numLevels && nodeCount)
+	{
+		const a3_Hierarchy *hierarchy = hierarchyState->poseGroup->hierarchy;
+		const a3i32 *parentIndex = hierarchy->parentIndex;
+		const a3mat4 *localSpace = hierarchyState->localSpace->transform;
+		a3mat4 *objectSpace = hierarchyState->objectSpace->transform;
+		const a3ui32 *levelNode = hierarchy->levelNodeIndex + hierarchy->levelOffset[levelIndex];
+		const a3ui32 levelSize = hierarchy->levelOffset[levelIndex + 1] - hierarchy->levelOffset[levelIndex];
+		const a3ui32 lastInLevel = a3minimum(firstInLevel + nodeCount, levelSize);
+		a3ui32 i, j;
+
+		// roots are exactly level zero
+		if (levelIndex > 0)
+			for (i = firstInLevel; i < lastInLevel; ++i)
+			{
+				j = levelNode[i];
+				a3kinematicsInternalProduct(objectSpace + j, objectSpace + parentIndex[j], localSpace + j);
+			}
+		else
+			for (i = firstInLevel; i < lastInLevel; ++i)
+			{
+				j = levelNode[i];
+				objectSpace[j] = localSpace[j];
+			}
+		return (lastInLevel > firstInLevel ? lastInLevel - firstInLevel : 0);
+	}
+	return -1;
+}
+
+// mark everything solved after level slices
+a3i32 a3kinematicsSolveForwardLevelsDone(const a3_HierarchyState *hierarchyState)
+{
+	if (hierarchyState && hierarchyState->poseGroup)
+	{
+		const a3ui32 numNodes = hierarchyState->poseGroup->hierarchy->numNodes;
+		a3ui32 i;
+		for (i = 0; i < hierarchyState->dirtyWordCount; ++i)
+		{
+			hierarchyState->objectDirty[i] = ~0u;
+			hierarchyState->localDirty[i] = 0;
+		}
+		if (numNodes & 31)
+			hierarchyState->objectDirty[numNodes >> 5] = (1u << (numNodes & 31)) - 1;
+		hierarchyState->counter->objectSpace += numNodes;
+		return numNodes;
 	}
 	return -1;
 }
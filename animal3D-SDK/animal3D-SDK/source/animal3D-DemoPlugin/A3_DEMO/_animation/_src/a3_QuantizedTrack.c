@@ -0,0 +1,457 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_QuantizedTrack.c
+	Implementation of quantized tracks.
+*/
+
+#include "../a3_QuantizedTrack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_QUANTIZEDTRACK_SSE
+#include <emmintrin.h>
+#endif	// SSE
+
+
+//-----------------------------------------------------------------------------
+
+// block alignment
+#define A3_QUANTIZEDTRACK_ALIGN		16
+#define a3quantizedTrackInternalAlign(sz)	(((sz) + (A3_QUANTIZEDTRACK_ALIGN - 1)) & ~(A3_QUANTIZEDTRACK_ALIGN - 1))
+
+// smallest three components lie in [-1/sqrt(2), +1/sqrt(2)], stored in 15 bits
+#define A3_QUANTIZEDTRACK_ROTATE_BIAS		(-0.70710678118654752440f)
+#define A3_QUANTIZEDTRACK_ROTATE_MAX		32767
+#define A3_QUANTIZEDTRACK_ROTATE_STEP		(1.41421356237309504880f / (a3real)A3_QUANTIZEDTRACK_ROTATE_MAX)
+
+// channels are stored in 16 bits over their range
+#define A3_QUANTIZEDTRACK_RANGE_MAX		65535
+
+// channels changing less than this over a clip are stored as constants
+#define A3_QUANTIZEDTRACK_STATIC		((a3real)0.00001f)
+
+
+//-----------------------------------------------------------------------------
+// encoding
+
+static inline void a3quantizedTrackInternalEncodeRotate(a3ui16 *code_out, const a3quat *q)
+{
+	a3ui64 bits;
+	a3ui32 i, idx, value;
+	a3real c;
+
+	// drop the largest component; q and -q are the same rotation, so 
+	//	flip if needed to make the dropped one positive
+	for (i = 1, idx = 0; i < 4; ++i)
+		if (a3absolute(q->q[i]) > a3absolute(q->q[idx]))
+			idx = i;
+	for (i = 0, bits = idx; i < 4; ++i)
+		if (i != idx)
+		{
+			c = q->q[idx] < a3real_zero ? -q->q[i] : q->q[i];
+			c = (c - A3_QUANTIZEDTRACK_ROTATE_BIAS) / A3_QUANTIZEDTRACK_ROTATE_STEP + a3real_half;
+			value = (a3ui32)a3clamp(a3real_zero, (a3real)A3_QUANTIZEDTRACK_ROTATE_MAX, c);
+			bits = (bits << 15) | value;
+		}
+	code_out[0] = (a3ui16)(bits >> 32);
+	code_out[1] = (a3ui16)(bits >> 16);
+	code_out[2] = (a3ui16)(bits);
+}
+
+static inline void a3quantizedTrackInternalEncodeRange(a3ui16 *code_out, const a3vec3 *v, const a3vec3 *vMin, const a3vec3 *vStep)
+{
+	a3ui32 i;
+	a3real c;
+	for (i = 0; i < 3; ++i)
+	{
+		c = vStep->v[i] > a3real_zero ? (v->v[i] - vMin->v[i]) / vStep->v[i] + a3real_half : a3real_zero;
+		code_out[i] = (a3ui16)a3clamp(a3real_zero, (a3real)A3_QUANTIZEDTRACK_RANGE_MAX, c);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// decoding
+
+#ifdef A3_QUANTIZEDTRACK_SSE
+
+static inline __m128 a3quantizedTrackInternalDecodeRotate(const a3ui16 *code)
+{
+	const a3ui64 bits = ((a3ui64)code[0] << 32) | ((a3ui32)code[1] << 16) | code[2];
+	const __m128 mask_w = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	__m128 c, d;
+
+	// three stored components, fourth from unit length
+	c = _mm_cvtepi32_ps(_mm_set_epi32(0, (a3i32)(bits & 0x7fff), (a3i32)((bits >> 15) & 0x7fff), (a3i32)((bits >> 30) & 0x7fff)));
+	c = _mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(A3_QUANTIZEDTRACK_ROTATE_STEP)), _mm_set_ps(0.0f, A3_QUANTIZEDTRACK_ROTATE_BIAS, A3_QUANTIZEDTRACK_ROTATE_BIAS, A3_QUANTIZEDTRACK_ROTATE_BIAS));
+	d = _mm_mul_ps(c, c);
+	d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+	d = _mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1)));
+	d = _mm_sqrt_ss(_mm_max_ss(_mm_sub_ss(_mm_set_ss(1.0f), d), _mm_setzero_ps()));
+	c = _mm_or_ps(c, _mm_and_ps(mask_w, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0))));
+
+	// move the rebuilt component to its slot
+	switch (bits >> 45)
+	{
+	case 0:
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 1, 0, 3));
+	case 1:
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 1, 3, 0));
+	case 2:
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 3, 1, 0));
+	}
+	return c;
+}
+
+static inline __m128 a3quantizedTrackInternalDecodeRange(const a3ui16 *code, const a3vec3 *vMin, const a3vec3 *vStep)
+{
+	const __m128 c = _mm_cvtepi32_ps(_mm_set_epi32(0, code[2], code[1], code[0]));
+	return _mm_add_ps(_mm_mul_ps(c, _mm_setr_ps(vStep->x, vStep->y, vStep->z, 0.0f)), _mm_setr_ps(vMin->x, vMin->y, vMin->z, 0.0f));
+}
+
+static inline void a3quantizedTrackInternalStore3(a3vec3 *v_out, const __m128 v)
+{
+	_mm_storel_pi((__m64 *)v_out->v, v);
+	_mm_store_ss(v_out->v + 2, _mm_movehl_ps(v, v));
+}
+
+#else	// !A3_QUANTIZEDTRACK_SSE
+
+static inline void a3quantizedTrackInternalDecodeRotate(a3real *q_out, const a3ui16 *code)
+{
+	const a3ui64 bits = ((a3ui64)code[0] << 32) | ((a3ui32)code[1] << 16) | code[2];
+	const a3ui32 idx = (a3ui32)(bits >> 45);
+	a3real c[3], d;
+	a3ui32 i, j;
+	c[0] = (a3real)((bits >> 30) & 0x7fff) * A3_QUANTIZEDTRACK_ROTATE_STEP + A3_QUANTIZEDTRACK_ROTATE_BIAS;
+	c[1] = (a3real)((bits >> 15) & 0x7fff) * A3_QUANTIZEDTRACK_ROTATE_STEP + A3_QUANTIZEDTRACK_ROTATE_BIAS;
+	c[2] = (a3real)((bits) & 0x7fff) * A3_QUANTIZEDTRACK_ROTATE_STEP + A3_QUANTIZEDTRACK_ROTATE_BIAS;
+	d = a3real_one - c[0] * c[0] - c[1] * c[1] - c[2] * c[2];
+	d = d > a3real_zero ? a3sqrt(d) : a3real_zero;
+	for (i = j = 0; i < 4; ++i)
+		q_out[i] = i == idx ? d : c[j++];
+}
+
+static inline void a3quantizedTrackInternalDecodeRange(a3real *v_out, const a3ui16 *code, const a3vec3 *vMin, const a3vec3 *vStep)
+{
+	v_out[0] = vMin->x + vStep->x * (a3real)code[0];
+	v_out[1] = vMin->y + vStep->y * (a3real)code[1];
+	v_out[2] = vMin->z + vStep->z * (a3real)code[2];
+}
+
+#endif	// A3_QUANTIZEDTRACK_SSE
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3quantizedTrackCreate(a3_QuantizedTrack *track_out, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip)
+{
+	if (track_out && !track_out->data && poseGroup && poseGroup->hierarchy && clip && clip->keyframePool && clip->keyframeCount)
+	{
+		const a3_Keyframe *keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		const a3ui32 nodeCount = poseGroup->hierarchy->numNodes, keyCount = clip->keyframeCount;
+		const a3_HierarchyPose *pose;
+		a3vec3 *range, *translateMax, *scaleMax;
+		a3ui32 i, j, k, translateCount, scaleCount;
+		size_t size[10], dataSize;
+		a3ubyte *data;
+
+		// validate keyframe pose indices
+		for (k = 0; k < keyCount; ++k)
+			if (keyframe[k].data >= poseGroup->poseCount)
+				return -1;
+
+		// channel ranges over the clip: constants temporarily hold minimums
+		range = (a3vec3 *)malloc(sizeof(a3vec3) * nodeCount * 4);
+		if (!range)
+			return -1;
+		translateMax = range + nodeCount;
+		scaleMax = translateMax + nodeCount;
+		pose = poseGroup->hpose + keyframe[0].data;
+		for (j = 0; j < nodeCount; ++j)
+		{
+			range[j] = translateMax[j] = pose->translate[j];
+			range[j + nodeCount * 3] = scaleMax[j] = pose->scale[j];
+		}
+		for (k = 1; k < keyCount; ++k)
+		{
+			pose = poseGroup->hpose + keyframe[k].data;
+			for (j = 0; j < nodeCount; ++j)
+				for (i = 0; i < 3; ++i)
+				{
+					range[j].v[i] = a3minimum(range[j].v[i], pose->translate[j].v[i]);
+					translateMax[j].v[i] = a3maximum(translateMax[j].v[i], pose->translate[j].v[i]);
+					range[j + nodeCount * 3].v[i] = a3minimum(range[j + nodeCount * 3].v[i], pose->scale[j].v[i]);
+					scaleMax[j].v[i] = a3maximum(scaleMax[j].v[i], pose->scale[j].v[i]);
+				}
+		}
+
+		// count animated channels
+		for (j = translateCount = scaleCount = 0; j < nodeCount; ++j)
+		{
+			for (i = 0; i < 3 && translateMax[j].v[i] - range[j].v[i] <= A3_QUANTIZEDTRACK_STATIC; ++i);
+			translateCount += (i < 3);
+			for (i = 0; i < 3 && scaleMax[j].v[i] - range[j + nodeCount * 3].v[i] <= A3_QUANTIZEDTRACK_STATIC; ++i);
+			scaleCount += (i < 3);
+		}
+
+		// one block for everything
+		size[0] = a3quantizedTrackInternalAlign(sizeof(a3ui16) * 3 * nodeCount * keyCount);
+		size[1] = a3quantizedTrackInternalAlign(sizeof(a3ui16) * 3 * translateCount * keyCount);
+		size[2] = a3quantizedTrackInternalAlign(sizeof(a3ui16) * 3 * scaleCount * keyCount);
+		size[3] = a3quantizedTrackInternalAlign(sizeof(a3ui32) * translateCount);
+		size[4] = a3quantizedTrackInternalAlign(sizeof(a3ui32) * scaleCount);
+		size[5] = a3quantizedTrackInternalAlign(sizeof(a3vec3) * translateCount * 2);
+		size[6] = a3quantizedTrackInternalAlign(sizeof(a3vec3) * scaleCount * 2);
+		size[7] = a3quantizedTrackInternalAlign(sizeof(a3vec3) * nodeCount);
+		size[8] = a3quantizedTrackInternalAlign(sizeof(a3vec3) * nodeCount);
+		for (i = 0, dataSize = 0; i < 9; ++i)
+			dataSize += size[i];
+		track_out->data = malloc(dataSize);
+		if (!track_out->data)
+		{
+			free(range);
+			return -1;
+		}
+		data = (a3ubyte *)track_out->data;
+		track_out->rotate = (a3ui16 *)data;
+		track_out->translate = (a3ui16 *)(data += size[0]);
+		track_out->scale = (a3ui16 *)(data += size[1]);
+		track_out->translateNode = (a3ui32 *)(data += size[2]);
+		track_out->scaleNode = (a3ui32 *)(data += size[3]);
+		track_out->translateMin = (a3vec3 *)(data += size[4]);
+		track_out->translateStep = track_out->translateMin + translateCount;
+		track_out->scaleMin = (a3vec3 *)(data += size[5]);
+		track_out->scaleStep = track_out->scaleMin + scaleCount;
+		track_out->translateConstant = (a3vec3 *)(data += size[6]);
+		track_out->scaleConstant = (a3vec3 *)(data += size[7]);
+		track_out->nodeCount = nodeCount;
+		track_out->keyCount = keyCount;
+		track_out->translateCount = translateCount;
+		track_out->scaleCount = scaleCount;
+
+		// constants and ranges
+		for (j = translateCount = scaleCount = 0; j < nodeCount; ++j)
+		{
+			track_out->translateConstant[j] = range[j];
+			track_out->scaleConstant[j] = range[j + nodeCount * 3];
+			for (i = 0; i < 3 && translateMax[j].v[i] - range[j].v[i] <= A3_QUANTIZEDTRACK_STATIC; ++i);
+			if (i < 3)
+			{
+				track_out->translateNode[translateCount] = j;
+				track_out->translateMin[translateCount] = range[j];
+				for (i = 0; i < 3; ++i)
+					track_out->translateStep[translateCount].v[i] = (translateMax[j].v[i] - range[j].v[i]) / (a3real)A3_QUANTIZEDTRACK_RANGE_MAX;
+				++translateCount;
+			}
+			for (i = 0; i < 3 && scaleMax[j].v[i] - range[j + nodeCount * 3].v[i] <= A3_QUANTIZEDTRACK_STATIC; ++i);
+			if (i < 3)
+			{
+				track_out->scaleNode[scaleCount] = j;
+				track_out->scaleMin[scaleCount] = range[j + nodeCount * 3];
+				for (i = 0; i < 3; ++i)
+					track_out->scaleStep[scaleCount].v[i] = (scaleMax[j].v[i] - range[j + nodeCount * 3].v[i]) / (a3real)A3_QUANTIZEDTRACK_RANGE_MAX;
+				++scaleCount;
+			}
+		}
+		free(range);
+
+		// encode keys
+		for (k = 0; k < keyCount; ++k)
+		{
+			pose = poseGroup->hpose + keyframe[k].data;
+			for (j = 0; j < nodeCount; ++j)
+				a3quantizedTrackInternalEncodeRotate(track_out->rotate + (k * nodeCount + j) * 3, pose->rotate + j);
+			for (j = 0; j < translateCount; ++j)
+				a3quantizedTrackInternalEncodeRange(track_out->translate + (k * translateCount + j) * 3,
+					pose->translate + track_out->translateNode[j], track_out->translateMin + j, track_out->translateStep + j);
+			for (j = 0; j < scaleCount; ++j)
+				a3quantizedTrackInternalEncodeRange(track_out->scale + (k * scaleCount + j) * 3,
+					pose->scale + track_out->scaleNode[j], track_out->scaleMin + j, track_out->scaleStep + j);
+		}
+
+		// done
+		return keyCount;
+	}
+	return -1;
+}
+
+a3i32 a3quantizedTrackRelease(a3_QuantizedTrack *track)
+{
+	if (track && track->data)
+	{
+		free(track->data);
+		memset(track, 0, sizeof(a3_QuantizedTrack));
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3quantizedTrackSample(const a3_HierarchyPose *pose_out, const a3_QuantizedTrack *track, const a3ui32 keyIndex0, const a3ui32 keyIndex1, const a3real param)
+{
+	if (pose_out && pose_out->rotate && track && track->data && keyIndex0 < track->keyCount && keyIndex1 < track->keyCount)
+	{
+		const a3ui32 nodeCount = track->nodeCount;
+		const a3ui16 *r0 = track->rotate + keyIndex0 * nodeCount * 3, *r1 = track->rotate + keyIndex1 * nodeCount * 3;
+		const a3ui16 *t0 = track->translate + keyIndex0 * track->translateCount * 3, *t1 = track->translate + keyIndex1 * track->translateCount * 3;
+		const a3ui16 *s0 = track->scale + keyIndex0 * track->scaleCount * 3, *s1 = track->scale + keyIndex1 * track->scaleCount * 3;
+		a3ui32 j;
+#ifdef A3_QUANTIZEDTRACK_SSE
+		const __m128 u = _mm_set1_ps(param);
+		__m128 q0, q1, d;
+#else	// !A3_QUANTIZEDTRACK_SSE
+		a3real q0[4], q1[4], v0[3], v1[3], d;
+		a3ui32 i;
+#endif	// A3_QUANTIZEDTRACK_SSE
+
+		// static channels first, animated ones overwrite
+		memcpy(pose_out->translate, track->translateConstant, sizeof(a3vec3) * nodeCount);
+		memcpy(pose_out->scale, track->scaleConstant, sizeof(a3vec3) * nodeCount);
+
+#ifdef A3_QUANTIZEDTRACK_SSE
+		for (j = 0; j < nodeCount; ++j, r0 += 3, r1 += 3)
+		{
+			// nlerp on the short arc
+			q0 = a3quantizedTrackInternalDecodeRotate(r0);
+			q1 = a3quantizedTrackInternalDecodeRotate(r1);
+			d = _mm_mul_ps(q0, q1);
+			d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+			d = _mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1)));
+			q1 = _mm_xor_ps(q1, _mm_and_ps(_mm_set1_ps(-0.0f), _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0))));
+			q0 = _mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(q1, q0), u));
+			d = _mm_mul_ps(q0, q0);
+			d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+			d = _mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1)));
+			d = _mm_sqrt_ss(d);
+			_mm_storeu_ps(pose_out->rotate[j].q, _mm_div_ps(q0, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0))));
+		}
+		for (j = 0; j < track->translateCount; ++j, t0 += 3, t1 += 3)
+		{
+			q0 = a3quantizedTrackInternalDecodeRange(t0, track->translateMin + j, track->translateStep + j);
+			q1 = a3quantizedTrackInternalDecodeRange(t1, track->translateMin + j, track->translateStep + j);
+			a3quantizedTrackInternalStore3(pose_out->translate + track->translateNode[j], _mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(q1, q0), u)));
+		}
+		for (j = 0; j < track->scaleCount; ++j, s0 += 3, s1 += 3)
+		{
+			q0 = a3quantizedTrackInternalDecodeRange(s0, track->scaleMin + j, track->scaleStep + j);
+			q1 = a3quantizedTrackInternalDecodeRange(s1, track->scaleMin + j, track->scaleStep + j);
+			a3quantizedTrackInternalStore3(pose_out->scale + track->scaleNode[j], _mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(q1, q0), u)));
+		}
+#else	// !A3_QUANTIZEDTRACK_SSE
+		for (j = 0; j < nodeCount; ++j, r0 += 3, r1 += 3)
+		{
+			a3quantizedTrackInternalDecodeRotate(q0, r0);
+			a3quantizedTrackInternalDecodeRotate(q1, r1);
+			if (q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3] < a3real_zero)
+				for (i = 0; i < 4; ++i)
+					q1[i] = -q1[i];
+			for (i = 0; i < 4; ++i)
+				q0[i] += (q1[i] - q0[i]) * param;
+			d = a3sqrtInverse(q0[0] * q0[0] + q0[1] * q0[1] + q0[2] * q0[2] + q0[3] * q0[3]);
+			for (i = 0; i < 4; ++i)
+				pose_out->rotate[j].q[i] = q0[i] * d;
+		}
+		for (j = 0; j < track->translateCount; ++j, t0 += 3, t1 += 3)
+		{
+			a3quantizedTrackInternalDecodeRange(v0, t0, track->translateMin + j, track->translateStep + j);
+			a3quantizedTrackInternalDecodeRange(v1, t1, track->translateMin + j, track->translateStep + j);
+			for (i = 0; i < 3; ++i)
+				pose_out->translate[track->translateNode[j]].v[i] = v0[i] + (v1[i] - v0[i]) * param;
+		}
+		for (j = 0; j < track->scaleCount; ++j, s0 += 3, s1 += 3)
+		{
+			a3quantizedTrackInternalDecodeRange(v0, s0, track->scaleMin + j, track->scaleStep + j);
+			a3quantizedTrackInternalDecodeRange(v1, s1, track->scaleMin + j, track->scaleStep + j);
+			for (i = 0; i < 3; ++i)
+				pose_out->scale[track->scaleNode[j]].v[i] = v0[i] + (v1[i] - v0[i]) * param;
+		}
+#endif	// A3_QUANTIZEDTRACK_SSE
+
+		// done
+		return nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3quantizedTrackMeasureError(a3_QuantizedTrackReport *report_out, const a3_QuantizedTrack *track, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip)
+{
+	if (report_out && track && track->data && poseGroup && poseGroup->hierarchy && clip && clip->keyframePool &&
+		clip->keyframeCount == track->keyCount && poseGroup->hierarchy->numNodes == track->nodeCount)
+	{
+		const a3_Keyframe *keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		const a3ui32 nodeCount = track->nodeCount, count = track->keyCount * nodeCount;
+		const a3_HierarchyPose *source;
+		a3_HierarchyPose decoded[1];
+		a3vec3 delta;
+		a3real error, d;
+		a3ui32 i, j, k;
+
+		decoded->rotate = (a3quat *)malloc((sizeof(a3quat) + sizeof(a3vec3) * 2) * nodeCount);
+		if (!decoded->rotate)
+			return -1;
+		decoded->translate = (a3vec3 *)(decoded->rotate + nodeCount);
+		decoded->scale = decoded->translate + nodeCount;
+		memset(report_out, 0, sizeof(a3_QuantizedTrackReport));
+
+		for (k = 0; k < track->keyCount; ++k)
+		{
+			source = poseGroup->hpose + keyframe[k].data;
+			a3quantizedTrackDecode(decoded, track, k);
+			for (j = 0; j < nodeCount; ++j)
+			{
+				// angle between rotations
+				d = a3absolute(a3real4Dot(source->rotate[j].q, decoded->rotate[j].q));
+				error = a3real_two * a3acosd(a3minimum(d, a3real_one));
+				report_out->rotateErrorMax = a3maximum(report_out->rotateErrorMax, error);
+				report_out->rotateErrorMean += error;
+
+				a3real3Diff(delta.v, source->translate[j].v, decoded->translate[j].v);
+				error = a3real3Length(delta.v);
+				report_out->translateErrorMax = a3maximum(report_out->translateErrorMax, error);
+				report_out->translateErrorMean += error;
+
+				for (i = 0; i < 3; ++i)
+				{
+					error = a3absolute(source->scale[j].v[i] - decoded->scale[j].v[i]);
+					report_out->scaleErrorMax = a3maximum(report_out->scaleErrorMax, error);
+				}
+			}
+		}
+		free(decoded->rotate);
+		report_out->rotateErrorMean /= (a3real)count;
+		report_out->translateErrorMean /= (a3real)count;
+
+		// payload sizes, excluding alignment padding
+		report_out->sizeRaw = (sizeof(a3quat) + sizeof(a3vec3) * 2) * count;
+		report_out->sizeQuantized = (sizeof(a3ui16) * 3) * (nodeCount + track->translateCount + track->scaleCount) * track->keyCount
+			+ (sizeof(a3ui32) + sizeof(a3vec3) * 2) * (track->translateCount + track->scaleCount)
+			+ sizeof(a3vec3) * 2 * nodeCount;
+
+		// done
+		return track->keyCount;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,433 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_ReducedTrack.c
+	Implementation of reduced tracks.
+*/
+
+#include "../a3_ReducedTrack.h"
+#include "../a3_Kinematics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// block alignment
+#define A3_REDUCEDTRACK_ALIGN		16
+#define a3reducedTrackInternalAlign(sz)	(((sz) + (A3_REDUCEDTRACK_ALIGN - 1)) & ~(A3_REDUCEDTRACK_ALIGN - 1))
+
+// effectively no limit
+#define A3_REDUCEDTRACK_UNBOUNDED	((a3real)1.0e30f)
+
+
+//-----------------------------------------------------------------------------
+// interpolation and error tests; the reducer and sampler must agree
+
+static inline void a3reducedTrackInternalNlerp(a3quat *q_out, const a3quat *q0, const a3quat *q1, const a3real param)
+{
+	const a3real s = a3real4Dot(q0->q, q1->q) < a3real_zero ? -param : param;
+	const a3real r = a3real_one - param;
+	a3real d;
+	q_out->x = q0->x * r + q1->x * s;
+	q_out->y = q0->y * r + q1->y * s;
+	q_out->z = q0->z * r + q1->z * s;
+	q_out->w = q0->w * r + q1->w * s;
+	d = a3sqrtInverse(a3real4Dot(q_out->q, q_out->q));
+	a3real4MulS(q_out->q, d);
+}
+
+static inline void a3reducedTrackInternalLerp(a3vec3 *v_out, const a3vec3 *v0, const a3vec3 *v1, const a3real param)
+{
+	v_out->x = v0->x + (v1->x - v0->x) * param;
+	v_out->y = v0->y + (v1->y - v0->y) * param;
+	v_out->z = v0->z + (v1->z - v0->z) * param;
+}
+
+// squared distance between rotations on the short arc; unlike the dot 
+//	product this keeps its precision for tiny angles: a chord of length c 
+//	is an angle of 4 * asin(c / 2)
+static inline a3real a3reducedTrackInternalChordSq(const a3quat *q0, const a3quat *q1)
+{
+	a3real4 d;
+	if (a3real4Dot(q0->q, q1->q) < a3real_zero)
+		a3real4Sum(d, q0->q, q1->q);
+	else
+		a3real4Diff(d, q0->q, q1->q);
+	return a3real4LengthSquared(d);
+}
+
+// can every key strictly between first and final be rebuilt from them?
+//	rotation bound is the squared chord of the allowed angle
+static inline a3boolean a3reducedTrackInternalSpanRotate(const a3_HierarchyPoseGroup *poseGroup, const a3_Keyframe *keyframe, const a3real *keyTime, const a3ui32 node, const a3ui32 first, const a3ui32 final, const a3real bound)
+{
+	const a3quat *q0 = poseGroup->hpose[keyframe[first].data].rotate + node;
+	const a3quat *q1 = poseGroup->hpose[keyframe[final].data].rotate + node;
+	const a3real dtInv = a3recip(keyTime[final] - keyTime[first]);
+	a3quat q;
+	a3ui32 k;
+	for (k = first + 1; k < final; ++k)
+	{
+		a3reducedTrackInternalNlerp(&q, q0, q1, (keyTime[k] - keyTime[first]) * dtInv);
+		if (a3reducedTrackInternalChordSq(&q, poseGroup->hpose[keyframe[k].data].rotate + node) > bound)
+			return a3false;
+	}
+	return a3true;
+}
+
+// same for translation (distance bound) and scale (per-component bound)
+static inline a3boolean a3reducedTrackInternalSpanVec3(const a3_HierarchyPoseGroup *poseGroup, const a3_Keyframe *keyframe, const a3real *keyTime, const a3ui32 node, const a3ui32 first, const a3ui32 final, const a3real bound, const a3boolean isScale)
+{
+	const a3vec3 *v0, *v1, *v;
+	const a3real dtInv = a3recip(keyTime[final] - keyTime[first]);
+	a3vec3 p;
+	a3ui32 k;
+	v0 = (isScale ? poseGroup->hpose[keyframe[first].data].scale : poseGroup->hpose[keyframe[first].data].translate) + node;
+	v1 = (isScale ? poseGroup->hpose[keyframe[final].data].scale : poseGroup->hpose[keyframe[final].data].translate) + node;
+	for (k = first + 1; k < final; ++k)
+	{
+		v = (isScale ? poseGroup->hpose[keyframe[k].data].scale : poseGroup->hpose[keyframe[k].data].translate) + node;
+		a3reducedTrackInternalLerp(&p, v0, v1, (keyTime[k] - keyTime[first]) * dtInv);
+		a3real3Sub(p.v, v->v);
+		if (isScale ? (a3absolute(p.x) > bound || a3absolute(p.y) > bound || a3absolute(p.z) > bound) : (a3real3Length(p.v) > bound))
+			return a3false;
+	}
+	return a3true;
+}
+
+// greedy reduction of one channel: from each kept key, extend the span 
+//	as far as the tolerance allows and keep its end; returns kept count
+//	channel: 0 = rotate, 1 = translate, 2 = scale
+static inline a3ui32 a3reducedTrackInternalReduce(a3ubyte *keep_out, const a3_HierarchyPoseGroup *poseGroup, const a3_Keyframe *keyframe, const a3real *keyTime, const a3ui32 keyCount, const a3ui32 node, const a3ui32 channel, const a3real bound)
+{
+	a3ui32 first, final, count;
+	a3boolean ok;
+	memset(keep_out, 0, keyCount);
+	keep_out[0] = keep_out[keyCount - 1] = 1;
+	for (first = 0, count = 1; first + 1 < keyCount; first = final - 1, ++count)
+	{
+		for (final = first + 2; final < keyCount; ++final)
+		{
+			ok = channel ? a3reducedTrackInternalSpanVec3(poseGroup, keyframe, keyTime, node, first, final, bound, channel == 2)
+				: a3reducedTrackInternalSpanRotate(poseGroup, keyframe, keyTime, node, first, final, bound);
+			if (!ok)
+				break;
+		}
+		keep_out[final - 1] = 1;
+	}
+	return count;
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3reducedTrackCreate(a3_ReducedTrack *track_out, a3_ReducedTrackReport *report_out_opt, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip, const a3_ReducedTrackTolerance *tolerance)
+{
+	if (track_out && !track_out->data && poseGroup && poseGroup->hierarchy && clip && clip->keyframePool && clip->keyframeCount && tolerance)
+	{
+		const a3_Keyframe *keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		const a3i32 *parentIndex = poseGroup->hierarchy->parentIndex;
+		const a3ui32 nodeCount = poseGroup->hierarchy->numNodes, keyCount = clip->keyframeCount;
+		a3real *keyTime, *reach, *bound, length, effector;
+		a3ui32 *level, *below, count[3];
+		a3ubyte *keep, *data;
+		a3ui32 c, i, j, k, n;
+		a3i32 p;
+		size_t size[10], dataSize;
+
+		// validate keyframe pose indices
+		for (k = 0; k < keyCount; ++k)
+			if (keyframe[k].data >= poseGroup->poseCount)
+				return -1;
+
+		// working memory: key times, per-node reach and chain length, 
+		//	per-channel bounds, keep flags
+		keyTime = (a3real *)malloc(sizeof(a3real) * (keyCount + nodeCount * 4) + sizeof(a3ui32) * nodeCount * 2 + keyCount * nodeCount * 3);
+		if (!keyTime)
+			return -1;
+		reach = keyTime + keyCount;
+		bound = reach + nodeCount;
+		level = (a3ui32 *)(bound + nodeCount * 3);
+		below = level + nodeCount;
+		keep = (a3ubyte *)(below + nodeCount);
+
+		// source key times
+		for (k = 1, keyTime[0] = a3real_zero; k < keyCount; ++k)
+			keyTime[k] = keyTime[k - 1] + keyframe[k - 1].duration;
+
+		// depth of each node, then longest offset length and node count 
+		//	from each node down to a leaf (children follow parents)
+		for (j = 0; j < nodeCount; ++j)
+		{
+			p = parentIndex[j];
+			level[j] = p >= 0 ? level[p] + 1 : 0;
+			below[j] = 0;
+			reach[j] = a3real_zero;
+		}
+		for (j = nodeCount - 1; j > 0; --j)
+			if ((p = parentIndex[j]) >= 0)
+			{
+				for (k = 0, length = a3real_zero; k < keyCount; ++k)
+					length = a3maximum(length, a3real3Length(poseGroup->hpose[keyframe[k].data].translate[j].v));
+				reach[p] = a3maximum(reach[p], reach[j] + length);
+				below[p] = a3maximum(below[p], below[j] + 1);
+			}
+
+		// per-node bounds: joint tolerance, tightened so that error spread 
+		//	evenly along the longest chain through the node stays within 
+		//	effector tolerance; rotating by angle a moves a point at 
+		//	distance r by at most a * r, and so does scale error s * r
+		for (j = 0; j < nodeCount; ++j)
+		{
+			effector = tolerance->effector > a3real_zero ? tolerance->effector / (a3real)(level[j] + below[j] + 1) : A3_REDUCEDTRACK_UNBOUNDED;
+			length = reach[j] > a3real_zero ? effector / reach[j] : A3_REDUCEDTRACK_UNBOUNDED;
+			bound[j * 3 + 0] = a3real_two * a3sind(a3real_quarter * a3minimum(tolerance->rotate, length * a3real_rad2deg));
+			bound[j * 3 + 0] *= bound[j * 3 + 0];
+			bound[j * 3 + 1] = a3minimum(tolerance->translate, effector);
+			bound[j * 3 + 2] = a3minimum(tolerance->scale, length);
+		}
+
+		// reduce each channel
+		count[0] = count[1] = count[2] = 0;
+		for (j = 0; j < nodeCount; ++j)
+			for (c = 0; c < 3; ++c)
+				count[c] += (keyCount > 1) ? a3reducedTrackInternalReduce(keep + (j * 3 + c) * keyCount, poseGroup, keyframe, keyTime, keyCount, j, c, bound[j * 3 + c])
+					: (keep[(j * 3 + c) * keyCount] = 1);
+
+		// one block for everything
+		size[0] = a3reducedTrackInternalAlign(sizeof(a3ui32) * (nodeCount + 1));
+		size[1] = size[2] = size[0];
+		size[3] = a3reducedTrackInternalAlign(sizeof(a3real) * count[0]);
+		size[4] = a3reducedTrackInternalAlign(sizeof(a3real) * count[1]);
+		size[5] = a3reducedTrackInternalAlign(sizeof(a3real) * count[2]);
+		size[6] = a3reducedTrackInternalAlign(sizeof(a3quat) * count[0]);
+		size[7] = a3reducedTrackInternalAlign(sizeof(a3vec3) * count[1]);
+		size[8] = a3reducedTrackInternalAlign(sizeof(a3vec3) * count[2]);
+		for (i = 0, dataSize = 0; i < 9; ++i)
+			dataSize += size[i];
+		track_out->data = malloc(dataSize);
+		if (!track_out->data)
+		{
+			free(keyTime);
+			return -1;
+		}
+		data = (a3ubyte *)track_out->data;
+		track_out->rotateOffset = (a3ui32 *)data;
+		track_out->translateOffset = (a3ui32 *)(data += size[0]);
+		track_out->scaleOffset = (a3ui32 *)(data += size[1]);
+		track_out->rotateTime = (a3real *)(data += size[2]);
+		track_out->translateTime = (a3real *)(data += size[3]);
+		track_out->scaleTime = (a3real *)(data += size[4]);
+		track_out->rotate = (a3quat *)(data += size[5]);
+		track_out->translate = (a3vec3 *)(data += size[6]);
+		track_out->scale = (a3vec3 *)(data += size[7]);
+		track_out->nodeCount = nodeCount;
+		track_out->keyCount = keyCount;
+		track_out->duration = keyTime[keyCount - 1];
+
+		// copy kept keys
+		for (j = 0, count[0] = count[1] = count[2] = 0; j < nodeCount; ++j)
+		{
+			track_out->rotateOffset[j] = count[0];
+			track_out->translateOffset[j] = count[1];
+			track_out->scaleOffset[j] = count[2];
+			for (k = 0; k < keyCount; ++k)
+			{
+				n = keyframe[k].data;
+				if (keep[(j * 3 + 0) * keyCount + k])
+				{
+					track_out->rotateTime[count[0]] = keyTime[k];
+					track_out->rotate[count[0]++] = poseGroup->hpose[n].rotate[j];
+				}
+				if (keep[(j * 3 + 1) * keyCount + k])
+				{
+					track_out->translateTime[count[1]] = keyTime[k];
+					track_out->translate[count[1]++] = poseGroup->hpose[n].translate[j];
+				}
+				if (keep[(j * 3 + 2) * keyCount + k])
+				{
+					track_out->scaleTime[count[2]] = keyTime[k];
+					track_out->scale[count[2]++] = poseGroup->hpose[n].scale[j];
+				}
+			}
+		}
+		track_out->rotateOffset[nodeCount] = count[0];
+		track_out->translateOffset[nodeCount] = count[1];
+		track_out->scaleOffset[nodeCount] = count[2];
+		free(keyTime);
+
+		// report
+		if (report_out_opt)
+			a3reducedTrackMeasureError(report_out_opt, track_out, poseGroup, clip);
+
+		// done
+		return (count[0] + count[1] + count[2]);
+	}
+	return -1;
+}
+
+a3i32 a3reducedTrackRelease(a3_ReducedTrack *track)
+{
+	if (track && track->data)
+	{
+		free(track->data);
+		memset(track, 0, sizeof(a3_ReducedTrack));
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3reducedTrackSample(const a3_HierarchyPose *pose_out, const a3_ReducedTrack *track, const a3real time)
+{
+	if (pose_out && pose_out->rotate && track && track->data)
+	{
+		const a3real t = a3clamp(a3real_zero, track->duration, time);
+		a3ui32 j, first, count, k;
+		a3real u;
+
+		for (j = 0; j < track->nodeCount; ++j)
+		{
+			first = track->rotateOffset[j];
+			count = track->rotateOffset[j + 1] - first;
+			a3reducedTrackFindKey(&k, &u, track->rotateTime + first, count, t);
+			if (count > 1)
+				a3reducedTrackInternalNlerp(pose_out->rotate + j, track->rotate + first + k, track->rotate + first + k + 1, u);
+			else
+				pose_out->rotate[j] = track->rotate[first];
+
+			first = track->translateOffset[j];
+			count = track->translateOffset[j + 1] - first;
+			a3reducedTrackFindKey(&k, &u, track->translateTime + first, count, t);
+			if (count > 1)
+				a3reducedTrackInternalLerp(pose_out->translate + j, track->translate + first + k, track->translate + first + k + 1, u);
+			else
+				pose_out->translate[j] = track->translate[first];
+
+			first = track->scaleOffset[j];
+			count = track->scaleOffset[j + 1] - first;
+			a3reducedTrackFindKey(&k, &u, track->scaleTime + first, count, t);
+			if (count > 1)
+				a3reducedTrackInternalLerp(pose_out->scale + j, track->scale + first + k, track->scale + first + k + 1, u);
+			else
+				pose_out->scale[j] = track->scale[first];
+		}
+
+		// done
+		return track->nodeCount;
+	}
+	return -1;
+}
+
+a3i32 a3reducedTrackMeasureError(a3_ReducedTrackReport *report_out, const a3_ReducedTrack *track, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip)
+{
+	if (report_out && track && track->data && poseGroup && poseGroup->hierarchy && clip && clip->keyframePool &&
+		clip->keyframeCount == track->keyCount && poseGroup->hierarchy->numNodes == track->nodeCount)
+	{
+		const a3_Keyframe *keyframe = clip->keyframePool->keyframe + clip->keyframeIndex_first;
+		const a3i32 *parentIndex = poseGroup->hierarchy->parentIndex;
+		const a3ui32 nodeCount = track->nodeCount;
+		const a3_HierarchyPose *source;
+		a3_HierarchyState state[2] = { 0 };
+		a3ubyte *isLeaf;
+		a3vec3 delta;
+		a3real time, error, d;
+		a3ui32 i, j, k;
+
+		// source and reduced poses are solved side by side
+		isLeaf = (a3ubyte *)malloc(nodeCount);
+		if (!isLeaf)
+			return -1;
+		if (a3hierarchyStateCreate(state + 0, poseGroup) < 0 || a3hierarchyStateCreate(state + 1, poseGroup) < 0)
+		{
+			a3hierarchyStateRelease(state + 0);
+			free(isLeaf);
+			return -1;
+		}
+		memset(isLeaf, 1, nodeCount);
+		for (j = 0; j < nodeCount; ++j)
+			if (parentIndex[j] >= 0)
+				isLeaf[parentIndex[j]] = 0;
+		memset(report_out, 0, sizeof(a3_ReducedTrackReport));
+
+		for (k = 0, time = a3real_zero; k < track->keyCount; time += keyframe[k++].duration)
+		{
+			source = poseGroup->hpose + keyframe[k].data;
+			memcpy(state[0].localPose->rotate, source->rotate, sizeof(a3quat) * nodeCount);
+			memcpy(state[0].localPose->translate, source->translate, sizeof(a3vec3) * nodeCount);
+			memcpy(state[0].localPose->scale, source->scale, sizeof(a3vec3) * nodeCount);
+			a3reducedTrackSample(state[1].localPose, track, time);
+
+			// joint space
+			for (j = 0; j < nodeCount; ++j)
+			{
+				d = a3sqrt(a3reducedTrackInternalChordSq(source->rotate + j, state[1].localPose->rotate + j));
+				error = a3real_four * a3asind(a3minimum(a3real_half * d, a3real_one));
+				report_out->rotateErrorMax = a3maximum(report_out->rotateErrorMax, error);
+
+				a3real3Diff(delta.v, source->translate[j].v, state[1].localPose->translate[j].v);
+				error = a3real3Length(delta.v);
+				report_out->translateErrorMax = a3maximum(report_out->translateErrorMax, error);
+
+				for (i = 0; i < 3; ++i)
+				{
+					error = a3absolute(source->scale[j].v[i] - state[1].localPose->scale[j].v[i]);
+					report_out->scaleErrorMax = a3maximum(report_out->scaleErrorMax, error);
+				}
+			}
+
+			// object space at the ends of chains
+			for (i = 0; i < 2; ++i)
+			{
+				a3hierarchyStateUpdateLocalSpace(state + i);
+				a3kinematicsSolveForward(state + i);
+			}
+			for (j = 0; j < nodeCount; ++j)
+				if (isLeaf[j])
+				{
+					a3real3Diff(delta.v, state[0].objectSpace->transform[j].v3.v, state[1].objectSpace->transform[j].v3.v);
+					error = a3real3Length(delta.v);
+					report_out->effectorErrorMax = a3maximum(report_out->effectorErrorMax, error);
+				}
+		}
+		a3hierarchyStateRelease(state + 1);
+		a3hierarchyStateRelease(state + 0);
+		free(isLeaf);
+
+		// counts, ratio and payload sizes (excluding alignment padding)
+		report_out->rotateKeyCount = track->rotateOffset[nodeCount];
+		report_out->translateKeyCount = track->translateOffset[nodeCount];
+		report_out->scaleKeyCount = track->scaleOffset[nodeCount];
+		report_out->keyCountRaw = track->keyCount * nodeCount * 3;
+		report_out->keyCountReduced = report_out->rotateKeyCount + report_out->translateKeyCount + report_out->scaleKeyCount;
+		report_out->ratio = (a3real)report_out->keyCountRaw / (a3real)report_out->keyCountReduced;
+		report_out->sizeRaw = (sizeof(a3quat) + sizeof(a3vec3) * 2) * track->keyCount * nodeCount;
+		report_out->sizeReduced = (sizeof(a3real) + sizeof(a3quat)) * report_out->rotateKeyCount
+			+ (sizeof(a3real) + sizeof(a3vec3)) * (report_out->translateKeyCount + report_out->scaleKeyCount)
+			+ sizeof(a3ui32) * 3 * (nodeCount + 1);
+
+		// done
+		return track->keyCount;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
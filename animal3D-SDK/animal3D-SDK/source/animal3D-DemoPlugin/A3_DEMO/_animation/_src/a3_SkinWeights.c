@@ -0,0 +1,346 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_SkinWeights.c
+	Implementation of skin weight loading and caching.
+*/
+
+#include "../a3_SkinWeights.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// cache file header; weights then indices follow, tightly packed
+typedef struct a3_SkinWeightsInternalHeader
+{
+	a3byte tag[4];
+	a3ui32 version;
+	a3ui32 fileSize;
+	a3ui32 pointCount, nodeCount;
+	a3ui32 hierarchyHash;
+} a3_SkinWeightsInternalHeader;
+
+static const a3byte a3skinWeightsInternalTag[4] = { 'A', '3', 'S', 'W' };
+
+
+//-----------------------------------------------------------------------------
+
+// allocate storage for point count
+static inline a3i32 a3skinWeightsInternalCreate(a3_SkinWeights *weights_out, const a3ui32 pointCount, const a3ui32 nodeCount)
+{
+	const a3ui32 count = pointCount * a3skinning_influenceMax;
+	weights_out->data = malloc((sizeof(a3ui16) + sizeof(a3ubyte)) * count);
+	if (weights_out->data)
+	{
+		weights_out->weight = (a3ui16 *)weights_out->data;
+		weights_out->index = (a3ubyte *)(weights_out->weight + count);
+		weights_out->pointCount = pointCount;
+		weights_out->nodeCount = nodeCount;
+		memset(weights_out->data, 0, (sizeof(a3ui16) + sizeof(a3ubyte)) * count);
+		return pointCount;
+	}
+	return -1;
+}
+
+// combined hash of all node names, identifying the rig a cache is for
+static inline a3ui32 a3skinWeightsInternalHashHierarchy(const a3_Hierarchy *hierarchy)
+{
+	a3ui32 i, hash = hierarchy->numNodes;
+	for (i = 0; i < hierarchy->numNodes; ++i)
+		hash = (hash * 31u) ^ a3hierarchyHashName(hierarchy->nodeName[i]);
+	return hash;
+}
+
+// start of quoted attribute value in element text, or null
+static inline const a3byte *a3skinWeightsInternalAttrib(const a3byte *str, const a3byte *attribQuote)
+{
+	const a3byte *value = strstr(str, attribQuote);
+	return (value ? value + strlen(attribQuote) : 0);
+}
+
+// keep influence if it is among the heaviest for the point, slots sorted 
+//	heaviest first
+static inline void a3skinWeightsInternalInsert(a3real *weight, a3ubyte *index, const a3real w, const a3ubyte node)
+{
+	a3ui32 k = a3skinning_influenceMax;
+	if (w > weight[k - 1])
+	{
+		for (--k; k && w > weight[k - 1]; --k)
+		{
+			weight[k] = weight[k - 1];
+			index[k] = index[k - 1];
+		}
+		weight[k] = w;
+		index[k] = node;
+	}
+}
+
+// renormalize kept influences and quantize so they sum to exactly one; 
+//	the rounding remainder goes to the heaviest
+static inline void a3skinWeightsInternalQuantize(a3ui16 *weight_out, const a3real *weight)
+{
+	a3real sum = a3real_zero;
+	a3ui32 k, total = 0;
+	for (k = 0; k < a3skinning_influenceMax; ++k)
+		sum += weight[k];
+	if (sum > a3real_zero)
+	{
+		sum = (a3real)a3skinWeights_weightOne / sum;
+		for (k = 1; k < a3skinning_influenceMax; ++k)
+			total += (weight_out[k] = (a3ui16)(weight[k] * sum + a3real_half));
+		weight_out[0] = (a3ui16)(a3skinWeights_weightOne - total);
+	}
+	else
+	{
+		// unweighted points follow the first node
+		weight_out[0] = a3skinWeights_weightOne;
+		for (k = 1; k < a3skinning_influenceMax; ++k)
+			weight_out[k] = 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3skinWeightsLoadXML(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *resourceFilePath)
+{
+	if (weights_out && !weights_out->data && hierarchy && hierarchy->parentIndex && 
+		hierarchy->numNodes <= a3skinWeights_nodeMax && resourceFilePath && *resourceFilePath)
+	{
+		FILE *fp = fopen(resourceFilePath, "r");
+		a3byte line[512], name[a3node_nameSize], *end;
+		const a3byte *str, *value;
+		a3real *accum = 0, w;
+		a3ui32 pointCount = 0, point, i;
+		a3i32 node = -1;
+		a3boolean inWeights = a3false, failed = a3false;
+
+		if (!fp)
+		{
+			printf("\n A3 Warning: Could not open skin weights file \'%s\'.", resourceFilePath);
+			return -1;
+		}
+		setvbuf(fp, 0, _IOFBF, 1 << 16);
+
+		// single pass over lines; the exporter writes one element per line, 
+		//	so only the element at the start of each line is looked at
+		while (!failed && fgets(line, sizeof(line), fp))
+		{
+			// a line that filled the buffer without ending was cut short: 
+			//	the rest would be read as a separate line, so give up
+			i = (a3ui32)strlen(line);
+			if (i == sizeof(line) - 1 && line[i - 1] != '\n' && getc(fp) != EOF)
+			{
+				printf("\n A3 Warning: Line too long in skin weights file '%s'.", resourceFilePath);
+				failed = a3true;
+				break;
+			}
+
+			for (str = line; *str == ' ' || *str == '\t'; ++str);
+			if (*str++ != '<')
+				continue;
+
+			if (!strncmp(str, "point ", 6))
+			{
+				// shape points hold positions, so only points in a bound 
+				//	weights element count
+				if (inWeights && node >= 0 && 
+					(value = a3skinWeightsInternalAttrib(str, "index=\"")) && 
+					(point = (a3ui32)strtoul(value, &end, 10), end != value) && point < pointCount && 
+					(value = a3skinWeightsInternalAttrib(str, "value=\"")))
+				{
+					w = (a3real)strtod(value, &end);
+					if (end != value && w > a3real_zero)
+						a3skinWeightsInternalInsert(accum + point * a3skinning_influenceMax, 
+							weights_out->index + point * a3skinning_influenceMax, w, (a3ubyte)node);
+				}
+			}
+			else if (!strncmp(str, "weights ", 8))
+			{
+				// bind to node once per element
+				inWeights = a3true;
+				node = -1;
+				if (!accum)
+					printf("\n A3 Warning: Skin weights before shape in \'%s\'.", resourceFilePath);
+				else if ((value = a3skinWeightsInternalAttrib(str, "source=\"")))
+				{
+					for (i = 0; i < a3node_nameSize - 1 && value[i] && value[i] != '\"'; ++i)
+						name[i] = value[i];
+					name[i] = 0;
+					node = a3hierarchyGetNodeIndex(hierarchy, name);
+					if (node < 0)
+						printf("\n A3 Warning: Skipping skin weights for unknown node \'%s\'.", name);
+				}
+			}
+			else if (!strncmp(str, "/weights", 8))
+				inWeights = a3false;
+			else if (!strncmp(str, "shape ", 6) && !accum)
+			{
+				// point count is known: allocate everything
+				if ((value = a3skinWeightsInternalAttrib(str, "size=\"")))
+					pointCount = (a3ui32)strtoul(value, 0, 10);
+				failed = (!pointCount || 
+					a3skinWeightsInternalCreate(weights_out, pointCount, hierarchy->numNodes) < 0 || 
+					!(accum = (a3real *)malloc(sizeof(a3real) * a3skinning_influenceMax * pointCount)));
+				if (accum)
+					memset(accum, 0, sizeof(a3real) * a3skinning_influenceMax * pointCount);
+			}
+		}
+		fclose(fp);
+
+		if (failed || !accum)
+		{
+			printf("\n A3 Warning: Failed to load skin weights file \'%s\'.", resourceFilePath);
+			free(accum);
+			a3skinWeightsRelease(weights_out);
+			return -1;
+		}
+
+		// batched pass: renormalize and quantize
+		for (point = 0; point < pointCount; ++point)
+			a3skinWeightsInternalQuantize(weights_out->weight + point * a3skinning_influenceMax, accum + point * a3skinning_influenceMax);
+		free(accum);
+
+		// done
+		return pointCount;
+	}
+	return -1;
+}
+
+a3i32 a3skinWeightsSave(const a3_SkinWeights *weights, const a3_Hierarchy *hierarchy, const a3byte *cacheFilePath)
+{
+	if (weights && weights->data && hierarchy && hierarchy->parentIndex && 
+		weights->nodeCount == hierarchy->numNodes && cacheFilePath && *cacheFilePath)
+	{
+		const a3ui32 count = weights->pointCount * a3skinning_influenceMax;
+		a3_SkinWeightsInternalHeader header = { 0 };
+		a3ui32 ret = 0;
+		FILE *fp;
+
+		memcpy(header.tag, a3skinWeightsInternalTag, sizeof(header.tag));
+		header.version = a3skinWeights_version;
+		header.fileSize = sizeof(header) + (sizeof(a3ui16) + sizeof(a3ubyte)) * count;
+		header.pointCount = weights->pointCount;
+		header.nodeCount = weights->nodeCount;
+		header.hierarchyHash = a3skinWeightsInternalHashHierarchy(hierarchy);
+
+		fp = fopen(cacheFilePath, "wb");
+		if (fp)
+		{
+			ret += (a3ui32)fwrite(&header, 1, sizeof(header), fp);
+			ret += (a3ui32)fwrite(weights->weight, sizeof(a3ui16), count, fp) * sizeof(a3ui16);
+			ret += (a3ui32)fwrite(weights->index, sizeof(a3ubyte), count, fp);
+			fclose(fp);
+			return ret;
+		}
+		printf("\n A3 Warning: Could not write skin weights cache \'%s\'.", cacheFilePath);
+	}
+	return -1;
+}
+
+a3i32 a3skinWeightsLoad(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *cacheFilePath)
+{
+	if (weights_out && !weights_out->data && hierarchy && hierarchy->parentIndex && cacheFilePath && *cacheFilePath)
+	{
+		FILE *fp = fopen(cacheFilePath, "rb");
+		a3_SkinWeightsInternalHeader header;
+		a3ui32 count;
+		if (fp)
+		{
+			// validate before allocating
+			if (fread(&header, sizeof(header), 1, fp) == 1 && 
+				!memcmp(header.tag, a3skinWeightsInternalTag, sizeof(header.tag)) && 
+				header.version == a3skinWeights_version && header.pointCount && 
+				header.nodeCount == hierarchy->numNodes && 
+				header.hierarchyHash == a3skinWeightsInternalHashHierarchy(hierarchy) && 
+				header.fileSize == sizeof(header) + (sizeof(a3ui16) + sizeof(a3ubyte)) * header.pointCount * a3skinning_influenceMax && 
+				a3skinWeightsInternalCreate(weights_out, header.pointCount, header.nodeCount) >= 0)
+			{
+				// weights and indices are contiguous in both file and memory
+				count = header.pointCount * a3skinning_influenceMax;
+				if (fread(weights_out->data, sizeof(a3ui16) + sizeof(a3ubyte), count, fp) == count)
+				{
+					fclose(fp);
+					return header.pointCount;
+				}
+				a3skinWeightsRelease(weights_out);
+			}
+			fclose(fp);
+			printf("\n A3 Warning: Ignoring invalid or outdated skin weights cache \'%s\'.", cacheFilePath);
+		}
+	}
+	return -1;
+}
+
+a3i32 a3skinWeightsRelease(a3_SkinWeights *weights)
+{
+	if (weights)
+	{
+		if (weights->data)
+		{
+			free(weights->data);
+			weights->data = 0;
+			weights->weight = 0;
+			weights->index = 0;
+			weights->pointCount = weights->nodeCount = 0;
+			return 1;
+		}
+	}
+	return -1;
+}
+
+a3i32 a3skinWeightsDecode(const a3_SkinWeights *weights, a3vec4 *blendWeight_out, a3i32 *blendIndex_out, const a3ui32 *vertexPoint_opt, const a3ui32 vertexCount)
+{
+	if (weights && weights->data && blendWeight_out && blendIndex_out && 
+		(vertexPoint_opt || vertexCount == weights->pointCount))
+	{
+		const a3real scale = a3real_one / (a3real)a3skinWeights_weightOne;
+		const a3ui16 *weight;
+		const a3ubyte *index;
+		a3ui32 i, k, point;
+
+		// check the whole map before writing anything
+		if (vertexPoint_opt)
+			for (i = 0; i < vertexCount; ++i)
+				if (vertexPoint_opt[i] >= weights->pointCount)
+					return -1;
+
+		for (i = 0; i < vertexCount; ++i)
+		{
+			point = (vertexPoint_opt ? vertexPoint_opt[i] : i) * a3skinning_influenceMax;
+			weight = weights->weight + point;
+			index = weights->index + point;
+			for (k = 0; k < a3skinning_influenceMax; ++k)
+			{
+				blendWeight_out[i].v[k] = (a3real)weight[k] * scale;
+				*(blendIndex_out++) = index[k];
+			}
+		}
+		return vertexCount;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
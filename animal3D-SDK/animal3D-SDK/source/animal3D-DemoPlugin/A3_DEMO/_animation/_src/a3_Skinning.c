@@ -0,0 +1,889 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_Skinning.c
+	Implementation of CPU skinning.
+*/
+
+#include "../a3_Skinning.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else	// !_WIN32
+#include <pthread.h>
+#endif	// _WIN32
+
+#if (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__)
+#define A3_SKINNING_SSE
+#include <xmmintrin.h>
+#endif	// SSE
+
+
+//-----------------------------------------------------------------------------
+// vertex kernels: the blended transform is built column by column from 
+//	the influences' palette matrices, then applied to each attribute; the 
+//	palette is affine, so only the first three columns rotate directions
+// each loop takes its influence count as a constant, so once inlined the 
+//	blend unrolls to exactly that many palette fetches, and whether outputs 
+//	are scattered through the mesh's vertex origins
+
+// scalar reference kernels, also the path taken without SSE
+
+// weighted sum of palette matrices
+static inline void a3skinningInternalBlendLinearScalar(a3real *b_out, const a3mat4 *palette, const a3i32 *index, const a3real *weight, const a3ui32 influenceCount)
+{
+	const a3real *m = palette[index[0]].mm;
+	a3ui32 k, c;
+	for (c = 0; c < 16; ++c)
+		b_out[c] = m[c] * weight[0];
+	for (k = 1; k < influenceCount; ++k)
+	{
+		m = palette[index[k]].mm;
+		for (c = 0; c < 16; ++c)
+			b_out[c] += m[c] * weight[k];
+	}
+}
+
+static inline void a3skinningInternalRotateScalar(a3real *v_out, const a3real *b, const a3real *v)
+{
+	v_out[0] = b[0] * v[0] + b[4] * v[1] + b[8] * v[2];
+	v_out[1] = b[1] * v[0] + b[5] * v[1] + b[9] * v[2];
+	v_out[2] = b[2] * v[0] + b[6] * v[1] + b[10] * v[2];
+}
+
+static inline void a3skinningInternalRotateNormalizeScalar(a3real *v_out, const a3real *b, const a3real *v)
+{
+	a3real s;
+	a3skinningInternalRotateScalar(v_out, b, v);
+	s = a3sqrtInverse(a3maximum(v_out[0] * v_out[0] + v_out[1] * v_out[1] + v_out[2] * v_out[2], (a3real)1.0e-30));
+	v_out[0] *= s;
+	v_out[1] *= s;
+	v_out[2] *= s;
+}
+
+static inline void a3skinningInternalLinearRangeScalar(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	a3real b[16], *p;
+	a3ui32 i, o;
+	for (i = first; i < end; ++i)
+	{
+		o = remap ? mesh->vertexOrigin[i] : i;
+		a3skinningInternalBlendLinearScalar(b, job->palette, mesh->blendIndex + i * a3skinning_influenceMax, mesh->blendWeight[i].v, influenceCount);
+		p = job->position_out[o].v;
+		a3skinningInternalRotateScalar(p, b, mesh->position[i].v);
+		p[0] += b[12];
+		p[1] += b[13];
+		p[2] += b[14];
+		if (job->normal_out)
+			a3skinningInternalRotateNormalizeScalar(job->normal_out[o].v, b, mesh->normal[i].v);
+		if (job->tangent_out)
+			a3skinningInternalRotateNormalizeScalar(job->tangent_out[o].v, b, mesh->tangent[i].v);
+		if (job->bitangent_out)
+			a3skinningInternalRotateNormalizeScalar(job->bitangent_out[o].v, b, mesh->bitangent[i].v);
+	}
+}
+
+// weighted sum of palette dual quaternions in the first one's hemisphere, 
+//	scaled to unit real part
+static inline void a3skinningInternalBlendDualQuatScalar(a3real *q_out, const a3dualquat *palette, const a3i32 *index, const a3real *weight, const a3ui32 influenceCount)
+{
+	const a3real *q0 = palette[index[0]].QQ, *qk;
+	a3real w, s;
+	a3ui32 k, c;
+	for (c = 0; c < 8; ++c)
+		q_out[c] = q0[c] * weight[0];
+	for (k = 1; k < influenceCount; ++k)
+	{
+		qk = palette[index[k]].QQ;
+		w = (qk[0] * q0[0] + qk[1] * q0[1] + qk[2] * q0[2] + qk[3] * q0[3]) < a3real_zero ? -weight[k] : weight[k];
+		for (c = 0; c < 8; ++c)
+			q_out[c] += qk[c] * w;
+	}
+	s = a3sqrtInverse(a3maximum(q_out[0] * q_out[0] + q_out[1] * q_out[1] + q_out[2] * q_out[2] + q_out[3] * q_out[3], (a3real)1.0e-30));
+	for (c = 0; c < 8; ++c)
+		q_out[c] *= s;
+}
+
+// direction rotated by unit quaternion: v + 2 r x (r x v + w v)
+static inline void a3skinningInternalRotateQuatScalar(a3real *v_out, const a3real *r, const a3real *v)
+{
+	const a3real t[3] = {
+		r[1] * v[2] - r[2] * v[1] + r[3] * v[0],
+		r[2] * v[0] - r[0] * v[2] + r[3] * v[1],
+		r[0] * v[1] - r[1] * v[0] + r[3] * v[2],
+	};
+	v_out[0] = v[0] + (r[1] * t[2] - r[2] * t[1]) * a3real_two;
+	v_out[1] = v[1] + (r[2] * t[0] - r[0] * t[2]) * a3real_two;
+	v_out[2] = v[2] + (r[0] * t[1] - r[1] * t[0]) * a3real_two;
+}
+
+static inline void a3skinningInternalDualQuatRangeScalar(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	a3real q[8], *p;
+	const a3real *r = q, *d = q + 4;
+	a3ui32 i, o;
+	for (i = first; i < end; ++i)
+	{
+		o = remap ? mesh->vertexOrigin[i] : i;
+		a3skinningInternalBlendDualQuatScalar(q, job->paletteDualQuat, mesh->blendIndex + i * a3skinning_influenceMax, mesh->blendWeight[i].v, influenceCount);
+		p = job->position_out[o].v;
+		a3skinningInternalRotateQuatScalar(p, r, mesh->position[i].v);
+
+		// translation decoded from dual part: 2 (w d - dw r + r x d)
+		p[0] += (r[3] * d[0] - d[3] * r[0] + r[1] * d[2] - r[2] * d[1]) * a3real_two;
+		p[1] += (r[3] * d[1] - d[3] * r[1] + r[2] * d[0] - r[0] * d[2]) * a3real_two;
+		p[2] += (r[3] * d[2] - d[3] * r[2] + r[0] * d[1] - r[1] * d[0]) * a3real_two;
+		if (job->normal_out)
+			a3skinningInternalRotateQuatScalar(job->normal_out[o].v, r, mesh->normal[i].v);
+		if (job->tangent_out)
+			a3skinningInternalRotateQuatScalar(job->tangent_out[o].v, r, mesh->tangent[i].v);
+		if (job->bitangent_out)
+			a3skinningInternalRotateQuatScalar(job->bitangent_out[o].v, r, mesh->bitangent[i].v);
+	}
+}
+
+
+#ifdef A3_SKINNING_SSE
+
+// weighted sum of palette matrices
+static inline void a3skinningInternalBlendLinear(__m128 *b_out, const a3mat4 *palette, const a3i32 *index, const a3real *weight, const a3ui32 influenceCount)
+{
+	const a3real *m = palette[index[0]].mm;
+	__m128 w = _mm_set1_ps(weight[0]);
+	a3ui32 k, c;
+	for (c = 0; c < 4; ++c)
+		b_out[c] = _mm_mul_ps(_mm_load_ps(m + c * 4), w);
+	for (k = 1; k < influenceCount; ++k)
+	{
+		m = palette[index[k]].mm;
+		w = _mm_set1_ps(weight[k]);
+		for (c = 0; c < 4; ++c)
+			b_out[c] = _mm_add_ps(b_out[c], _mm_mul_ps(_mm_load_ps(m + c * 4), w));
+	}
+}
+
+// direction through basis columns
+static inline __m128 a3skinningInternalRotate(const __m128 *b, const a3real *v)
+{
+	return _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(b[0], _mm_set1_ps(v[0])), _mm_mul_ps(b[1], _mm_set1_ps(v[1]))),
+		_mm_mul_ps(b[2], _mm_set1_ps(v[2])));
+}
+
+// unit length with one refinement of the reciprocal square root estimate; 
+//	w must be zero
+static inline __m128 a3skinningInternalNormalize(const __m128 v)
+{
+	__m128 d = _mm_mul_ps(v, v), r;
+	d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+	d = _mm_max_ps(_mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2))), _mm_set1_ps(1.0e-30f));
+	r = _mm_rsqrt_ps(d);
+	r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), d), _mm_mul_ps(r, r))));
+	return _mm_mul_ps(v, r);
+}
+
+static inline void a3skinningInternalStore3(a3real *v_out, const __m128 v)
+{
+	_mm_storel_pi((__m64 *)v_out, v);
+	_mm_store_ss(v_out + 2, _mm_movehl_ps(v, v));
+}
+
+static inline void a3skinningInternalLinearRange(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	const a3real *p;
+	__m128 b[4];
+	a3ui32 i, o;
+	for (i = first; i < end; ++i)
+	{
+		o = remap ? mesh->vertexOrigin[i] : i;
+		a3skinningInternalBlendLinear(b, job->palette, mesh->blendIndex + i * a3skinning_influenceMax, mesh->blendWeight[i].v, influenceCount);
+		p = mesh->position[i].v;
+		a3skinningInternalStore3(job->position_out[o].v, _mm_add_ps(a3skinningInternalRotate(b, p), b[3]));
+		if (job->normal_out)
+			a3skinningInternalStore3(job->normal_out[o].v, a3skinningInternalNormalize(a3skinningInternalRotate(b, mesh->normal[i].v)));
+		if (job->tangent_out)
+			a3skinningInternalStore3(job->tangent_out[o].v, a3skinningInternalNormalize(a3skinningInternalRotate(b, mesh->tangent[i].v)));
+		if (job->bitangent_out)
+			a3skinningInternalStore3(job->bitangent_out[o].v, a3skinningInternalNormalize(a3skinningInternalRotate(b, mesh->bitangent[i].v)));
+	}
+}
+
+// weighted sum of palette dual quaternions, each flipped into the first 
+//	one's hemisphere so opposite signs of one rotation do not cancel, then 
+//	scaled to unit real part
+static inline void a3skinningInternalBlendDualQuat(__m128 *r_out, __m128 *d_out, const a3dualquat *palette, const a3i32 *index, const a3real *weight, const a3ui32 influenceCount)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 r0 = _mm_load_ps(palette[index[0]].Q[0]);
+	__m128 r = _mm_mul_ps(r0, _mm_set1_ps(weight[0])), d = _mm_mul_ps(_mm_load_ps(palette[index[0]].Q[1]), _mm_set1_ps(weight[0]));
+	__m128 rk, w, n;
+	a3ui32 k;
+	for (k = 1; k < influenceCount; ++k)
+	{
+		rk = _mm_load_ps(palette[index[k]].Q[0]);
+		w = _mm_mul_ps(rk, r0);
+		w = _mm_add_ps(w, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 3, 0, 1)));
+		w = _mm_add_ps(w, _mm_shuffle_ps(w, w, _MM_SHUFFLE(1, 0, 3, 2)));
+		w = _mm_xor_ps(_mm_set1_ps(weight[k]), _mm_and_ps(w, sign));
+		r = _mm_add_ps(r, _mm_mul_ps(rk, w));
+		d = _mm_add_ps(d, _mm_mul_ps(_mm_load_ps(palette[index[k]].Q[1]), w));
+	}
+	n = _mm_mul_ps(r, r);
+	n = _mm_add_ps(n, _mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 3, 0, 1)));
+	n = _mm_max_ps(_mm_add_ps(n, _mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 0, 3, 2))), _mm_set1_ps(1.0e-30f));
+	w = _mm_rsqrt_ps(n);
+	w = _mm_mul_ps(w, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), n), _mm_mul_ps(w, w))));
+	*r_out = _mm_mul_ps(r, w);
+	*d_out = _mm_mul_ps(d, w);
+}
+
+// vector part of cross product; w comes out zero
+static inline __m128 a3skinningInternalCross(const __m128 a, const __m128 b)
+{
+	return _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2))),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))));
+}
+
+// direction rotated by unit quaternion: v + 2 r x (r x v + w v); stays 
+//	unit length, so no renormalizing
+static inline __m128 a3skinningInternalRotateQuat(const __m128 r, const __m128 rw, const __m128 v)
+{
+	const __m128 t = _mm_add_ps(a3skinningInternalCross(r, v), _mm_mul_ps(rw, v));
+	return _mm_add_ps(v, _mm_add_ps(a3skinningInternalCross(r, t), a3skinningInternalCross(r, t)));
+}
+
+// three floats with zero w
+static inline __m128 a3skinningInternalLoad3(const a3real *v)
+{
+	return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)v), _mm_load_ss(v + 2));
+}
+
+static inline void a3skinningInternalDualQuatRange(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	__m128 r, d, rw, t;
+	a3ui32 i, o;
+	for (i = first; i < end; ++i)
+	{
+		o = remap ? mesh->vertexOrigin[i] : i;
+		a3skinningInternalBlendDualQuat(&r, &d, job->paletteDualQuat, mesh->blendIndex + i * a3skinning_influenceMax, mesh->blendWeight[i].v, influenceCount);
+		rw = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3));
+
+		// translation decoded from dual part: 2 (w d - dw r + r x d)
+		t = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, d), _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3)), r)), a3skinningInternalCross(r, d));
+		t = _mm_add_ps(t, t);
+		a3skinningInternalStore3(job->position_out[o].v, _mm_add_ps(a3skinningInternalRotateQuat(r, rw, a3skinningInternalLoad3(mesh->position[i].v)), t));
+		if (job->normal_out)
+			a3skinningInternalStore3(job->normal_out[o].v, a3skinningInternalRotateQuat(r, rw, a3skinningInternalLoad3(mesh->normal[i].v)));
+		if (job->tangent_out)
+			a3skinningInternalStore3(job->tangent_out[o].v, a3skinningInternalRotateQuat(r, rw, a3skinningInternalLoad3(mesh->tangent[i].v)));
+		if (job->bitangent_out)
+			a3skinningInternalStore3(job->bitangent_out[o].v, a3skinningInternalRotateQuat(r, rw, a3skinningInternalLoad3(mesh->bitangent[i].v)));
+	}
+}
+
+#else	// !A3_SKINNING_SSE
+
+static inline void a3skinningInternalLinearRange(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	a3skinningInternalLinearRangeScalar(job, first, end, influenceCount, remap);
+}
+
+static inline void a3skinningInternalDualQuatRange(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap)
+{
+	a3skinningInternalDualQuatRangeScalar(job, first, end, influenceCount, remap);
+}
+
+#endif	// A3_SKINNING_SSE
+
+
+// whole job: bucketed meshes get one loop per influence count over the 
+//	part of each bucket in range, others the full four-influence loop; 
+//	the scalar flag is constant at every call, so the choice folds away
+static inline void a3skinningInternalLinearBucket(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap, const a3boolean scalar)
+{
+	if (scalar)
+		a3skinningInternalLinearRangeScalar(job, first, end, influenceCount, remap);
+	else
+		a3skinningInternalLinearRange(job, first, end, influenceCount, remap);
+}
+
+static inline void a3skinningInternalDualQuatBucket(const a3_SkinningJob *job, const a3ui32 first, const a3ui32 end, const a3ui32 influenceCount, const a3boolean remap, const a3boolean scalar)
+{
+	if (scalar)
+		a3skinningInternalDualQuatRangeScalar(job, first, end, influenceCount, remap);
+	else
+		a3skinningInternalDualQuatRange(job, first, end, influenceCount, remap);
+}
+
+static inline void a3skinningInternalLinear(const a3_SkinningJob *job, const a3boolean scalar)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	const a3ui32 *bucket = mesh->bucketOffset;
+	const a3ui32 first = job->firstVertex, end = first + job->vertexCount;
+	if (mesh->vertexOrigin)
+	{
+		a3skinningInternalLinearBucket(job, a3maximum(first, bucket[0]), a3minimum(end, bucket[1]), 1, a3true, scalar);
+		a3skinningInternalLinearBucket(job, a3maximum(first, bucket[1]), a3minimum(end, bucket[2]), 2, a3true, scalar);
+		a3skinningInternalLinearBucket(job, a3maximum(first, bucket[2]), a3minimum(end, bucket[3]), 3, a3true, scalar);
+		a3skinningInternalLinearBucket(job, a3maximum(first, bucket[3]), a3minimum(end, bucket[4]), 4, a3true, scalar);
+	}
+	else
+		a3skinningInternalLinearBucket(job, first, end, a3skinning_influenceMax, a3false, scalar);
+}
+
+static inline void a3skinningInternalDualQuat(const a3_SkinningJob *job, const a3boolean scalar)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	const a3ui32 *bucket = mesh->bucketOffset;
+	const a3ui32 first = job->firstVertex, end = first + job->vertexCount;
+	if (mesh->vertexOrigin)
+	{
+		a3skinningInternalDualQuatBucket(job, a3maximum(first, bucket[0]), a3minimum(end, bucket[1]), 1, a3true, scalar);
+		a3skinningInternalDualQuatBucket(job, a3maximum(first, bucket[1]), a3minimum(end, bucket[2]), 2, a3true, scalar);
+		a3skinningInternalDualQuatBucket(job, a3maximum(first, bucket[2]), a3minimum(end, bucket[3]), 3, a3true, scalar);
+		a3skinningInternalDualQuatBucket(job, a3maximum(first, bucket[3]), a3minimum(end, bucket[4]), 4, a3true, scalar);
+	}
+	else
+		a3skinningInternalDualQuatBucket(job, first, end, a3skinning_influenceMax, a3false, scalar);
+}
+
+
+//-----------------------------------------------------------------------------
+
+// job can run on the given palette: outputs have inputs, range and 
+//	palette fit the mesh
+static inline a3boolean a3skinningInternalValid(const a3_SkinningJob *job, const void *palette)
+{
+	const a3_SkinMesh *mesh = job->mesh;
+	return (mesh && mesh->position && palette && !((size_t)palette & 15) && 
+		job->paletteCount >= mesh->paletteCount && job->position_out && 
+		job->firstVertex <= mesh->vertexCount && job->vertexCount <= mesh->vertexCount - job->firstVertex && 
+		(!job->normal_out || mesh->normal) && (!job->tangent_out || mesh->tangent) && (!job->bitangent_out || mesh->bitangent));
+}
+
+// slice entries; the whole job was checked before splitting
+static a3i32 a3skinningInternalThreadLinear(const a3_SkinningJob *job)
+{
+	a3skinningInternalLinear(job, a3false);
+	return job->vertexCount;
+}
+
+static a3i32 a3skinningInternalThreadDualQuat(const a3_SkinningJob *job)
+{
+	a3skinningInternalDualQuat(job, a3false);
+	return job->vertexCount;
+}
+
+
+//-----------------------------------------------------------------------------
+// worker pool: workers sleep on a condition until the dispatch count 
+//	changes, run their slice, and the last one to finish wakes the caller
+
+#ifdef _WIN32
+
+typedef HANDLE					a3_SkinningInternalThread;
+typedef CRITICAL_SECTION		a3_SkinningInternalLock;
+typedef CONDITION_VARIABLE		a3_SkinningInternalCondition;
+
+#define a3skinningInternalLockInit(lock)			InitializeCriticalSection(lock)
+#define a3skinningInternalLockTerm(lock)			DeleteCriticalSection(lock)
+#define a3skinningInternalLock(lock)				EnterCriticalSection(lock)
+#define a3skinningInternalUnlock(lock)				LeaveCriticalSection(lock)
+#define a3skinningInternalConditionInit(cond)		InitializeConditionVariable(cond)
+#define a3skinningInternalConditionTerm(cond)
+#define a3skinningInternalWait(cond, lock)			SleepConditionVariableCS(cond, lock, INFINITE)
+#define a3skinningInternalWakeAll(cond)				WakeAllConditionVariable(cond)
+
+#else	// !_WIN32
+
+typedef pthread_t				a3_SkinningInternalThread;
+typedef pthread_mutex_t			a3_SkinningInternalLock;
+typedef pthread_cond_t			a3_SkinningInternalCondition;
+
+#define a3skinningInternalLockInit(lock)			pthread_mutex_init(lock, 0)
+#define a3skinningInternalLockTerm(lock)			pthread_mutex_destroy(lock)
+#define a3skinningInternalLock(lock)				pthread_mutex_lock(lock)
+#define a3skinningInternalUnlock(lock)				pthread_mutex_unlock(lock)
+#define a3skinningInternalConditionInit(cond)		pthread_cond_init(cond, 0)
+#define a3skinningInternalConditionTerm(cond)		pthread_cond_destroy(cond)
+#define a3skinningInternalWait(cond, lock)			pthread_cond_wait(cond, lock)
+#define a3skinningInternalWakeAll(cond)				pthread_cond_broadcast(cond)
+
+#endif	// _WIN32
+
+
+typedef struct a3_SkinningInternalPool		a3_SkinningInternalPool;
+
+// what one worker thread is given: the pool and its slice
+typedef struct a3_SkinningInternalWorker
+{
+	a3_SkinningInternalPool *pool;
+	a3ui32 index;
+} a3_SkinningInternalWorker;
+
+// pool behind a3_SkinningWorkers; slice zero belongs to the caller
+struct a3_SkinningInternalPool
+{
+	// current dispatch: slice kernel, slices and their results
+	a3i32(*func)(const a3_SkinningJob *job);
+	a3_SkinningJob slice[a3skinning_threadMax];
+	a3i32 result[a3skinning_threadMax];
+
+	// dispatches so far, slices still running, shutdown flag
+	a3ui32 generation, pending;
+	a3boolean quit;
+
+	// synchronization and threads
+	a3_SkinningInternalLock lock[1];
+	a3_SkinningInternalCondition wake[1], done[1];
+	a3_SkinningInternalThread thread[a3skinning_threadMax];
+	a3_SkinningInternalWorker worker[a3skinning_threadMax];
+};
+
+// worker body: run every dispatch until shut down
+static void a3skinningInternalWorkerLoop(const a3_SkinningInternalWorker *worker)
+{
+	a3_SkinningInternalPool *pool = worker->pool;
+	const a3_SkinningJob *slice = pool->slice + worker->index;
+	a3ui32 seen = 0;
+	a3i32 result;
+	a3skinningInternalLock(pool->lock);
+	for (;;)
+	{
+		while (pool->generation == seen && !pool->quit)
+			a3skinningInternalWait(pool->wake, pool->lock);
+		if (pool->quit)
+			break;
+		seen = pool->generation;
+		a3skinningInternalUnlock(pool->lock);
+
+		result = slice->vertexCount ? pool->func(slice) : 0;
+
+		a3skinningInternalLock(pool->lock);
+		pool->result[worker->index] = result;
+		if (!--pool->pending)
+			a3skinningInternalWakeAll(pool->done);
+	}
+	a3skinningInternalUnlock(pool->lock);
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI a3skinningInternalWorkerEntry(LPVOID worker)
+{
+	a3skinningInternalWorkerLoop((const a3_SkinningInternalWorker *)worker);
+	return 0;
+}
+
+static a3boolean a3skinningInternalThreadStart(a3_SkinningInternalThread *thread_out, a3_SkinningInternalWorker *worker)
+{
+	return ((*thread_out = CreateThread(0, 0, a3skinningInternalWorkerEntry, worker, 0, 0)) != 0);
+}
+
+static void a3skinningInternalThreadJoin(a3_SkinningInternalThread *thread)
+{
+	WaitForSingleObject(*thread, INFINITE);
+	CloseHandle(*thread);
+}
+
+#else	// !_WIN32
+
+static void *a3skinningInternalWorkerEntry(void *worker)
+{
+	a3skinningInternalWorkerLoop((const a3_SkinningInternalWorker *)worker);
+	return 0;
+}
+
+static a3boolean a3skinningInternalThreadStart(a3_SkinningInternalThread *thread_out, a3_SkinningInternalWorker *worker)
+{
+	return (pthread_create(thread_out, 0, a3skinningInternalWorkerEntry, worker) == 0);
+}
+
+static void a3skinningInternalThreadJoin(a3_SkinningInternalThread *thread)
+{
+	pthread_join(*thread, 0);
+}
+
+#endif	// _WIN32
+
+// split job into slices, run the first here and the rest on the pool
+static inline a3i32 a3skinningInternalParallel(const a3_SkinningJob *job, const a3_SkinningWorkers *workers, a3i32(*func)(const a3_SkinningJob *job))
+{
+	a3_SkinningInternalPool *pool = (a3_SkinningInternalPool *)workers->data;
+	const a3ui32 count = workers->threadCount;
+	const a3ui32 end = job->firstVertex + job->vertexCount;
+	a3ui32 size, i;
+	a3i32 result;
+
+	if (count <= 1)
+		return func(job);
+
+	// slices in multiples of 16 vertices: 12-byte outputs then span whole 
+	//	64-byte lines, so no two threads write the same cache line (outputs 
+	//	of bucketed meshes are scattered, and may share lines at the seams)
+	size = ((job->vertexCount + count - 1) / count + 15) & ~15u;
+	a3skinningInternalLock(pool->lock);
+	pool->func = func;
+	for (i = 0; i < count; ++i)
+	{
+		pool->slice[i] = *job;
+		pool->slice[i].firstVertex = a3minimum(job->firstVertex + size * i, end);
+		pool->slice[i].vertexCount = a3minimum(size, end - pool->slice[i].firstVertex);
+		pool->result[i] = 0;
+	}
+	pool->pending = count - 1;
+	++pool->generation;
+	a3skinningInternalWakeAll(pool->wake);
+	a3skinningInternalUnlock(pool->lock);
+
+	// first slice here while the workers take the rest
+	result = pool->slice[0].vertexCount ? func(pool->slice) : 0;
+
+	a3skinningInternalLock(pool->lock);
+	while (pool->pending)
+		a3skinningInternalWait(pool->done, pool->lock);
+	for (i = 1; i < count; ++i)
+		if (pool->result[i] < 0)
+			result = -1;
+	a3skinningInternalUnlock(pool->lock);
+	return (result >= 0 ? (a3i32)job->vertexCount : -1);
+}
+
+
+//-----------------------------------------------------------------------------
+
+a3i32 a3skinningWorkersCreate(a3_SkinningWorkers *workers_out, const a3ui32 threadCount)
+{
+	if (workers_out && !workers_out->data && threadCount)
+	{
+		const a3ui32 count = a3minimum(threadCount, a3skinning_threadMax);
+		a3_SkinningInternalPool *pool = (a3_SkinningInternalPool *)malloc(sizeof(a3_SkinningInternalPool));
+		a3ui32 i;
+		if (!pool)
+			return -1;
+		memset(pool, 0, sizeof(a3_SkinningInternalPool));
+		a3skinningInternalLockInit(pool->lock);
+		a3skinningInternalConditionInit(pool->wake);
+		a3skinningInternalConditionInit(pool->done);
+
+		// the caller is thread zero; a pool that cannot start every 
+		//	worker just splits jobs fewer ways
+		for (i = 1; i < count; ++i)
+		{
+			pool->worker[i].pool = pool;
+			pool->worker[i].index = i;
+			if (!a3skinningInternalThreadStart(pool->thread + i, pool->worker + i))
+				break;
+		}
+		workers_out->threadCount = i;
+		workers_out->data = pool;
+		return i;
+	}
+	return -1;
+}
+
+a3i32 a3skinningWorkersRelease(a3_SkinningWorkers *workers)
+{
+	if (workers && workers->data)
+	{
+		a3_SkinningInternalPool *pool = (a3_SkinningInternalPool *)workers->data;
+		a3ui32 i;
+		a3skinningInternalLock(pool->lock);
+		pool->quit = a3true;
+		a3skinningInternalWakeAll(pool->wake);
+		a3skinningInternalUnlock(pool->lock);
+		for (i = 1; i < workers->threadCount; ++i)
+			a3skinningInternalThreadJoin(pool->thread + i);
+		a3skinningInternalConditionTerm(pool->done);
+		a3skinningInternalConditionTerm(pool->wake);
+		a3skinningInternalLockTerm(pool->lock);
+		free(pool);
+		memset(workers, 0, sizeof(a3_SkinningWorkers));
+		return 1;
+	}
+	return -1;
+}
+
+a3i32 a3skinMeshInit(a3_SkinMesh *mesh_out, const a3_GeometryData *geom)
+{
+	const void *address;
+	a3ui32 i, n;
+	a3i32 j;
+	if (mesh_out && geom && geom->data && 
+		geom->attribData[a3attrib_geomPosition] && geom->attribData[a3attrib_geomBlending])
+	{
+		n = geom->numVertices;
+		mesh_out->position = (const a3vec3 *)geom->attribData[a3attrib_geomPosition];
+		mesh_out->normal = (const a3vec3 *)geom->attribData[a3attrib_geomNormal];
+		mesh_out->tangent = (const a3vec3 *)geom->attribData[a3attrib_geomTangent];
+		mesh_out->bitangent = a3geometryGetAddressBitangent(&address, geom) > 0 ? (const a3vec3 *)address : 0;
+		mesh_out->blendWeight = (const a3vec4 *)geom->attribData[a3attrib_geomBlending];
+		mesh_out->blendIndex = a3geometryGetAddressBlendingInd(&address, geom) > 0 ? (const a3i32 *)address : 0;
+		mesh_out->vertexCount = n;
+		memset(mesh_out->bucketOffset, 0, sizeof(mesh_out->bucketOffset));
+		mesh_out->bucketOffset[a3skinning_influenceMax] = n;
+		mesh_out->vertexOrigin = 0;
+		mesh_out->data = 0;
+
+		// palette size needed, so jobs can be checked without scanning
+		for (i = 0, j = -1; i < n * a3skinning_influenceMax; ++i)
+		{
+			if (mesh_out->blendIndex[i] < 0)
+				return -1;
+			j = a3maximum(j, mesh_out->blendIndex[i]);
+		}
+		mesh_out->paletteCount = (a3ui32)(j + 1);
+		return n;
+	}
+	return -1;
+}
+
+a3i32 a3skinMeshCreateBucketed(a3_SkinMesh *mesh_out, const a3_SkinMesh *mesh)
+{
+	if (mesh_out && mesh && mesh->position && mesh->blendWeight && mesh->blendIndex && mesh_out != mesh)
+	{
+		const a3ui32 n = mesh->vertexCount;
+		const a3ui32 streamCount = 1 + !!mesh->normal + !!mesh->tangent + !!mesh->bitangent;
+		a3ubyte *count;
+		a3vec3 *stream;
+		a3vec4 *weight;
+		a3i32 *index;
+		a3ui32 *origin, offset[a3skinning_influenceMax + 1] = { 0 }, i, j, k, c;
+
+		// influence counts first: weights come first, so they stay aligned
+		mesh_out->data = malloc((sizeof(a3vec4) + sizeof(a3i32) * a3skinning_influenceMax + sizeof(a3vec3) * streamCount + sizeof(a3ui32)) * n + n);
+		if (!mesh_out->data)
+			return -1;
+		weight = (a3vec4 *)mesh_out->data;
+		index = (a3i32 *)(weight + n);
+		stream = (a3vec3 *)(index + n * a3skinning_influenceMax);
+		origin = (a3ui32 *)(stream + n * streamCount);
+		count = (a3ubyte *)(origin + n);
+		for (i = 0; i < n; ++i)
+		{
+			for (k = c = 0; k < a3skinning_influenceMax; ++k)
+				c += (mesh->blendWeight[i].v[k] != a3real_zero);
+
+			count[i] = (a3ubyte)a3maximum(c, 1) - 1;
+			++offset[count[i] + 1];
+		}
+		for (k = 0; k < a3skinning_influenceMax; ++k)
+			offset[k + 1] += offset[k];
+		memcpy(mesh_out->bucketOffset, offset, sizeof(offset));
+
+		// stable counting sort; used influences move to the front in order, 
+		//	unused ones get zero weight and repeat the first index, so an 
+		//	unweighted vertex keeps one zero influence
+		for (i = 0; i < n; ++i)
+		{
+			j = offset[count[i]]++;
+			origin[j] = i;
+			weight[j] = a3vec4_zero;
+			for (k = 0; k < a3skinning_influenceMax; ++k)
+				index[j * a3skinning_influenceMax + k] = mesh->blendIndex[i * a3skinning_influenceMax];
+			for (k = c = 0; k < a3skinning_influenceMax; ++k)
+				if (mesh->blendWeight[i].v[k] != a3real_zero)
+				{
+					weight[j].v[c] = mesh->blendWeight[i].v[k];
+					index[j * a3skinning_influenceMax + c++] = mesh->blendIndex[i * a3skinning_influenceMax + k];
+				}
+		}
+
+		// gather attribute streams into sorted order
+		mesh_out->position = stream;
+		mesh_out->normal = mesh->normal ? (stream += n) : 0;
+		mesh_out->tangent = mesh->tangent ? (stream += n) : 0;
+		mesh_out->bitangent = mesh->bitangent ? (stream += n) : 0;
+		for (j = 0; j < n; ++j)
+		{
+			i = origin[j];
+			((a3vec3 *)mesh_out->position)[j] = mesh->position[i];
+			if (mesh->normal)
+				((a3vec3 *)mesh_out->normal)[j] = mesh->normal[i];
+			if (mesh->tangent)
+				((a3vec3 *)mesh_out->tangent)[j] = mesh->tangent[i];
+			if (mesh->bitangent)
+				((a3vec3 *)mesh_out->bitangent)[j] = mesh->bitangent[i];
+		}
+
+		// source copies compose, so origins always refer to the geometry
+		if (mesh->vertexOrigin)
+			for (j = 0; j < n; ++j)
+				origin[j] = mesh->vertexOrigin[origin[j]];
+
+		mesh_out->blendWeight = weight;
+		mesh_out->blendIndex = index;
+		mesh_out->vertexOrigin = origin;
+		mesh_out->vertexCount = n;
+		mesh_out->paletteCount = mesh->paletteCount;
+		return n;
+	}
+	return -1;
+}
+
+a3i32 a3skinMeshRelease(a3_SkinMesh *mesh)
+{
+	if (mesh)
+	{
+		if (mesh->data)
+		{
+			free(mesh->data);
+			memset(mesh, 0, sizeof(a3_SkinMesh));
+			return 1;
+		}
+	}
+	return -1;
+}
+
+a3i32 a3skinningLinear(const a3_SkinningJob *job)
+{
+	if (job && a3skinningInternalValid(job, job->palette))
+	{
+		a3skinningInternalLinear(job, a3false);
+		return job->vertexCount;
+	}
+	return -1;
+}
+
+a3i32 a3skinningLinearScalar(const a3_SkinningJob *job)
+{
+	if (job && a3skinningInternalValid(job, job->palette))
+	{
+		a3skinningInternalLinear(job, a3true);
+		return job->vertexCount;
+	}
+	return -1;
+}
+
+a3i32 a3skinningLinearParallel(const a3_SkinningJob *job, const a3_SkinningWorkers *workers)
+{
+	if (job && workers && workers->data && a3skinningInternalValid(job, job->palette))
+		return a3skinningInternalParallel(job, workers, a3skinningInternalThreadLinear);
+	return -1;
+}
+
+
+a3i32 a3skinningPaletteDualQuat(a3dualquat *paletteDualQuat_out, const a3mat4 *palette, const a3ui32 count)
+{
+	const a3real *m;
+	a3real *q, *d, s[3], r[3][3], t;
+	a3ui32 i, j;
+	if (paletteDualQuat_out && palette)
+	{
+		for (i = 0; i < count; ++i)
+		{
+			m = palette[i].mm;
+			q = paletteDualQuat_out[i].QQ;
+			d = q + 4;
+
+			// rotation from normalized basis columns, r[row][col]
+			for (j = 0; j < 3; ++j)
+				s[j] = a3sqrtInverse(a3maximum(m[j * 4] * m[j * 4] + m[j * 4 + 1] * m[j * 4 + 1] + m[j * 4 + 2] * m[j * 4 + 2], (a3real)1.0e-30));
+			for (j = 0; j < 9; ++j)
+				r[j % 3][j / 3] = m[(j / 3) * 4 + j % 3] * s[j / 3];
+
+			// largest component first so its divisor is well away from zero
+			t = r[0][0] + r[1][1] + r[2][2];
+			if (t > a3real_zero)
+			{
+				t = a3sqrt(t + a3real_one) * a3real_two;
+				q[0] = (r[2][1] - r[1][2]) / t;
+				q[1] = (r[0][2] - r[2][0]) / t;
+				q[2] = (r[1][0] - r[0][1]) / t;
+				q[3] = t * a3real_quarter;
+			}
+			else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+			{
+				t = a3sqrt(a3real_one + r[0][0] - r[1][1] - r[2][2]) * a3real_two;
+				q[0] = t * a3real_quarter;
+				q[1] = (r[0][1] + r[1][0]) / t;
+				q[2] = (r[0][2] + r[2][0]) / t;
+				q[3] = (r[2][1] - r[1][2]) / t;
+			}
+			else if (r[1][1] > r[2][2])
+			{
+				t = a3sqrt(a3real_one + r[1][1] - r[0][0] - r[2][2]) * a3real_two;
+				q[0] = (r[0][1] + r[1][0]) / t;
+				q[1] = t * a3real_quarter;
+				q[2] = (r[1][2] + r[2][1]) / t;
+				q[3] = (r[0][2] - r[2][0]) / t;
+			}
+			else
+			{
+				t = a3sqrt(a3real_one + r[2][2] - r[0][0] - r[1][1]) * a3real_two;
+				q[0] = (r[0][2] + r[2][0]) / t;
+				q[1] = (r[1][2] + r[2][1]) / t;
+				q[2] = t * a3real_quarter;
+				q[3] = (r[1][0] - r[0][1]) / t;
+			}
+			t = a3sqrtInverse(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+			q[0] *= t;
+			q[1] *= t;
+			q[2] *= t;
+			q[3] *= t;
+
+			// dual part: half of translation times rotation
+			d[0] = (m[12] * q[3] + m[13] * q[2] - m[14] * q[1]) * a3real_half;
+			d[1] = (m[13] * q[3] + m[14] * q[0] - m[12] * q[2]) * a3real_half;
+			d[2] = (m[14] * q[3] + m[12] * q[1] - m[13] * q[0]) * a3real_half;
+			d[3] = -(m[12] * q[0] + m[13] * q[1] + m[14] * q[2]) * a3real_half;
+		}
+		return count;
+	}
+	return -1;
+}
+
+a3i32 a3skinningDualQuat(const a3_SkinningJob *job)
+{
+	if (job && a3skinningInternalValid(job, job->paletteDualQuat))
+	{
+		a3skinningInternalDualQuat(job, a3false);
+		return job->vertexCount;
+	}
+	return -1;
+}
+
+a3i32 a3skinningDualQuatScalar(const a3_SkinningJob *job)
+{
+	if (job && a3skinningInternalValid(job, job->paletteDualQuat))
+	{
+		a3skinningInternalDualQuat(job, a3true);
+		return job->vertexCount;
+	}
+	return -1;
+}
+
+a3i32 a3skinningDualQuatParallel(const a3_SkinningJob *job, const a3_SkinningWorkers *workers)
+{
+	if (job && workers && workers->data && a3skinningInternalValid(job, job->paletteDualQuat))
+		return a3skinningInternalParallel(job, workers, a3skinningInternalThreadDualQuat);
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
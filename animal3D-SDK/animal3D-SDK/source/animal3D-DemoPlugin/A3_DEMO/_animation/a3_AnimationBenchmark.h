@@ -0,0 +1,106 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationBenchmark.h
+	Timing of vectorized animation kernels against their scalar references.
+*/
+
+#ifndef __ANIMAL3D_ANIMATIONBENCHMARK_H
+#define __ANIMAL3D_ANIMATIONBENCHMARK_H
+
+
+#include "a3_HierarchyState.h"
+#include "a3_Skinning.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+typedef struct a3_AnimationBenchmark		a3_AnimationBenchmark;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// result of timing one kernel against its scalar reference on the same 
+//	input; times are wall-clock seconds per pass, averaged over all passes
+struct a3_AnimationBenchmark
+{
+	// elements processed per pass (nodes or vertices) and passes timed
+	a3ui32 count, passes;
+
+	// vector path and scalar reference
+	a3f64 vectorTime, scalarTime;
+
+	// largest absolute difference between the two outputs
+	a3real maxError;
+};
+
+
+//-----------------------------------------------------------------------------
+
+// get seconds since an arbitrary fixed point, from the highest resolution 
+//	monotonic clock available
+a3f64 a3animationBenchmarkTime();
+
+// get how many times faster the vector path ran
+a3f64 a3animationBenchmarkSpeedup(const a3_AnimationBenchmark *result);
+
+// time forward kinematics on a state whose local-space transforms are 
+//	current: each vector pass marks every node and runs the dirty-tracking 
+//	solver, each scalar pass runs the scalar reference; leaves the vector 
+//	result in the state; returns node count
+a3i32 a3animationBenchmarkForward(a3_AnimationBenchmark *result_out, const a3_HierarchyState *state, const a3boolean affine, const a3ui32 passes);
+
+// time forward kinematics on a synthetic single chain of the given 
+//	length (each joint a small twist and offset from its parent), which 
+//	stresses the serial dependency between parent and child; returns node 
+//	count
+a3i32 a3animationBenchmarkForwardChain(a3_AnimationBenchmark *result_out, const a3ui32 nodeCount, const a3boolean affine, const a3ui32 passes);
+
+// time skinning of a job on the calling thread, vector path against the 
+//	scalar reference, comparing positions and every requested direction; 
+//	output streams must hold the whole mesh (dual quaternion skinning also 
+//	needs the job's dual quaternion palette); leaves the vector result in 
+//	the outputs; returns vertex count
+a3i32 a3animationBenchmarkSkinning(a3_AnimationBenchmark *result_out, const a3_SkinningJob *job, const a3boolean dualQuat, const a3ui32 passes);
+
+// time skinning of a synthetic mesh on the forward chain benchmark's 
+//	chain, bound straight and skinned twisted: vertices are spread along 
+//	the bones with one to four influences from neighboring joints, and 
+//	have normal and tangent basis; returns vertex count
+a3i32 a3animationBenchmarkSkinningChain(a3_AnimationBenchmark *result_out, const a3ui32 vertexCount, const a3ui32 nodeCount, const a3boolean dualQuat, const a3ui32 passes);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_AnimationBenchmark.inl"
+
+
+#endif	// !__ANIMAL3D_ANIMATIONBENCHMARK_H
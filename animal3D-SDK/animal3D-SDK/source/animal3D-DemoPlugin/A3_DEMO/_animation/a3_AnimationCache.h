@@ -0,0 +1,95 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_AnimationCache.h
+	Memory-mappable binary cache for hierarchies, poses and clips.
+*/
+
+#ifndef __ANIMAL3D_ANIMATIONCACHE_H
+#define __ANIMAL3D_ANIMATIONCACHE_H
+
+
+#include "a3_HierarchyState.h"
+#include "a3_KeyframeAnimation.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// cache format version; bump whenever the file layout or the meaning of 
+//	stored values changes so that outdated caches are regenerated
+enum
+{
+	a3animationCache_version = 3,
+};
+
+
+//-----------------------------------------------------------------------------
+
+// save hierarchy, pose group and optional keyframe and clip pools to a 
+//	binary cache; every section starts on a 16-byte boundary so the file 
+//	can be mapped and used in place; returns number of bytes written
+a3i32 a3animationCacheSave(const a3_HierarchyPoseGroup *poseGroup, const a3_KeyframePool *keyframePool_opt, const a3_ClipPool *clipPool_opt, const a3byte *cacheFilePath);
+
+// map binary cache read-only; hierarchy and pools are small and copied 
+//	out, while pose group channels point straight into the mapping and 
+//	are paged in when first sampled (outputs must be unused); channels of 
+//	a mapped pose group are read-only: the view is mapped without write 
+//	access, so writing through them faults; every section is checked 
+//	against the file size and stored indices against their pools, and 
+//	on any failure nothing is kept and -1 is returned; returns pose count
+a3i32 a3animationCacheLoad(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, a3_KeyframePool *keyframePool_out_opt, a3_ClipPool *clipPool_out_opt, const a3byte *cacheFilePath);
+
+// check whether a cache is missing or older than its source file
+a3boolean a3animationCacheIsStale(const a3byte *cacheFilePath, const a3byte *sourceFilePath);
+
+// load HTR through cache: map the cache if it is current, otherwise parse 
+//	the HTR file and regenerate the cache; keyframe and clip pools come 
+//	from the optional clip set file, which also takes part in the staleness 
+//	check (pools are only filled if both are given, and must be empty); 
+//	returns pose count, or -1 with nothing kept if the HTR file or the 
+//	requested clip set fails to load
+a3i32 a3animationCacheLoadHTR(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, a3_KeyframePool *keyframePool_out_opt, a3_ClipPool *clipPool_out_opt, const a3byte *resourceFilePath, const a3byte *clipSetFilePath_opt, const a3byte *cacheFilePath);
+
+// release a file mapping created by loading a cache
+a3i32 a3animationCacheUnmap(void *mapping);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_AnimationCache.inl"
+
+
+#endif	// !__ANIMAL3D_ANIMATIONCACHE_H
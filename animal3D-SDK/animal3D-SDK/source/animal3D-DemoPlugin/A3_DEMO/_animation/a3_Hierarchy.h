@@ -38,7 +38,6 @@ extern "C"
 {
 #else	// !__cplusplus
 typedef struct a3_Hierarchy				a3_Hierarchy;
-typedef struct a3_HierarchyNode			a3_HierarchyNode;
 #endif	// __cplusplus
 
 
@@ -50,26 +49,64 @@ enum a3_HierarchyNodeNameSize
 	a3node_nameSize = 32
 };
 
-
-// A3: Hierarchy node, a single link in a hierarchy tree.
-//	member name: name of node (defaults to a3node_[index])
-//	member index: index of node in hierarchy
-//	member parentIndex: index of parent in hierarchy (-1 if root)
-struct a3_HierarchyNode
+// A3: Binary and string stream format version; streams start with a tag 
+//	and this version, and streams with any other version are rejected.
+enum a3_HierarchyStreamVersion
 {
-	a3byte name[a3node_nameSize];
-	a3i32 index;
-	a3i32 parentIndex;
+	a3hierarchy_streamVersion = 1
 };
 
 
-// A3: Hierarchy node container, the hierarchy itself.
-//	member nodes: array of nodes (null if unused)
+// A3: Hierarchy node container, the hierarchy itself; nodes are split 
+//		into a dense parent array (hot) and a name blob (cold), a node's 
+//		index being its position in both.
+//	member parentIndex: index of each node's parent in hierarchy (-1 if 
+//		root); the only place parents are stored (null if unused)
+//	member nodeName: name of each node, fixed-size entries in one blob 
+//		allocated after the parent array
 //	member numNodes: maximum number of nodes in hierarchy (zero if unused)
+//	member levelNodeIndex: node indices grouped by depth, roots first; 
+//		nodes within a level keep index order (null until levels are built)
+//	member levelOffset: first entry of each level in levelNodeIndex, plus 
+//		one final entry equal to the node count
+//	member nodeLevel: depth of each node (zero for roots)
+//	member numLevels: number of depth levels (zero until levels are built)
+//	member subtreeFirst: depth-first (preorder) position of each node 
+//		(null until subtrees are built)
+//	member subtreeEnd: one past the last preorder position in each node's 
+//		subtree; a node is an ancestor of another if the other's position 
+//		is in its range
+//	member childOffset: first entry of each node's children in childIndex, 
+//		plus one final entry
+//	member childIndex: child node indices grouped by parent, in index order
+//	member isDepthFirst: nodes are stored in preorder, so every subtree is 
+//		a contiguous node index span
+//	member nameHash: 32-bit hash of each node's name
+//	member nameNext: next node index in the same name bucket, or -1
+//	member nameBucket: first node index in each name bucket, or -1; 
+//		unnamed nodes are not indexed
+//	member nameBucketMask: number of name buckets (power of two) minus one
 struct a3_Hierarchy
 {
-	a3_HierarchyNode *nodes;
+	a3i32 *parentIndex;
+	a3byte (*nodeName)[a3node_nameSize];
 	a3ui32 numNodes;
+
+	a3ui32 *levelNodeIndex;
+	a3ui32 *levelOffset;
+	a3ui32 *nodeLevel;
+	a3ui32 numLevels;
+
+	a3ui32 *subtreeFirst;
+	a3ui32 *subtreeEnd;
+	a3ui32 *childOffset;
+	a3ui32 *childIndex;
+	a3boolean isDepthFirst;
+
+	a3ui32 *nameHash;
+	a3i32 *nameNext;
+	a3i32 *nameBucket;
+	a3ui32 nameBucketMask;
 };
 
 
@@ -100,6 +137,22 @@ a3ret a3hierarchySetNode(const a3_Hierarchy *hierarchy, const a3ui32 index, cons
 //	return: -1 if invalid params or node not found
 a3ret a3hierarchyGetNodeIndex(const a3_Hierarchy *hierarchy, const a3byte name[a3node_nameSize]);
 
+// A3: Calculate the hash used to index node names; store it to bind 
+//		many names without rehashing.
+//	param name: non-null name string
+//	return: 32-bit name hash
+//	return: 0 if invalid param
+a3ui32 a3hierarchyHashName(const a3byte name[a3node_nameSize]);
+
+// A3: Get node index by precalculated name hash.
+//	param hierarchy: non-null pointer to initialized hierarchy
+//	param nameHash: hash of name to search for
+//	param name_opt: optional name to compare against, guarding against 
+//		hash collisions; if null, the first node with the hash is returned
+//	return: index if success
+//	return: -1 if invalid params or node not found
+a3ret a3hierarchyGetNodeIndexByHash(const a3_Hierarchy *hierarchy, const a3ui32 nameHash, const a3byte name_opt[a3node_nameSize]);
+
 // A3: Utility to get all node names.
 //	param nameList_out: non-null pointer to pre-allocated cstring pointers 
 //		to hold node names; list should have at least as many pointers as 
@@ -149,7 +202,51 @@ a3ret a3hierarchyIsAncestorNode(const a3_Hierarchy *hierarchy, const a3ui32 ance
 //	return: -1 if invalid params
 a3ret a3hierarchyIsDescendantNode(const a3_Hierarchy *hierarchy, const a3ui32 descendantIndex, const a3ui32 otherIndex);
 
-// A3: Save hierarchy to binary file.
+// A3: Build depth-level topology index; nodes in the same level do not 
+//		depend on each other, so a level may be processed in any order or 
+//		split across workers once all previous levels are done. Must be 
+//		rebuilt if node parents change.
+//	param hierarchy: non-null pointer to initialized hierarchy
+//	return: number of levels if success
+//	return: -1 if invalid params or allocation failed (no levels then)
+a3ret a3hierarchyBuildLevels(a3_Hierarchy *hierarchy);
+
+// A3: Get the nodes belonging to a depth level.
+//	param levelNodeIndex_out: non-null pointer to receive first node index 
+//		of level in level-ordered node list
+//	param hierarchy: non-null pointer to initialized hierarchy with levels
+//	param levelIndex: index of level, less than level count
+//	return: number of nodes in level if success
+//	return: -1 if invalid params or levels not built
+a3ret a3hierarchyGetLevelNodes(const a3ui32 **levelNodeIndex_out, const a3_Hierarchy *hierarchy, const a3ui32 levelIndex);
+
+// A3: Build depth-first subtree ranges and child table; once built, 
+//		ancestor and descendant checks are constant-time. Must be rebuilt 
+//		if node parents change.
+//	param hierarchy: non-null pointer to initialized hierarchy
+//	return: number of nodes if success
+//	return: -1 if invalid params or allocation failed (no subtrees then)
+a3ret a3hierarchyBuildSubtrees(a3_Hierarchy *hierarchy);
+
+// A3: Get the children of a node.
+//	param childIndex_out: non-null pointer to receive first child index
+//	param hierarchy: non-null pointer to initialized hierarchy with subtrees
+//	param nodeIndex: non-negative index of node in hierarchy
+//	return: number of children if success
+//	return: -1 if invalid params or subtrees not built
+a3ret a3hierarchyGetChildNodes(const a3ui32 **childIndex_out, const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex);
+
+// A3: Get the contiguous node index span covering a node and all of its 
+//		descendants, starting at the node itself.
+//	param hierarchy: non-null pointer to initialized hierarchy with subtrees
+//	param nodeIndex: non-negative index of node in hierarchy
+//	return: number of nodes in span if success
+//	return: -1 if invalid params, subtrees not built or nodes are not 
+//		stored depth-first
+a3ret a3hierarchyGetSubtreeSpan(const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex);
+
+// A3: Save hierarchy to binary file; stored split as tag, version and 
+//		node count, parent index array, then fixed-size name blob.
 //	param hierarchy: non-null pointer to initialized hierarchy
 //	param fileStream: non-null pointer to file stream opened in write mode
 //	return: number of bytes written if success
@@ -161,11 +258,12 @@ a3ret a3hierarchySaveBinary(const a3_Hierarchy *hierarchy, const a3_FileStream *
 //	param hierarchy: non-null pointer to unused hierarchy
 //	param fileStream: non-null pointer to file stream opened in read mode
 //	return: number of bytes read if success
-//	return: 0 if failed
+//	return: 0 if failed, including tag or version mismatch and parents 
+//		not preceding their children
 //	return: -1 if invalid params
 a3ret a3hierarchyLoadBinary(a3_Hierarchy *hierarchy, const a3_FileStream *fileStream);
 
-// A3: Store hierarchy in string.
+// A3: Store hierarchy in string, split as in binary files.
 //	param hierarchy: non-null pointer to initialized hierarchy
 //	param str: non-null byte array to stream into
 //	return: number of bytes copied if success
@@ -177,7 +275,7 @@ a3ret a3hierarchyCopyToString(const a3_Hierarchy *hierarchy, a3byte *str);
 //	param hierarchy: non-null pointer to unused hierarchy
 //	param str: non-null byte array to stream from
 //	return: number of bytes copied if success
-//	return: 0 if failed
+//	return: 0 if failed, as with binary files
 //	return: -1 if invalid params
 a3ret a3hierarchyCopyFromString(a3_Hierarchy *hierarchy, const a3byte *str);
 
@@ -42,6 +42,8 @@ extern "C"
 typedef struct a3_HierarchyPose			a3_HierarchyPose;
 typedef struct a3_HierarchyTransform	a3_HierarchyTransform;
 typedef struct a3_HierarchyPoseGroup	a3_HierarchyPoseGroup;
+typedef enum a3_HierarchyScaleMode		a3_HierarchyScaleMode;
+typedef struct a3_HierarchyStateCounter	a3_HierarchyStateCounter;
 typedef struct a3_HierarchyState		a3_HierarchyState;
 #endif	// __cplusplus
 	
@@ -50,9 +52,12 @@ typedef struct a3_HierarchyState		a3_HierarchyState;
 
 // single pose for a collection of nodes
 // makes algorithms easier to keep this as a separate data type
+// channels are separate streams, one element per node
 struct a3_HierarchyPose
 {
-	a3_SpatialPose *spatialPose;
+	a3quat *rotate;
+	a3vec3 *translate;
+	a3vec3 *scale;
 };
 
 
@@ -68,6 +73,48 @@ struct a3_HierarchyPoseGroup
 {
 	// pointer to hierarchy
 	const a3_Hierarchy *hierarchy;
+
+	// hierarchy poses, each referencing its slice of the channel streams
+	a3_HierarchyPose *hpose;
+
+	// channel streams for all poses; each is contiguous, 16-byte aligned 
+	//	and indexed by node pose offset index
+	a3quat *rotate;
+	a3vec3 *translate;
+	a3vec3 *scale;
+
+	// number of hierarchy poses in group
+	a3ui32 poseCount;
+
+	// storage for all of the above
+	void *data;
+
+	// file mapping holding channel streams if loaded from a cache, in 
+	//	which case channels are read-only and writes fault (null if 
+	//	channels are in data)
+	void *mapping;
+};
+
+
+// what object-space transforms may contain, selecting how they are 
+//	inverted: rotation and translation only (the 3x3 part is transposed), 
+//	uniform scale (transposed and divided by squared scale), or any 
+//	affine transform (3x3 inverse by cross products)
+enum a3_HierarchyScaleMode
+{
+	a3hierarchyScale_ignore,
+	a3hierarchyScale_uniform,
+	a3hierarchyScale_general,
+};
+
+
+// number of nodes recomputed by each stage of the dirty-tracked update, 
+//	accumulated until reset
+struct a3_HierarchyStateCounter
+{
+	// local-space conversions, object-space products and skinning 
+	//	palette (bind-to-current) updates
+	a3ui32 localSpace, objectSpace, skinning;
 };
 
 
@@ -77,6 +124,30 @@ struct a3_HierarchyState
 {
 	// pointer to pose set that the poses come from
 	const a3_HierarchyPoseGroup *poseGroup;
+
+	// working local pose, target of sampling and blending
+	a3_HierarchyPose localPose[1];
+
+	// local-space, object-space, inverse object-space and 
+	//	bind-to-current (skinning) transforms
+	a3_HierarchyTransform localSpace[1];
+	a3_HierarchyTransform objectSpace[1];
+	a3_HierarchyTransform objectSpaceInverse[1];
+	a3_HierarchyTransform objectSpaceBindToCurrent[1];
+
+	// dirty tracking, one bit per node and 32 nodes per word: 'localDirty' 
+	//	marks nodes whose working local pose or local-space transform 
+	//	changed since the last FK solve (set by whatever writes them), 
+	//	'objectDirty' marks nodes whose object-space transform was solved 
+	//	since the last skinning palette update
+	a3ui32 *localDirty, *objectDirty;
+	a3ui32 dirtyWordCount;
+
+	// recompute counters
+	a3_HierarchyStateCounter *counter;
+
+	// storage for all of the above
+	void *data;
 };
 	
 
@@ -94,6 +165,22 @@ a3i32 a3hierarchyPoseGroupGetPoseOffsetIndex(const a3_HierarchyPoseGroup *poseGr
 // get offset to single node pose in contiguous set
 a3i32 a3hierarchyPoseGroupGetNodePoseOffsetIndex(const a3_HierarchyPoseGroup *poseGroup, const a3ui32 poseIndex, const a3ui32 nodeIndex);
 
+// copy single node pose out of channel streams
+a3i32 a3hierarchyPoseGetNode(a3_SpatialPose *spatialPose_out, const a3_HierarchyPose *pose, const a3ui32 nodeIndex);
+
+// copy single node pose into channel streams
+a3i32 a3hierarchyPoseSetNode(const a3_HierarchyPose *pose, const a3ui32 nodeIndex, const a3_SpatialPose *spatialPose);
+
+// convert channel streams to transforms for a range of nodes
+a3i32 a3hierarchyPoseConvert(const a3_HierarchyTransform *transform_out, const a3_HierarchyPose *pose, const a3ui32 nodeCount);
+
+// load HTR file, creating the hierarchy and a pose group in one pass; 
+//	pose 0 is the base pose and pose k+1 holds frame k composed with it
+//	(hierarchy and pose group must be unused); translations are converted 
+//	to meters using the file's ScaleFactor and CalibrationUnits; returns 
+//	pose count
+a3i32 a3hierarchyPoseGroupLoadHTR(a3_HierarchyPoseGroup *poseGroup_out, a3_Hierarchy *hierarchy_out, const a3byte *resourceFilePath);
+
 
 //-----------------------------------------------------------------------------
 
@@ -103,12 +190,45 @@ a3i32 a3hierarchyStateCreate(a3_HierarchyState *state_out, const a3_HierarchyPos
 // release hierarchy state
 a3i32 a3hierarchyStateRelease(a3_HierarchyState *state);
 
-// update inverse object-space matrices
-a3i32 a3hierarchyStateUpdateObjectInverse(const a3_HierarchyState *state, const a3boolean usingScale);
+// update local-space matrices from working local pose; marks all nodes 
+//	dirty so that a following FK solve sees the change
+a3i32 a3hierarchyStateUpdateLocalSpace(const a3_HierarchyState *state);
 
-// update bind-to-current given bind-pose object-space transforms
+// mark a range of nodes dirty after writing their working local pose or 
+//	local-space transforms directly (tracked blend programs mark the nodes 
+//	they change themselves); descendants follow in the FK solve
+a3i32 a3hierarchyStateSetDirty(const a3_HierarchyState *state, const a3ui32 firstIndex, const a3ui32 nodeCount);
+
+// dirty local-space update: converts only nodes marked dirty, leaving 
+//	the marks for FK; returns number of nodes converted
+a3i32 a3hierarchyStateUpdateLocalSpaceDirty(const a3_HierarchyState *state);
+
+// read recompute counters, optionally resetting them
+a3i32 a3hierarchyStateGetCounter(a3_HierarchyStateCounter *counter_out, const a3_HierarchyState *state, const a3boolean reset);
+
+// update inverse object-space matrices of all nodes, e.g. once for a 
+//	state holding the bind pose to get the inverse bind pose; ignores and 
+//	keeps the object dirty bits; returns node count
+a3i32 a3hierarchyStateUpdateObjectInverse(const a3_HierarchyState *state, const a3_HierarchyScaleMode scaleMode);
+
+// skinning palette: object-space transforms must be affine (as built by 
+//	FK from spatial poses); palette updates only visit nodes marked in the 
+//	object dirty bits (all nodes after creation) and clear them, so an 
+//	idle state costs a scan of the bits; after changing the inverse bind 
+//	pose, mark all nodes dirty and solve again; returns number of nodes 
+//	updated
+
+// update bind-to-current (object-space * inverse bind); the result is 
+//	the state's contiguous, 16-byte aligned palette
 a3i32 a3hierarchyStateUpdateObjectBindToCurrent(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse);
 
+// update bind-to-current, also writing a 3x4 palette: three vectors per 
+//	node holding the top three rows (basis and translation in x, y, z, w), 
+//	so a vertex transforms by one dot product per row; a quarter smaller 
+//	to upload (buffer should be 16-byte aligned, three per node, and the 
+//	same buffer every call, since unchanged nodes are not rewritten)
+a3i32 a3hierarchyStateUpdateObjectBindToCurrent3x4(const a3_HierarchyState *state, const a3_HierarchyTransform *objectSpaceBindInverse, a3vec4 *palette3x4_out);
+
 
 //-----------------------------------------------------------------------------
 
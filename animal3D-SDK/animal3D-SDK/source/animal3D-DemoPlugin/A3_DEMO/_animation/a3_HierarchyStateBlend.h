@@ -27,6 +27,7 @@
 
 
 #include "a3_HierarchyState.h"
+#include "a3_KeyframeAnimationController.h"
 
 
 //-----------------------------------------------------------------------------
@@ -35,12 +36,324 @@
 extern "C"
 {
 #else	// !__cplusplus
-
+typedef enum a3_HierarchyBlendNodeType		a3_HierarchyBlendNodeType;
+typedef enum a3_HierarchyBlendOpCode		a3_HierarchyBlendOpCode;
+typedef struct a3_HierarchyPoseMask		a3_HierarchyPoseMask;
+typedef struct a3_HierarchyBlendNode		a3_HierarchyBlendNode;
+typedef struct a3_HierarchyBlendOp			a3_HierarchyBlendOp;
+typedef struct a3_HierarchyBlendSampleKey	a3_HierarchyBlendSampleKey;
+typedef struct a3_HierarchySampleCache		a3_HierarchySampleCache;
+typedef struct a3_HierarchyBlendProgram		a3_HierarchyBlendProgram;
 #endif	// __cplusplus
 	
 
 //-----------------------------------------------------------------------------
 
+// per-node blend weights for partial blends (e.g. upper-body layers), 
+//	with bitsets marking nodes of nonzero and of full weight so that 
+//	masked operations visit only the nodes they change
+struct a3_HierarchyPoseMask
+{
+	// weight of each node in [0, 1]
+	a3real *weight;
+
+	// one bit per node, 32 nodes per word: weight above zero, and weight 
+	//	of one (a subset of the first)
+	a3ui32 *nonzero, *full;
+
+	// number of nodes, words per bitset, and nodes with nonzero and with 
+	//	full weight
+	a3ui32 nodeCount, wordCount;
+	a3ui32 nonzeroCount, fullCount;
+
+	// storage for all of the above
+	void *data;
+};
+
+
+// blend graph node types
+enum a3_HierarchyBlendNodeType
+{
+	a3blendNode_pose,		// fixed pose from the pose group
+	a3blendNode_sample,		// pose sampled by a clip controller
+	a3blendNode_lerp,		// blend from input 0 to input 1
+	a3blendNode_add,		// input 1 is a delta pose added onto input 0, 
+							//	weighted per node if a mask is given
+	a3blendNode_layer,		// input 1 blended over input 0, weighted per node
+};
+
+
+// compiled operation codes
+enum a3_HierarchyBlendOpCode
+{
+	a3blendOp_copy,
+	a3blendOp_sample,
+	a3blendOp_lerp,
+	a3blendOp_add,
+	a3blendOp_layer,
+};
+
+
+// blend graph node; a graph is an array of these with one root, and 
+//	nodes may share inputs
+struct a3_HierarchyBlendNode
+{
+	a3_HierarchyBlendNodeType type;
+
+	// indices of input nodes in graph, for blend nodes
+	a3ui32 input[2];
+
+	// pose index in group (pose) or clip controller index (sample)
+	a3ui32 source;
+
+	// blend weight: index of a parameter read at evaluation, or -1 to 
+	//	use the constant weight
+	a3i32 param;
+	a3real weight;
+
+	// per-node weights (required for layer, optional for add); must have 
+	//	one weight per hierarchy node and not change once compiled
+	const a3_HierarchyPoseMask *mask;
+};
+
+
+// compiled operation: reads input slots and writes its output slot
+struct a3_HierarchyBlendOp
+{
+	a3_HierarchyBlendOpCode code;
+
+	// slot indices
+	a3ui32 out, in[2];
+
+	// clip controller index (sample)
+	a3ui32 source;
+
+	// weight, as in graph node
+	a3i32 param;
+	a3real weight;
+	const a3_HierarchyPoseMask *mask;
+};
+
+
+// position a sample is taken at: clip and keyframe in pool, and 
+//	normalized time in keyframe; recorded by tracked evaluation to detect 
+//	change, and the key of sample cache entries
+struct a3_HierarchyBlendSampleKey
+{
+	const a3_ClipPool *clipPool;
+	a3ui32 clip, keyframe;
+	a3real keyframeParam;
+};
+
+
+// shared sample cache: controllers at the same position in the same clip 
+//	(within the tolerance) share one sampled pose, so sampling cost scales 
+//	with distinct clip/time pairs rather than instances; cleared every 
+//	frame, filled on demand; entries always hold all channels, so any 
+//	channel mask can be served from them
+//	not synchronized: fill from one thread, or guard externally
+struct a3_HierarchySampleCache
+{
+	// pose group samples come from
+	const a3_HierarchyPoseGroup *poseGroup;
+
+	// time quantization step: controllers snap to the nearest multiple of 
+	//	it within their clip before sampling; zero shares only identical 
+	//	positions and samples exactly
+	a3real tolerance;
+
+	// key and pose of each entry
+	a3_HierarchyBlendSampleKey *key;
+	a3_HierarchyPose *pose;
+
+	// open-addressed table of entry indices, -1 if empty, and bucket count 
+	//	(power of two, at least twice the capacity) minus one
+	a3i32 *bucket;
+	a3ui32 bucketMask;
+
+	// entries used this frame and maximum
+	a3ui32 count, capacity;
+
+	// lookups served from an entry and lookups that sampled, accumulated 
+	//	until zeroed by the caller
+	a3ui32 hitCount, missCount;
+
+	// storage for all of the above
+	void *data;
+};
+
+
+// blend graph compiled to a flat stream of operations
+//	compiling folds away blends whose constant weight selects one input 
+//	(the other subtree is dropped), evaluates subtrees with only fixed 
+//	poses and constant weights once into constant slots, and packs the 
+//	remaining intermediate results into as few scratch slots as possible
+//	evaluation runs the ops in order with no recursion or allocation
+//	tracked programs give every op its own slot instead, so each op keeps 
+//	its last result and tracked evaluation recomputes only the nodes that 
+//	change (one pose of memory per op)
+struct a3_HierarchyBlendProgram
+{
+	// pose group supplying fixed and sampled poses
+	const a3_HierarchyPoseGroup *poseGroup;
+
+	// operations, in execution order
+	a3_HierarchyBlendOp *op;
+
+	// pose slots: slot 0 is the caller's output pose, then scratch and 
+	//	constant slots in the arena, then fixed poses in the group
+	a3_HierarchyPose *slot;
+
+	// number of ops, slots and slots backed by the arena
+	a3ui32 opCount, slotCount, arenaCount;
+
+	// number of parameters and clip controllers evaluation reads
+	a3ui32 paramCount, controllerCount;
+
+	// tracking (tracked programs only): nodes each slot changed in the 
+	//	last tracked evaluation, one bit per node and 'wordCount' words per 
+	//	slot; the output pose, parameters and controller states it read 
+	//	(output pose null if anything else evaluated since)
+	a3ui32 *slotDirty, wordCount;
+	a3_HierarchyPose outputLast[1];
+	a3real *paramLast;
+	a3_HierarchyBlendSampleKey *sampleLast;
+	a3boolean isTracked;
+
+	// optional cache sample ops read through (null to sample directly); 
+	//	set by the caller, must use the program's pose group
+	a3_HierarchySampleCache *sampleCache;
+
+	// storage for all of the above, including the arena
+	void *data;
+};
+
+
+//-----------------------------------------------------------------------------
+// whole-pose blend operations
+//	each runs over the channel streams of the first 'nodeCount' nodes of 
+//	the poses given and writes to the caller's output pose, which may be 
+//	the same as any input; nothing is allocated
+//	translation and scale are blended linearly; rotations are aligned to 
+//	the first input's hemisphere before blending, so the shortest path is 
+//	always taken
+//	'concat' and 'invert' work channel by channel (rotations multiply, 
+//	translations add, scales multiply), which makes the pair usable for 
+//	additive poses: delta = concat(invert(reference), pose)
+//	all return node count on success, -1 on invalid input
+
+// copy pose
+a3i32 a3hierarchyPoseCopy(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3ui32 nodeCount);
+
+// reset pose to identity
+a3i32 a3hierarchyPoseReset(const a3_HierarchyPose *pose_out, const a3ui32 nodeCount);
+
+// linear blend; rotations are not renormalized, cheapest when the result 
+//	is normalized by a later operation or poses are close together
+a3i32 a3hierarchyPoseLerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount);
+
+// linear blend with normalized rotations
+a3i32 a3hierarchyPoseNlerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount);
+
+// linear blend with spherical rotation interpolation
+a3i32 a3hierarchyPoseSlerp(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3real u, const a3ui32 nodeCount);
+
+// additive blend: concatenate a delta pose scaled by u onto a base pose
+a3i32 a3hierarchyPoseAdd(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_base, const a3_HierarchyPose *pose_delta, const a3real u, const a3ui32 nodeCount);
+
+// scale pose: blend from identity to pose by u
+a3i32 a3hierarchyPoseScale(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3real u, const a3ui32 nodeCount);
+
+// invert pose channel by channel
+a3i32 a3hierarchyPoseInvert(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_in, const a3ui32 nodeCount);
+
+// concatenate poses channel by channel: left applied after right
+a3i32 a3hierarchyPoseConcat(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_lh, const a3_HierarchyPose *pose_rh, const a3ui32 nodeCount);
+
+// triangular blend: pose0 weighted (1 - u1 - u2), pose1 by u1, pose2 by u2; 
+//	rotations are normalized
+a3i32 a3hierarchyPoseTriangular(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3_HierarchyPose *pose2, const a3real u1, const a3real u2, const a3ui32 nodeCount);
+
+// bilinear blend: blend pose00 to pose01 and pose10 to pose11 by u0, then 
+//	the results by u1; rotations use spherical interpolation
+a3i32 a3hierarchyPoseBilinear(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose00, const a3_HierarchyPose *pose01, const a3_HierarchyPose *pose10, const a3_HierarchyPose *pose11, const a3real u0, const a3real u1, const a3ui32 nodeCount);
+
+
+// allocate mask for a number of nodes, all weights zero
+a3i32 a3hierarchyPoseMaskCreate(a3_HierarchyPoseMask *mask_out, const a3ui32 nodeCount);
+
+// release mask
+a3i32 a3hierarchyPoseMaskRelease(a3_HierarchyPoseMask *mask);
+
+// set weight of a node and all of its descendants (update mask after)
+a3i32 a3hierarchyPoseMaskSetBranch(a3_HierarchyPoseMask *mask, const a3_Hierarchy *hierarchy, const a3ui32 nodeIndex, const a3real weight);
+
+// clamp weights and rebuild bitsets after weights change; returns number 
+//	of nodes with nonzero weight
+a3i32 a3hierarchyPoseMaskUpdate(a3_HierarchyPoseMask *mask);
+
+// masked linear blend with normalized rotations: each node blends from 
+//	pose0 to pose1 by u (clamped to [0, 1]) times its mask weight; nodes of full weight (if u 
+//	is one) copy pose1, nodes of zero weight copy pose0, or are not touched 
+//	at all if the output is pose0; returns number of nodes written
+a3i32 a3hierarchyPoseLerpMasked(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose0, const a3_HierarchyPose *pose1, const a3_HierarchyPoseMask *mask, const a3real u);
+
+// masked additive blend, as above: delta scaled by u times mask weight 
+//	is added to base; returns number of nodes written
+a3i32 a3hierarchyPoseAddMasked(const a3_HierarchyPose *pose_out, const a3_HierarchyPose *pose_base, const a3_HierarchyPose *pose_delta, const a3_HierarchyPoseMask *mask, const a3real u);
+
+
+//-----------------------------------------------------------------------------
+
+// compile blend graph (program must be unused), tracked or not; returns 
+//	op count
+a3i32 a3hierarchyBlendProgramCompile(a3_HierarchyBlendProgram *program_out, const a3_HierarchyPoseGroup *poseGroup, const a3_HierarchyBlendNode *node, const a3ui32 nodeCount, const a3ui32 rootIndex, const a3boolean tracked);
+
+// release program
+a3i32 a3hierarchyBlendProgramRelease(a3_HierarchyBlendProgram *program);
+
+// evaluate program into output pose; parameter and controller arrays must 
+//	hold at least as many entries as the program reads
+a3i32 a3hierarchyBlendProgramEvaluate(a3_HierarchyBlendProgram *program, const a3_HierarchyPose *pose_out, const a3real *param, const a3ui32 paramCount, const a3_ClipController *controller, const a3ui32 controllerCount);
+
+// tracked evaluation (tracked programs only): as above, but each op works 
+//	out which nodes of its result change and recomputes only those: a 
+//	sample changes all nodes if its controller moved (unless it only moved 
+//	within a held keyframe), a blend changes the nodes its inputs changed, 
+//	or every node it weights if its weight changed, and a masked blend 
+//	ignores changes to its second input outside the mask; the output's 
+//	changed nodes are added to 'dirty_out' (one bit per node, e.g. the 
+//	local dirty bits of the hierarchy state whose local pose is the 
+//	output), for FK and skinning to follow; the output must not be 
+//	written by anything else in between (the first tracked evaluation, 
+//	and the first after an untracked one or with a different output, 
+//	changes every node); returns number of output nodes changed, zero if 
+//	nothing moved
+a3i32 a3hierarchyBlendProgramEvaluateChanged(a3_HierarchyBlendProgram *program, const a3_HierarchyPose *pose_out, a3ui32 *dirty_out, const a3real *param, const a3ui32 paramCount, const a3_ClipController *controller, const a3ui32 controllerCount);
+
+
+//-----------------------------------------------------------------------------
+
+// create sample cache with room for a number of distinct samples per 
+//	frame (cache must be unused)
+a3i32 a3hierarchySampleCacheCreate(a3_HierarchySampleCache *cache_out, const a3_HierarchyPoseGroup *poseGroup, const a3ui32 capacity, const a3real tolerance);
+
+// release sample cache
+a3i32 a3hierarchySampleCacheRelease(a3_HierarchySampleCache *cache);
+
+// empty the cache; call once per frame before sampling, and after 
+//	changing the tolerance (counters are kept)
+a3i32 a3hierarchySampleCacheClear(a3_HierarchySampleCache *cache);
+
+// get cached pose for a controller's position, sampling it on a miss; 
+//	the pose is valid until the cache is cleared and must not be written; 
+//	returns entry index, or -1 if invalid or the cache is full
+a3i32 a3hierarchySampleCacheGet(a3_HierarchySampleCache *cache, const a3_HierarchyPose **pose_out, const a3_ClipController *clipCtrl);
+
+// copy channels of the cached pose for a controller's position into a 
+//	pose (a3_SpatialPoseChannel flags), sampling on a miss, or directly 
+//	into the output if the cache is full; returns node count
+a3i32 a3hierarchySampleCacheSample(a3_HierarchySampleCache *cache, const a3_HierarchyPose *pose_out, const a3_ClipController *clipCtrl, const a3ui32 channels);
 
 
 //-----------------------------------------------------------------------------
@@ -38,8 +38,10 @@ extern "C"
 #else	// !__cplusplus
 typedef struct a3_Keyframe					a3_Keyframe;
 typedef struct a3_KeyframePool				a3_KeyframePool;
+typedef struct a3_ClipTransition			a3_ClipTransition;
 typedef struct a3_Clip						a3_Clip;
 typedef struct a3_ClipPool					a3_ClipPool;
+typedef struct a3_ClipHandle				a3_ClipHandle;
 #endif	// __cplusplus
 
 
@@ -58,6 +60,16 @@ struct a3_Keyframe
 {
 	// index in keyframe pool
 	a3ui32 index;
+
+	// interval of time for which this keyframe is active; cannot be zero
+	a3real duration, durationInv;
+
+	// start time: sum of durations of the keyframes before this one in the 
+	//	pool, so clip-relative start is the difference from the clip's first
+	a3real time;
+
+	// value of the sample described by a keyframe (e.g. pose index)
+	a3ui32 data;
 };
 
 // pool of keyframe descriptors
@@ -68,6 +80,15 @@ struct a3_KeyframePool
 
 	// number of keyframes
 	a3ui32 count;
+
+	// incremented whenever recalculating start times finds that a 
+	//	duration changed; clips compare it against their own copy before 
+	//	trusting their cached keyframe rate
+	a3ui32 revision;
+
+	// end of the last keyframe, so that editing only the last duration 
+	//	is noticed too
+	a3real duration;
 };
 
 
@@ -77,12 +98,58 @@ a3i32 a3keyframePoolCreate(a3_KeyframePool* keyframePool_out, const a3ui32 count
 // release keyframe pool
 a3i32 a3keyframePoolRelease(a3_KeyframePool* keyframePool);
 
-// initialize keyframe
+// initialize keyframe; when editing keyframes already used by clips, 
+//	recalculate start times afterwards (a3keyframePoolCalculateTime or 
+//	a3clipCalculateDuration) so lookups see the new durations
 a3i32 a3keyframeInit(a3_Keyframe* keyframe_out, const a3real duration, const a3ui32 value_x);
 
+// recalculate keyframe start times from an index to the end of the pool; 
+//	if any duration changed, bumps the pool's revision, so clips whose 
+//	keyframe rate was cached from older durations fall back to searching 
+//	until recalculated (a3clipPoolCalculateRate after batch edits)
+a3i32 a3keyframePoolCalculateTime(a3_KeyframePool* keyframePool, const a3ui32 firstIndex);
+
 
 //-----------------------------------------------------------------------------
 
+// transition command flags, as in the clip set file: '>' forward, '<' 
+//	reverse, doubled to skip the first or last keyframe, '|' to pause
+enum a3_ClipTransitionFlag
+{
+	a3clipTransition_forward = 0x01,
+	a3clipTransition_reverse = 0x02,
+	a3clipTransition_skip = 0x04,
+	a3clipTransition_pause = 0x08,
+};
+
+
+// compiled clip terminus action: where a controller goes when it passes 
+//	the end (forward) or start (reverse) of a clip
+//	positions depend on the target's keyframe durations: a clip refreshes 
+//	transitions that target itself when its duration changes, others 
+//	must be compiled again
+struct a3_ClipTransition
+{
+	// index of clip to continue with in clip pool
+	a3ui32 clip;
+
+	// keyframe to start from in keyframe pool, time into that keyframe and 
+	//	the same position as time since clip start
+	a3ui32 keyframe;
+	a3real keyframeTime, clipTime;
+
+	// direction to play afterwards: +1 forward, -1 reverse; when paused, 
+	//	the direction the controller is ready to play in
+	a3real playback;
+
+	// stop at the start position instead of playing
+	a3boolean pause;
+
+	// command flags this was compiled from
+	a3ui32 flags;
+};
+
+
 // description of single clip
 // metaphor: timeline
 struct a3_Clip
@@ -92,9 +159,36 @@ struct a3_Clip
 
 	// index in clip pool
 	a3ui32 index;
+
+	// duration of clip; sum of keyframe durations
+	a3real duration, durationInv;
+
+	// set if all keyframes in the clip have the same duration (e.g. data 
+	//	sampled at a fixed frame rate), stored here with its inverse, the 
+	//	keyframe rate; time lookups then index directly instead of searching
+	//	but only while the keyframe pool's revision still matches the one 
+	//	they were cached at, since clips may share keyframes
+	a3boolean isUniform;
+	a3real keyframeDuration, keyframeDurationInv;
+	a3ui32 keyframeRevision;
+
+	// number of keyframes referenced by clip (including first and final)
+	a3ui32 keyframeCount;
+
+	// index of first and final keyframe in pool
+	a3ui32 keyframeIndex_first, keyframeIndex_final;
+
+	// pool of keyframes containing those included in the set; not const 
+	//	because redistributing the clip's duration edits its keyframes
+	a3_KeyframePool* keyframePool;
+
+	// actions at end and start of clip (default: loop in same direction)
+	a3_ClipTransition transitionForward, transitionReverse;
 };
 
 // group of clips
+//	name table: chained hash of clip names, as in the hierarchy; unnamed 
+//	clips are not indexed
 struct a3_ClipPool
 {
 	// array of clips
@@ -102,6 +196,25 @@ struct a3_ClipPool
 
 	// number of clips
 	a3ui32 count;
+
+	// hash of each clip's name, next clip index in the same bucket or -1, 
+	//	first clip index in each bucket or -1, and bucket count (power of 
+	//	two) minus one
+	a3ui32* nameHash;
+	a3i32* nameNext;
+	a3i32* nameBucket;
+	a3ui32 nameBucketMask;
+};
+
+
+// cacheable reference to a clip by name: resolving it checks the clip at 
+//	the stored index against the stored hash and name, falling back to a 
+//	hashed lookup by name if the pool changed
+struct a3_ClipHandle
+{
+	a3byte name[a3keyframeAnimation_nameLenMax];
+	a3ui32 nameHash;
+	a3i32 index;
 };
 
 
@@ -111,18 +224,64 @@ a3i32 a3clipPoolCreate(a3_ClipPool* clipPool_out, const a3ui32 count);
 // release clip pool
 a3i32 a3clipPoolRelease(a3_ClipPool* clipPool);
 
-// initialize clip with first and last indices
-a3i32 a3clipInit(a3_Clip* clip_out, const a3byte clipName[a3keyframeAnimation_nameLenMax], const a3_KeyframePool* keyframePool, const a3ui32 firstKeyframeIndex, const a3ui32 finalKeyframeIndex);
+// initialize clip in pool with first and last indices; the pool's name 
+//	table is updated with the new name
+a3i32 a3clipInit(a3_ClipPool* clipPool, const a3ui32 clipIndex, const a3byte clipName[a3keyframeAnimation_nameLenMax], a3_KeyframePool* keyframePool, const a3ui32 firstKeyframeIndex, const a3ui32 finalKeyframeIndex);
+
+// load clip set file into pools, one run of keyframes per clip with 
+//	keyframe data set to the frame index (runs listed last-to-first are 
+//	stored in reverse), durations distributed over each clip and 
+//	transitions compiled; returns clip count
+a3i32 a3clipPoolLoad(a3_ClipPool* clipPool_out, a3_KeyframePool* keyframePool_out, const a3byte* resourceFilePath);
+
+// detect uniform keyframe spacing of every clip in pool against current 
+//	keyframe durations; to call after initializing or editing many clips 
+//	sharing a keyframe pool, since each edit stales the cached rate of the 
+//	clips before it; returns number of clips with direct lookup
+a3i32 a3clipPoolCalculateRate(a3_ClipPool* clipPool);
+
+// compile transition to a target clip from command flags
+a3i32 a3clipTransitionInit(a3_ClipTransition* transition_out, const a3_Clip* clip, const a3ui32 flags);
 
 // get clip index from pool
 a3i32 a3clipGetIndexInPool(const a3_ClipPool* clipPool, const a3byte clipName[a3keyframeAnimation_nameLenMax]);
 
-// calculate clip duration as sum of keyframes' durations
+// hash clip name for lookups and handles (same hash as hierarchy names)
+a3ui32 a3clipHashName(const a3byte clipName[a3keyframeAnimation_nameLenMax]);
+
+// get clip index from pool by name hash; name is optional and only needed 
+//	to tell apart different names with the same hash
+a3i32 a3clipGetIndexInPoolByHash(const a3_ClipPool* clipPool, const a3ui32 nameHash, const a3byte clipName_opt[a3keyframeAnimation_nameLenMax]);
+
+// make handle for clip name; returns clip index (handle is still made if 
+//	the name is not in the pool yet)
+a3i32 a3clipPoolGetHandle(a3_ClipHandle* handle_out, const a3_ClipPool* clipPool, const a3byte clipName[a3keyframeAnimation_nameLenMax]);
+
+// get clip index from handle, updating the handle's index if it moved
+a3i32 a3clipPoolResolveHandle(const a3_ClipPool* clipPool, a3_ClipHandle* handle);
+
+// calculate clip duration as sum of keyframes' durations; also refreshes 
+//	keyframe start times and detects uniform keyframe spacing
 a3i32 a3clipCalculateDuration(a3_Clip* clip);
 
-// calculate keyframes' durations by distributing clip's duration
+// detect uniform keyframe spacing and cache the keyframe rate, without 
+//	touching start times
+a3i32 a3clipCalculateRate(a3_Clip* clip);
+
+// check whether time lookups in clip index directly instead of searching: 
+//	uniform spacing, cached at the pool's current revision
+a3boolean a3clipIsDirectLookup(const a3_Clip* clip);
+
+// calculate keyframes' durations by distributing clip's duration; also 
+//	refreshes keyframe start times
 a3i32 a3clipDistributeDuration(a3_Clip* clip, const a3real newClipDuration);
 
+// get pool index of keyframe active at a time since clip start, clamped 
+//	to the clip: computed from time and keyframe rate for uniform clips, 
+//	otherwise by binary search over keyframe start times; optionally 
+//	outputs time since keyframe start
+a3i32 a3clipGetKeyframeIndex(const a3_Clip* clip, const a3real clipTime, a3real* keyframeTime_out_opt);
+
 
 //-----------------------------------------------------------------------------
 
@@ -37,16 +37,78 @@ extern "C"
 {
 #else	// !__cplusplus
 typedef struct a3_ClipController			a3_ClipController;
+typedef struct a3_ClipControllerBatch		a3_ClipControllerBatch;
 #endif	// __cplusplus
 
 
 //-----------------------------------------------------------------------------
 
+// constant values
+enum
+{
+	// most transitions followed in one update before stopping at a terminus
+	a3clipCtrl_transitionMax = 64,
+};
+
+
 // clip controller
 // metaphor: playhead
 struct a3_ClipController
 {
 	a3byte name[a3keyframeAnimation_nameLenMax];
+
+	// index of clip in pool and of current keyframe in keyframe pool
+	a3ui32 clip, keyframe;
+
+	// time since start of clip and of current keyframe, and the same 
+	//	normalized by their durations
+	a3real clipTime, clipParam;
+	a3real keyframeTime, keyframeParam;
+
+	// playback rate and direction: positive forward, negative reverse, 
+	//	zero paused
+	a3real playback;
+
+	// pool of clips being controlled
+	const a3_ClipPool* clipPool;
+};
+
+
+// many clip controllers as parallel arrays, advanced together
+//	the vector pass only moves time and refreshes parameters; controllers 
+//	that leave their current keyframe are listed in 'pending' and fixed up 
+//	by a scalar pass, which follows clip transitions and lists controllers 
+//	that passed a clip terminus in 'terminus' (with the direction they 
+//	had before it in 'terminusPlayback')
+//	arrays are 16-byte aligned and padded to a multiple of four; padding 
+//	entries never move
+struct a3_ClipControllerBatch
+{
+	// pool of clips being controlled
+	const a3_ClipPool* clipPool;
+
+	// number of controllers and padded array length
+	a3ui32 count, capacity;
+
+	// per-controller state, as in a3_ClipController
+	a3real *clipTime, *clipParam;
+	a3real *keyframeTime, *keyframeParam;
+	a3real *playback;
+	a3ui32 *clip, *keyframe;
+
+	// durations of current clip and keyframe, cached so the vector pass 
+	//	does not gather from the pools
+	a3real *clipDurationInv;
+	a3real *keyframeDuration, *keyframeDurationInv;
+
+	// controllers waiting for the scalar pass, and the clip end events 
+	//	it produced during the last update
+	a3ui32 *pending, pendingCount;
+	a3ui32 *terminus, terminusCount;
+	a3real *terminusPlayback;
+
+	// storage for all of the above
+	void *data;
 };
 
 
@@ -62,6 +124,32 @@ a3i32 a3clipControllerUpdate(a3_ClipController* clipCtrl, const a3real dt);
 a3i32 a3clipControllerSetClip(a3_ClipController* clipCtrl, const a3_ClipPool* clipPool, const a3ui32 clipIndex_pool);
 
 
+// allocate controller batch; all controllers start on the given clip, paused
+a3i32 a3clipControllerBatchCreate(a3_ClipControllerBatch* batch_out, const a3_ClipPool* clipPool, const a3ui32 count, const a3ui32 clipIndex_pool);
+
+// release controller batch
+a3i32 a3clipControllerBatchRelease(a3_ClipControllerBatch* batch);
+
+// set clip for one controller in batch, starting at its first keyframe if 
+//	playing forward or paused, at its final keyframe if reversed
+a3i32 a3clipControllerBatchSetClip(a3_ClipControllerBatch* batch, const a3ui32 ctrlIndex, const a3ui32 clipIndex_pool);
+
+// set playback rate and direction for one controller in batch; takes 
+//	effect from the next advance; returns controller index
+a3i32 a3clipControllerBatchSetPlayback(a3_ClipControllerBatch* batch, const a3ui32 ctrlIndex, const a3real playback);
+
+// vector pass: advance all controllers and collect the ones that left 
+//	their keyframe; returns pending count
+a3i32 a3clipControllerBatchAdvance(a3_ClipControllerBatch* batch, const a3real dt);
+
+// scalar pass: move pending controllers to their new keyframes, taking 
+//	clip transitions and recording terminus events; returns terminus count
+a3i32 a3clipControllerBatchResolve(a3_ClipControllerBatch* batch);
+
+// update batch: advance then resolve; returns terminus count
+a3i32 a3clipControllerBatchUpdate(a3_ClipControllerBatch* batch, const a3real dt);
+
+
 //-----------------------------------------------------------------------------
 
 
@@ -48,12 +48,56 @@ extern "C"
 //		else
 //			object-space node = local-space node
 
+// forward kinematics solvers recompute only nodes marked in the state's 
+//	local dirty bits and their descendants, then move the marks to the 
+//	object dirty bits for the skinning palette; a state whose local pose 
+//	did not change costs a scan of the bits; whatever writes the local 
+//	pose or local-space transforms marks the nodes it changes (tracked 
+//	blend programs, a3hierarchyStateUpdateLocalSpace, or 
+//	a3hierarchyStateSetDirty); all return number of nodes recomputed
+
 // forward kinematics solver given an initialized hierarchy state
 a3i32 a3kinematicsSolveForward(const a3_HierarchyState *hierarchyState);
 
-// forward kinematics solver starting at a specified joint
+// forward kinematics solver for a range of nodes; nodes whose parent lies 
+//	before the range also follow it if the parent was solved since the 
+//	last skinning palette update
 a3i32 a3kinematicsSolveForwardPartial(const a3_HierarchyState *hierarchyState, const a3ui32 firstIndex, const a3ui32 nodeCount);
 
+// forward kinematics solver for purely affine local transforms (bottom row 
+//	is 0, 0, 0, 1, which holds for any transform built from a spatial pose); 
+//	skips the projective row of every product
+a3i32 a3kinematicsSolveForwardAffine(const a3_HierarchyState *hierarchyState);
+
+// affine forward kinematics solver for a range of nodes
+a3i32 a3kinematicsSolveForwardPartialAffine(const a3_HierarchyState *hierarchyState, const a3ui32 firstIndex, const a3ui32 nodeCount);
+
+// forward kinematics solver for one node and all of its descendants, 
+//	marked or not; uses the contiguous subtree span if the hierarchy has 
+//	one, otherwise solves everything from the node onward
+a3i32 a3kinematicsSolveForwardSubtree(const a3_HierarchyState *hierarchyState, const a3ui32 nodeIndex);
+
+// forward kinematics solver walking the hierarchy's depth levels; solves 
+//	every node; returns -1 and leaves the state untouched if levels were 
+//	never built
+a3i32 a3kinematicsSolveForwardByLevel(const a3_HierarchyState *hierarchyState);
+
+// forward kinematics solver for a slice of one depth level; nodes in a 
+//	level are independent, so workers may each solve a slice as long as 
+//	all previous levels are complete; slices solve every node they cover 
+//	and leave the dirty bits alone (workers would share words); -1 if 
+//	levels were never built
+a3i32 a3kinematicsSolveForwardLevel(const a3_HierarchyState *hierarchyState, const a3ui32 levelIndex, const a3ui32 firstInLevel, const a3ui32 nodeCount);
+
+// after all level slices are solved: clear the local dirty bits and mark 
+//	every node for the skinning palette (call from one thread)
+a3i32 a3kinematicsSolveForwardLevelsDone(const a3_HierarchyState *hierarchyState);
+
+// forward kinematics solver using plain scalar products (what builds 
+//	without SSE run); solves every node and leaves the dirty bits alone; 
+//	reference for checking and timing the vector solvers
+a3i32 a3kinematicsSolveForwardScalar(const a3_HierarchyState *hierarchyState, const a3boolean affine);
+
 
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,127 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_QuantizedTrack.h
+	Compressed per-clip pose tracks: smallest-three rotations and 
+		range-quantized translation and scale.
+*/
+
+#ifndef __ANIMAL3D_QUANTIZEDTRACK_H
+#define __ANIMAL3D_QUANTIZEDTRACK_H
+
+
+#include "a3_HierarchyState.h"
+#include "a3_KeyframeAnimation.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+typedef struct a3_QuantizedTrack			a3_QuantizedTrack;
+typedef struct a3_QuantizedTrackReport		a3_QuantizedTrackReport;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// compressed poses for the keyframes of one clip
+//	rotations: largest component dropped, other three in 15 bits each plus 
+//		a 2-bit index, packed into 48 bits (three 16-bit words) per node
+//	translation and scale: channels that change over the clip are stored 
+//		as 16-bit values in the channel's range for the clip; channels that 
+//		do not change store only their constant value
+struct a3_QuantizedTrack
+{
+	// number of nodes per key and keys in track
+	a3ui32 nodeCount, keyCount;
+
+	// number of nodes with animated translation and scale
+	a3ui32 translateCount, scaleCount;
+
+	// per-key data, key-major: nodeCount rotations, then animated channels
+	a3ui16 *rotate;
+	a3ui16 *translate;
+	a3ui16 *scale;
+
+	// node index of each animated channel
+	a3ui32 *translateNode;
+	a3ui32 *scaleNode;
+
+	// range of each animated channel: decoded = minimum + step * value
+	a3vec3 *translateMin, *translateStep;
+	a3vec3 *scaleMin, *scaleStep;
+
+	// constant value of every node's channels (animated ones overwritten)
+	a3vec3 *translateConstant;
+	a3vec3 *scaleConstant;
+
+	// storage for all of the above
+	void *data;
+};
+
+
+// measured error of a track against its source poses
+//	rotation error is in degrees, translation error is distance
+struct a3_QuantizedTrackReport
+{
+	a3real rotateErrorMax, rotateErrorMean;
+	a3real translateErrorMax, translateErrorMean;
+	a3real scaleErrorMax;
+
+	// memory used by the source poses and by the track, in bytes
+	a3ui32 sizeRaw, sizeQuantized;
+};
+
+
+//-----------------------------------------------------------------------------
+
+// compress the poses referenced by a clip's keyframes (keyframe data is 
+//	the pose index in the group); returns key count
+a3i32 a3quantizedTrackCreate(a3_QuantizedTrack *track_out, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip);
+
+// release track
+a3i32 a3quantizedTrackRelease(a3_QuantizedTrack *track);
+
+// decode one key into a pose
+a3i32 a3quantizedTrackDecode(const a3_HierarchyPose *pose_out, const a3_QuantizedTrack *track, const a3ui32 keyIndex);
+
+// decode two keys and interpolate between them in one pass; rotations 
+//	are normalized-lerped, translation and scale are lerped
+a3i32 a3quantizedTrackSample(const a3_HierarchyPose *pose_out, const a3_QuantizedTrack *track, const a3ui32 keyIndex0, const a3ui32 keyIndex1, const a3real param);
+
+// measure decoded keys against the source poses
+a3i32 a3quantizedTrackMeasureError(a3_QuantizedTrackReport *report_out, const a3_QuantizedTrack *track, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_QuantizedTrack.inl"
+
+
+#endif	// !__ANIMAL3D_QUANTIZEDTRACK_H
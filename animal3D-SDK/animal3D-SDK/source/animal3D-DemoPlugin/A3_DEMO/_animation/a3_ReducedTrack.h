@@ -0,0 +1,151 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_ReducedTrack.h
+	Error-bounded keyframe reduction: per-channel key tracks with 
+		non-uniform timing.
+*/
+
+#ifndef __ANIMAL3D_REDUCEDTRACK_H
+#define __ANIMAL3D_REDUCEDTRACK_H
+
+
+#include "a3_HierarchyState.h"
+#include "a3_KeyframeAnimation.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+typedef struct a3_ReducedTrack				a3_ReducedTrack;
+typedef struct a3_ReducedTrackTolerance		a3_ReducedTrackTolerance;
+typedef struct a3_ReducedTrackReport		a3_ReducedTrackReport;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// poses for the keyframes of one clip with redundant keys removed per 
+//	channel; each node's rotation, translation and scale channels keep 
+//	their own keys, which are placed at the source keyframe times
+//	keys of node j's rotation are [rotateOffset[j], rotateOffset[j + 1]), 
+//	same for the other channels; the first and final keys are always kept
+struct a3_ReducedTrack
+{
+	// number of nodes and source keys
+	a3ui32 nodeCount, keyCount;
+
+	// duration covered by the keys (time of final key)
+	a3real duration;
+
+	// first key of each node's channels, plus one past the end
+	a3ui32 *rotateOffset;
+	a3ui32 *translateOffset;
+	a3ui32 *scaleOffset;
+
+	// key times, searched on their own so a lookup touches few values
+	a3real *rotateTime;
+	a3real *translateTime;
+	a3real *scaleTime;
+
+	// key values
+	a3quat *rotate;
+	a3vec3 *translate;
+	a3vec3 *scale;
+
+	// storage for all of the above
+	void *data;
+};
+
+
+// how far the reduced track may stray from its source
+//	member rotate: joint rotation error in degrees
+//	member translate: joint translation error as distance
+//	member scale: joint scale error per component
+//	member effector: object-space position error of any node as distance, 
+//		split along each chain and scaled by the reach below each joint; 
+//		zero or less to bound joint error only
+struct a3_ReducedTrackTolerance
+{
+	a3real rotate;
+	a3real translate;
+	a3real scale;
+	a3real effector;
+};
+
+
+// result of reducing one clip
+//	key counts are channel keys (one per node per channel per key)
+//	rotation error is in degrees, translation and effector error are 
+//	distance; effector error is measured at leaf nodes in object space
+struct a3_ReducedTrackReport
+{
+	a3ui32 keyCountRaw, keyCountReduced;
+	a3ui32 rotateKeyCount, translateKeyCount, scaleKeyCount;
+
+	// raw over reduced key count
+	a3real ratio;
+
+	a3real rotateErrorMax, translateErrorMax, scaleErrorMax;
+	a3real effectorErrorMax;
+
+	// memory used by the source poses and by the track, in bytes
+	a3ui32 sizeRaw, sizeReduced;
+};
+
+
+//-----------------------------------------------------------------------------
+
+// reduce the poses referenced by a clip's keyframes (keyframe data is the 
+//	pose index in the group) within tolerance; key times are the running 
+//	sum of keyframe durations; fills optional report; returns reduced 
+//	channel key count
+a3i32 a3reducedTrackCreate(a3_ReducedTrack *track_out, a3_ReducedTrackReport *report_out_opt, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip, const a3_ReducedTrackTolerance *tolerance);
+
+// release track
+a3i32 a3reducedTrackRelease(a3_ReducedTrack *track);
+
+// sample all channels at a time in [0, duration] (clamped); each channel 
+//	binary-searches its own keys, then rotations are normalized-lerped and 
+//	translation and scale are lerped
+a3i32 a3reducedTrackSample(const a3_HierarchyPose *pose_out, const a3_ReducedTrack *track, const a3real time);
+
+// measure the track against its source poses at every source key time
+a3i32 a3reducedTrackMeasureError(a3_ReducedTrackReport *report_out, const a3_ReducedTrack *track, const a3_HierarchyPoseGroup *poseGroup, const a3_Clip *clip);
+
+// get the key pair and interpolation parameter for a time in one channel
+a3i32 a3reducedTrackFindKey(a3ui32 *keyIndex0_out, a3real *param_out, const a3real *keyTime, const a3ui32 keyCount, const a3real time);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_ReducedTrack.inl"
+
+
+#endif	// !__ANIMAL3D_REDUCEDTRACK_H
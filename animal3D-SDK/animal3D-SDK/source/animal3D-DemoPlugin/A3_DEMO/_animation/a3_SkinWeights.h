@@ -0,0 +1,122 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_SkinWeights.h
+	Per-point skin weights from Maya deformer XML, with binary cache.
+*/
+
+#ifndef __ANIMAL3D_SKINWEIGHTS_H
+#define __ANIMAL3D_SKINWEIGHTS_H
+
+
+#include "a3_Skinning.h"
+#include "a3_AnimationCache.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+typedef struct a3_SkinWeights				a3_SkinWeights;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// constant values
+enum
+{
+	// cache format version; bump whenever the file layout changes
+	a3skinWeights_version = 1,
+
+	// weight that stands for one after quantization
+	a3skinWeights_weightOne = 0xffff,
+
+	// most hierarchy nodes addressable by 8-bit indices
+	a3skinWeights_nodeMax = 256,
+};
+
+
+// compact skin weights for each point of a shape: a3skinning_influenceMax 
+//	influences per point, heaviest first, as unsigned normalized 16-bit 
+//	weights summing to exactly a3skinWeights_weightOne, and 8-bit node 
+//	indices into the hierarchy the weights were bound to; unused slots 
+//	have zero weight and index zero
+struct a3_SkinWeights
+{
+	a3ui16 *weight;
+	a3ubyte *index;
+	a3ui32 pointCount;
+
+	// node count of the bound hierarchy
+	a3ui32 nodeCount;
+
+	// storage for all of the above
+	void *data;
+};
+
+
+//-----------------------------------------------------------------------------
+
+// load weights from a Maya deformerWeight XML file in one streaming pass: 
+//	the first shape element gives the point count, each weights element 
+//	is bound to the hierarchy node named by its source attribute (unknown 
+//	names are skipped with a warning), and only the heaviest influences 
+//	of each point are kept and renormalized; returns point count
+a3i32 a3skinWeightsLoadXML(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *resourceFilePath);
+
+// save weights to a binary cache tagged with the hierarchy's node names, 
+//	so a cache is rejected once the rig changes; returns bytes written
+a3i32 a3skinWeightsSave(const a3_SkinWeights *weights, const a3_Hierarchy *hierarchy, const a3byte *cacheFilePath);
+
+// load weights from binary cache made for this hierarchy; returns point 
+//	count
+a3i32 a3skinWeightsLoad(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *cacheFilePath);
+
+// load XML through cache: read the cache if it is current, otherwise 
+//	parse the XML file and regenerate the cache; returns point count
+a3i32 a3skinWeightsLoadXMLCached(a3_SkinWeights *weights_out, const a3_Hierarchy *hierarchy, const a3byte *resourceFilePath, const a3byte *cacheFilePath);
+
+// release weights
+a3i32 a3skinWeightsRelease(a3_SkinWeights *weights);
+
+// expand to the float weight and integer index streams skinning reads, 
+//	a3skinning_influenceMax per vertex; weights are stored per point (OBJ 
+//	position index), while loaded geometry splits points into several 
+//	vertices by texcoord and normal, so pass each vertex's point index to 
+//	remap; without it vertex count must equal point count; returns vertex 
+//	count, or -1 if a point index is out of range
+a3i32 a3skinWeightsDecode(const a3_SkinWeights *weights, a3vec4 *blendWeight_out, a3i32 *blendIndex_out, const a3ui32 *vertexPoint_opt, const a3ui32 vertexCount);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_SkinWeights.inl"
+
+
+#endif	// !__ANIMAL3D_SKINWEIGHTS_H
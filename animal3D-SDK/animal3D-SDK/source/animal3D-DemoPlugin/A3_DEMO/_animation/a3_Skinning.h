@@ -0,0 +1,205 @@
+/*
+	Copyright 2011-2020 Daniel S. Buckstein
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/
+
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	By Daniel S. Buckstein
+	
+	a3_Skinning.h
+	CPU vertex skinning against a hierarchy state's palette.
+*/
+
+#ifndef __ANIMAL3D_SKINNING_H
+#define __ANIMAL3D_SKINNING_H
+
+
+#include "a3_HierarchyState.h"
+
+#include "animal3D/a3geometry/a3_GeometryData.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+typedef struct a3_SkinMesh					a3_SkinMesh;
+typedef struct a3_SkinningJob				a3_SkinningJob;
+typedef struct a3_SkinningWorkers			a3_SkinningWorkers;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+// constant values
+enum
+{
+	// influences per vertex
+	a3skinning_influenceMax = 4,
+
+	// most threads one job is split across
+	a3skinning_threadMax = 16,
+};
+
+
+// view of the streams of a geometry that skinning reads; nothing is 
+//	copied, so the geometry must outlive it, unless the mesh is a bucketed 
+//	copy that owns reordered streams
+struct a3_SkinMesh
+{
+	// rest-pose attributes; normals and tangent basis may be null
+	const a3vec3 *position, *normal, *tangent, *bitangent;
+
+	// blend weights and palette indices, four per vertex
+	const a3vec4 *blendWeight;
+	const a3i32 *blendIndex;
+
+	// number of vertices, and one past the highest palette index used
+	a3ui32 vertexCount, paletteCount;
+
+	// vertices grouped by influence count: vertices with k+1 non-zero 
+	//	weights, heaviest-first order kept, occupy bucketOffset[k] up to 
+	//	bucketOffset[k + 1]; a plain view puts every vertex in the last 
+	//	bucket
+	a3ui32 bucketOffset[a3skinning_influenceMax + 1];
+
+	// for bucketed copies, index of each vertex in the source geometry; 
+	//	skinning writes outputs there, so output streams keep the source 
+	//	order (null for plain views)
+	const a3ui32 *vertexOrigin;
+
+	// storage owned by a bucketed copy (null for plain views)
+	void *data;
+};
+
+
+// one skinning pass over a range of vertices: reads the mesh and palette, 
+//	writes each requested output stream (null to skip) at the same vertex 
+//	index as the input, so outputs may be whole-mesh buffers shared by 
+//	the slices of a parallel job
+struct a3_SkinningJob
+{
+	// source mesh
+	const a3_SkinMesh *mesh;
+
+	// bind-to-current transforms, 16-byte aligned (e.g. a state's 
+	//	objectSpaceBindToCurrent), and how many there are
+	const a3mat4 *palette;
+	a3ui32 paletteCount;
+
+	// the same transforms as unit dual quaternions, 16-byte aligned; only 
+	//	read by dual quaternion skinning, null otherwise
+	const a3dualquat *paletteDualQuat;
+
+	// skinned outputs; directions are renormalized
+	a3vec3 *position_out, *normal_out, *tangent_out, *bitangent_out;
+
+	// vertex range
+	a3ui32 firstVertex, vertexCount;
+};
+
+
+// persistent worker threads for parallel skinning: workers sleep between 
+//	jobs, so a parallel pass costs one wake-up and one wait instead of 
+//	creating and joining threads; one job at a time per pool
+struct a3_SkinningWorkers
+{
+	// threads a job is split across, counting the caller
+	a3ui32 threadCount;
+
+	// platform threads and synchronization (owned)
+	void *data;
+};
+
+
+//-----------------------------------------------------------------------------
+
+// make skinning view of geometry with positions and blending attributes; 
+//	returns vertex count
+a3i32 a3skinMeshInit(a3_SkinMesh *mesh_out, const a3_GeometryData *geom);
+
+// make copy of mesh with vertices stably sorted into buckets by influence 
+//	count, and influences in each vertex compacted to the front, so that 
+//	skinning runs one loop per count with no wasted palette fetches; the 
+//	job vertex range then refers to sorted order, while outputs are still 
+//	written in source order; returns vertex count
+a3i32 a3skinMeshCreateBucketed(a3_SkinMesh *mesh_out, const a3_SkinMesh *mesh);
+
+// release bucketed mesh copy
+a3i32 a3skinMeshRelease(a3_SkinMesh *mesh);
+
+// fill a job for the whole mesh from a hierarchy state's palette
+a3i32 a3skinningJobInit(a3_SkinningJob *job_out, const a3_SkinMesh *mesh, const a3_HierarchyState *state, a3vec3 *position_out, a3vec3 *normal_out_opt, a3vec3 *tangent_out_opt, a3vec3 *bitangent_out_opt);
+
+// linear blend skinning: each vertex is transformed by the weighted sum 
+//	of its palette matrices; runs on the calling thread, returns number 
+//	of vertices skinned
+a3i32 a3skinningLinear(const a3_SkinningJob *job);
+
+// linear blend skinning with plain scalar arithmetic (what builds without 
+//	SSE run); reference for checking and timing the vector path
+a3i32 a3skinningLinearScalar(const a3_SkinningJob *job);
+
+// linear blend skinning split into equal vertex ranges across a worker 
+//	pool: the calling thread takes the first range while the workers take 
+//	the rest, then waits for all; waking the pool still costs more than a 
+//	small mesh takes to skin, so use for large meshes or many instances
+a3i32 a3skinningLinearParallel(const a3_SkinningJob *job, const a3_SkinningWorkers *workers);
+
+
+// convert bind-to-current matrices to unit dual quaternions, half the 
+//	size per entry; scale cannot be encoded and is dropped (columns are 
+//	normalized first), so scaled rigs should use linear skinning; returns 
+//	number converted
+a3i32 a3skinningPaletteDualQuat(a3dualquat *paletteDualQuat_out, const a3mat4 *palette, const a3ui32 count);
+
+// dual quaternion skinning: each vertex is transformed by the normalized 
+//	weighted sum of its palette dual quaternions, flipped into the first 
+//	influence's hemisphere; keeps volume at twisting joints where linear 
+//	blending collapses; outputs match the linear path's layout
+a3i32 a3skinningDualQuat(const a3_SkinningJob *job);
+
+// dual quaternion skinning with plain scalar arithmetic; reference for 
+//	the vector path
+a3i32 a3skinningDualQuatScalar(const a3_SkinningJob *job);
+
+// dual quaternion skinning split across a worker pool as in the linear 
+//	version
+a3i32 a3skinningDualQuatParallel(const a3_SkinningJob *job, const a3_SkinningWorkers *workers);
+
+
+// start a worker pool that splits jobs across the given number of threads, 
+//	the caller included (at most a3skinning_threadMax); returns the thread 
+//	count actually available, which is lower if workers failed to start
+a3i32 a3skinningWorkersCreate(a3_SkinningWorkers *workers_out, const a3ui32 threadCount);
+
+// stop and join the workers and release the pool
+a3i32 a3skinningWorkersRelease(a3_SkinningWorkers *workers);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#include "_inl/a3_Skinning.inl"
+
+
+#endif	// !__ANIMAL3D_SKINNING_H
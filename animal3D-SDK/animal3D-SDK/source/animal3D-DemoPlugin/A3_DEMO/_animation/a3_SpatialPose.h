@@ -49,20 +49,37 @@ enum a3_SpatialPoseChannel
 {
 	// identity
 	a3poseChannel_none,					// no channels
+
+	// individual channels
+	a3poseChannel_rotate = 0x0001,		// orientation (quaternion)
+	a3poseChannel_translate = 0x0002,	// translation (3D vector)
+	a3poseChannel_scale = 0x0004,		// scale (3D vector)
+
+	// all channels
+	a3poseChannel_all = a3poseChannel_rotate | a3poseChannel_translate | a3poseChannel_scale,
 };
 
 	
 //-----------------------------------------------------------------------------
 
-// single pose for a single node
+// single pose for a single node, described by its channels
+// pose groups and hierarchy states store these channels as separate streams
 struct a3_SpatialPose
 {
-	a3mat4 transform;
+	a3quat rotate;
+	a3vec3 translate;
+	a3vec3 scale;
 };
 
 
 //-----------------------------------------------------------------------------
 
+// reset single node pose to identity
+a3i32 a3spatialPoseReset(a3_SpatialPose* spatialPose);
+
+// convert channels to matrix: translate * rotate * scale
+a3i32 a3spatialPoseConvert(a3mat4* mat_out, const a3quat* rotate, const a3vec3* translate, const a3vec3* scale);
+
 
 
 //-----------------------------------------------------------------------------